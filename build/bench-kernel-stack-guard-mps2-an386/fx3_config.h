@@ -0,0 +1,31 @@
+/**
+ * @file fx3_config.h
+ * @brief FX3 RTOS configuration for the kernel benchmark with the MPU stack guard
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __FX3_CONFIG_LOCAL_H__
+#define __FX3_CONFIG_LOCAL_H__
+
+#define FX3_MPU_STACK_GUARD
+
+#include_next <fx3_config.h>
+
+#endif // __FX3_CONFIG_LOCAL_H__
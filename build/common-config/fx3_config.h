@@ -24,7 +24,75 @@
 #ifndef __FX3_CONFIG_H__
 #define __FX3_CONFIG_H__
 
+#ifndef FX3_MAX_TASK_COUNT
 #define FX3_MAX_TASK_COUNT 12
+#endif
+
+/*
+ * Define to replace the ready heap with per-priority FIFOs indexed by a
+ * bitmap; task priorities must be below FX3_READY_QUEUE_PRIORITY_COUNT
+ * (default 16), creating a task with a higher value is rejected.
+ */
+//#define FX3_BITMAP_READY_QUEUE
+
+/*
+ * Define to enable the tmr_* software timers; their callbacks run on a
+ * timer task, at FX3_TIMER_TASK_PRIORITY (default 1), which counts against
+ * FX3_MAX_TASK_COUNT.
+ */
+//#define FX3_SOFTWARE_TIMERS
+
+/*
+ * Size of the kernel command pool (default 64, at most 1024). Each
+ * interrupt priority level keeps FX3_COMMAND_RESERVED_PER_LEVEL (default
+ * 1) commands out of reach of less urgent handlers and of tasks; see
+ * fx3_getCommandStatistics to tune both. The pool must also hold one
+ * command per task on top of the reserves.
+ */
+//#define FX3_COMMAND_QUEUE_SIZE 64
+
+/*
+ * Define to fold repeated ready requests for the same task, and repeated
+ * signals of the same semaphore, posted before the kernel got to run, into
+ * a single command carrying a count.
+ */
+//#define FX3_COALESCE_COMMANDS
+
+/*
+ * Kernel self-checks (asserts): FX3_AUDIT_OFF, FX3_AUDIT_INVARIANTS
+ * (constant-time checks at each kernel entry, the default unless NDEBUG is
+ * defined), FX3_AUDIT_INCREMENTAL (also walks every task control block and
+ * queue, FX3_AUDIT_TASKS_PER_IDLE_LOOP (default 2) at a time, from the idle
+ * task) or FX3_AUDIT_FULL (walks everything at each kernel entry; slow).
+ */
+//#define FX3_AUDIT_LEVEL FX3_AUDIT_INCREMENTAL
+
+/*
+ * Define to let the idle task sleep until the next alarm without taking
+ * the periodic tick interrupts (bsp_sleep_ticks); implemented by the
+ * SysTick timer, cortex_timer.c.
+ */
+//#define FX3_TICKLESS_IDLE
+
+/*
+ * Define to count the CPU time of each task, of the interrupt handlers and
+ * of the kernel in bsp_getCycleCount cycles; see fx3_getCpuUsage.
+ */
+//#define FX3_CPU_ACCOUNTING
+
+/*
+ * Define to place a no-access MPU region (FX3_MPU_STACK_GUARD_REGION,
+ * default 7) at the bottom of the running task's stack, moved on each
+ * context switch; needs the ARMv7-M MPU. Costs 32 bytes of each stack.
+ */
+//#define FX3_MPU_STACK_GUARD
+
+/*
+ * Define to record kernel events in a RAM ring of FX3_TRACE_RECORD_COUNT
+ * (default 256, a power of 2) records, timestamped with bsp_getCycleCount;
+ * decode them with tools/trace/fx3_trace.py.
+ */
+//#define FX3_TRACE
 
 #endif // __FX3_CONFIG_H__
 
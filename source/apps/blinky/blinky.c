@@ -69,7 +69,10 @@ static void toggleLed(const void* arg)
 {
    struct led_toggler* tog = (struct led_toggler*) arg;
 
-   fx3_suspendTask(tog->initialDelay_ms);
+   if (tog->initialDelay_ms)
+   {
+      fx3_suspendTask(tog->initialDelay_ms);
+   }
 
    while (true)
    {
@@ -92,3 +92,28 @@ APP_LIS3DSH_C_VPATH:=source/apps/tests
 APP_LIS3DH_TARGET:=LIS3DH
 APP_LIS3DH_OBJECTS:=test_LIS3DH.o LIS3DH.o mems.o
 APP_LIS3DH_C_VPATH:=source/apps/tests
+
+
+#
+# Kernel benchmarks
+#
+
+APP_BENCH_READY_QUEUE_TARGET:=bench_ready_queue
+APP_BENCH_READY_QUEUE_OBJECTS:=bench_ready_queue.o
+APP_BENCH_READY_QUEUE_C_VPATH:=source/apps/tests
+
+APP_BENCH_COMMAND_BURST_TARGET:=bench_command_burst
+APP_BENCH_COMMAND_BURST_OBJECTS:=bench_command_burst.o
+APP_BENCH_COMMAND_BURST_C_VPATH:=source/apps/tests
+
+APP_BENCH_COMMAND_BURST_COALESCED_TARGET:=bench_command_burst
+APP_BENCH_COMMAND_BURST_COALESCED_OBJECTS:=bench_command_burst.o
+APP_BENCH_COMMAND_BURST_COALESCED_C_VPATH:=source/apps/tests
+
+APP_BENCH_KERNEL_TARGET:=bench_kernel
+APP_BENCH_KERNEL_OBJECTS:=bench_kernel.o
+APP_BENCH_KERNEL_C_VPATH:=source/apps/tests
+
+APP_BENCH_KERNEL_STACK_GUARD_TARGET:=bench_kernel
+APP_BENCH_KERNEL_STACK_GUARD_OBJECTS:=bench_kernel.o
+APP_BENCH_KERNEL_STACK_GUARD_C_VPATH:=source/apps/tests
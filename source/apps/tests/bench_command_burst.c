@@ -0,0 +1,255 @@
+/**
+ * @file bench_command_burst.c
+ * @brief Measure the PendSV cost of processing bursts of kernel commands
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <board.h>
+#include <task.h>
+#include <synchronization.h>
+
+#include <usart.h>
+
+#include <fx3_config.h>
+
+/*
+ * Measures, with the board cycle counter (bsp_getCycleCount), the time
+ * PendSV takes to process a burst of commands, such as a DMA interrupt
+ * handler signaling a semaphore several times, or a producer sending
+ * several messages to a blocked consumer, before the kernel gets to run.
+ *
+ * The burst is posted with interrupts disabled, then the counter is
+ * sampled around re-enabling them; the tasks woken up have a lower
+ * priority, so PendSV returns to the benchmark task. Build with and
+ * without FX3_COALESCE_COMMANDS to compare.
+ */
+
+#define MAX_BURST_SIZE     16
+#define BURST_ROUNDS       32
+
+static const uint32_t burstSizes[] = { 1, 4, 16 };
+
+#ifdef FX3_COALESCE_COMMANDS
+static const char coalescingMode[] = "coalesced";
+#else
+static const char coalescingMode[] = "not coalesced";
+#endif
+
+static struct semaphore burstSemaphore;
+
+static struct list_element burstMessages[MAX_BURST_SIZE];
+
+static struct task_control_block semaphoreWaiterTCB;
+static struct task_control_block messageReceiverTCB;
+
+static void waitOnSemaphore(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitOnSemaphore(&burstSemaphore);
+   }
+}
+
+static void receiveMessages(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      struct list_element* msg = fx3_waitForMessage();
+
+      while (msg)
+      {
+         struct list_element* next = msg->next;
+         msg->next = NULL;
+         msg       = next;
+      }
+   }
+}
+
+/** Lets PendSV process the commands posted while interrupts were disabled
+ *
+ * @return the cycles spent until PendSV returned
+ */
+static inline uint32_t measurePendingCommands(void)
+{
+   uint32_t start = bsp_getCycleCount();
+
+   __enable_irq();
+   __ISB();
+
+   return bsp_getCycleCount() - start;
+}
+
+static uint32_t measureSignalBurst(uint32_t burstSize)
+{
+   uint32_t totalCycles = 0;
+
+   for (uint32_t round = 0; round < BURST_ROUNDS; round ++)
+   {
+      __disable_irq();
+
+      for (uint32_t ii = 0; ii < burstSize; ii ++)
+      {
+         fx3_signalSemaphore(&burstSemaphore);
+      }
+
+      totalCycles += measurePendingCommands();
+
+      // let the waiter consume the signals and block again
+      fx3_suspendTask(2);
+   }
+
+   return totalCycles / BURST_ROUNDS;
+}
+
+static uint32_t measureMessageBurst(uint32_t burstSize)
+{
+   uint32_t totalCycles = 0;
+
+   for (uint32_t round = 0; round < BURST_ROUNDS; round ++)
+   {
+      __disable_irq();
+
+      for (uint32_t ii = 0; ii < burstSize; ii ++)
+      {
+         fx3_sendMessage(&messageReceiverTCB, &burstMessages[ii]);
+      }
+
+      totalCycles += measurePendingCommands();
+
+      // let the receiver drain its inbox and block again
+      fx3_suspendTask(2);
+   }
+
+   return totalCycles / BURST_ROUNDS;
+}
+
+static char outBuffer[96];
+
+static void runBenchmark(const void* arg)
+{
+   struct USARTHandle* usart = (struct USARTHandle*) arg;
+   uint32_t bytesWritten = 0;
+
+   while (true)
+   {
+      for (uint32_t ii = 0; ii < sizeof(burstSizes) / sizeof(burstSizes[0]); ii ++)
+      {
+         const uint32_t burstSize = burstSizes[ii];
+
+         uint32_t signalCycles  = measureSignalBurst(burstSize);
+         uint32_t messageCycles = measureMessageBurst(burstSize);
+
+         int len = snprintf(outBuffer, sizeof(outBuffer), "burst of %u, %s: signals %u cycles, messages %u cycles in PendSV\r\n",
+                            (unsigned) burstSize, coalescingMode, (unsigned) signalCycles, (unsigned) messageCycles);
+         enum Status status = usart_write(usart, (const uint8_t*) outBuffer, (uint32_t) len, &bytesWritten);
+         assert(STATUS_OK == status);
+         assert(len == (int) bytesWritten);
+      }
+
+      struct fx3_command_statistics stats;
+      fx3_getCommandStatistics(&stats);
+
+      int len = snprintf(outBuffer, sizeof(outBuffer), "command pool high-water mark %u of %u\r\n",
+                         (unsigned) stats.highWaterMark, (unsigned) stats.capacity);
+      enum Status status = usart_write(usart, (const uint8_t*) outBuffer, (uint32_t) len, &bytesWritten);
+      assert(STATUS_OK == status);
+      assert(len == (int) bytesWritten);
+
+      fx3_suspendTask(5000);
+   }
+}
+
+static const struct USARTConfiguration usartConfig =
+{
+   .baudRate    = 115200,
+   .flowControl = USART_FLOW_CONTROL_NONE,
+   .bits        = 8,
+   .parity      = USART_PARITY_NONE,
+   .stopBits    = 1,
+};
+
+static uint8_t benchmarkStack[2048] __attribute__ ((aligned (16)));
+static uint8_t semaphoreWaiterStack[256] __attribute__ ((aligned (16)));
+static uint8_t messageReceiverStack[256] __attribute__ ((aligned (16)));
+
+static const struct task_config benchmarkTaskConfig =
+{
+   .name            = "Command Burst Benchmark",
+   .handler         = runBenchmark,
+   .argument        = &CONSOLE_USART,
+   .priority        = 4,
+   .stackBase       = benchmarkStack,
+   .stackSize       = sizeof(benchmarkStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config semaphoreWaiterTaskConfig =
+{
+   .name            = "Semaphore Waiter",
+   .handler         = waitOnSemaphore,
+   .argument        = NULL,
+   .priority        = 8,
+   .stackBase       = semaphoreWaiterStack,
+   .stackSize       = sizeof(semaphoreWaiterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config messageReceiverTaskConfig =
+{
+   .name            = "Message Receiver",
+   .handler         = receiveMessages,
+   .argument        = NULL,
+   .priority        = 8,
+   .stackBase       = messageReceiverStack,
+   .stackSize       = sizeof(messageReceiverStack),
+   .timeSlice_ticks = 0,
+};
+
+static struct task_control_block benchmarkTCB;
+
+int main(void)
+{
+   bsp_initialize();
+   usart_initialize(&CONSOLE_USART, &usartConfig);
+
+   fx3_initialize();
+
+   fx3_initializeSemaphore(&burstSemaphore, 0);
+
+   fx3_createTask(&benchmarkTCB, &benchmarkTaskConfig);
+   fx3_createTask(&semaphoreWaiterTCB, &semaphoreWaiterTaskConfig);
+   fx3_createTask(&messageReceiverTCB, &messageReceiverTaskConfig);
+
+   fx3_startMultitasking();
+
+   // never reached
+   assert(false);
+
+   return 0;
+}
@@ -0,0 +1,450 @@
+/**
+ * @file bench_kernel.c
+ * @brief Measure context switch, semaphore, message and interrupt latencies
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <board.h>
+#include <task.h>
+#include <synchronization.h>
+
+#include <usart.h>
+
+#include <fx3_config.h>
+
+/*
+ * Kernel microbenchmarks, timed with the board cycle counter
+ * (bsp_getCycleCount); every figure is in core clock cycles:
+ *
+ *  - context switch: from signaling a semaphore to the higher-priority
+ *    task waiting on it running
+ *  - semaphore ping-pong: round trip to a higher-priority task, which
+ *    answers on a second semaphore; two context switches
+ *  - message throughput: cost per message of sending a batch to a
+ *    lower-priority task, and of that task receiving them
+ *  - interrupt latency: from pending an interrupt in the NVIC to its
+ *    handler running, and to the task it signals running; once through
+ *    a semaphore, and once through the notification word of the task
+ *
+ * Runs on the boards that provide bsp_getCycleCount and SPARE_IRQn,
+ * including MPS2-AN386 under QEMU; the report ends with "benchmark
+ * complete" and is repeated every 5 seconds.
+ */
+
+#define ROUNDS             256
+#define MESSAGE_BATCH      32
+
+struct measurement
+{
+   const char*    name;
+   uint32_t       minimum;
+   uint32_t       maximum;
+   uint64_t       total;
+   uint32_t       count;
+};
+
+static struct measurement contextSwitch        = { .name = "context switch" };
+static struct measurement semaphorePingPong    = { .name = "semaphore ping-pong" };
+static struct measurement messageThroughput    = { .name = "message send and receive" };
+static struct measurement interruptEntry       = { .name = "interrupt to handler" };
+static struct measurement interruptToTask      = { .name = "interrupt to task, semaphore" };
+static struct measurement notificationToTask   = { .name = "interrupt to task, notification" };
+
+static struct measurement* const measurements[] =
+{
+   &contextSwitch,
+   &semaphorePingPong,
+   &messageThroughput,
+   &interruptEntry,
+   &interruptToTask,
+   &notificationToTask,
+};
+
+static struct semaphore switchSemaphore;
+static struct semaphore pingSemaphore;
+static struct semaphore pongSemaphore;
+static struct semaphore batchReceived;
+static struct semaphore interruptSemaphore;
+
+static struct list_element messages[MESSAGE_BATCH];
+
+static volatile uint32_t signaledAt;
+static volatile uint32_t interruptRaisedAt;
+static volatile uint32_t handlerEnteredAt;
+
+/// Selects how the interrupt handler wakes up its task
+static volatile bool notifyFromInterrupt;
+
+#define INTERRUPT_NOTIFICATION   (1U << 0)
+
+static struct task_control_block notificationWaiterTCB;
+static struct task_control_block messageReceiverTCB;
+
+static void resetMeasurement(struct measurement* meas)
+{
+   meas->minimum = UINT32_MAX;
+   meas->maximum = 0;
+   meas->total   = 0;
+   meas->count   = 0;
+}
+
+static void recordSample(struct measurement* meas, uint32_t cycles)
+{
+   if (cycles < meas->minimum)
+   {
+      meas->minimum = cycles;
+   }
+
+   if (cycles > meas->maximum)
+   {
+      meas->maximum = cycles;
+   }
+
+   meas->total += cycles;
+   meas->count ++;
+}
+
+/*
+ * Higher-priority peers of the benchmark task
+ */
+
+static void waitForSwitch(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitOnSemaphore(&switchSemaphore);
+
+      recordSample(&contextSwitch, bsp_getCycleCount() - signaledAt);
+   }
+}
+
+static void answerPing(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitOnSemaphore(&pingSemaphore);
+      fx3_signalSemaphore(&pongSemaphore);
+   }
+}
+
+static void waitForInterrupt(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitOnSemaphore(&interruptSemaphore);
+
+      const uint32_t now = bsp_getCycleCount();
+
+      recordSample(&interruptEntry, handlerEnteredAt - interruptRaisedAt);
+      recordSample(&interruptToTask, now - interruptRaisedAt);
+   }
+}
+
+static void waitForNotification(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitForNotification(INTERRUPT_NOTIFICATION);
+
+      const uint32_t now = bsp_getCycleCount();
+
+      recordSample(&interruptEntry, handlerEnteredAt - interruptRaisedAt);
+      recordSample(&notificationToTask, now - interruptRaisedAt);
+   }
+}
+
+void SPARE_IRQHandler(void)
+{
+   handlerEnteredAt = bsp_getCycleCount();
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
+   if (notifyFromInterrupt)
+   {
+      fx3_notifyTask(&notificationWaiterTCB, FX3_NOTIFY_SET_BITS, INTERRUPT_NOTIFICATION);
+   }
+   else
+   {
+      fx3_signalSemaphore(&interruptSemaphore);
+   }
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+}
+
+/*
+ * Lower-priority peer: runs when the benchmark task blocks
+ */
+
+static void receiveMessages(const void* arg)
+{
+   (void) arg;
+
+   uint32_t received = 0;
+
+   while (true)
+   {
+      struct list_element* msg = fx3_waitForMessage();
+      msg->next = NULL;
+
+      received ++;
+      if (MESSAGE_BATCH == received)
+      {
+         received = 0;
+         fx3_signalSemaphore(&batchReceived);
+      }
+   }
+}
+
+static void measureContextSwitch(void)
+{
+   for (uint32_t round = 0; round < ROUNDS; round ++)
+   {
+      signaledAt = bsp_getCycleCount();
+      fx3_signalSemaphore(&switchSemaphore);
+   }
+}
+
+static void measureSemaphorePingPong(void)
+{
+   for (uint32_t round = 0; round < ROUNDS; round ++)
+   {
+      const uint32_t start = bsp_getCycleCount();
+
+      fx3_signalSemaphore(&pingSemaphore);
+      fx3_waitOnSemaphore(&pongSemaphore);
+
+      recordSample(&semaphorePingPong, bsp_getCycleCount() - start);
+   }
+}
+
+static void measureMessageThroughput(void)
+{
+   for (uint32_t round = 0; round < ROUNDS / MESSAGE_BATCH; round ++)
+   {
+      const uint32_t start = bsp_getCycleCount();
+
+      for (uint32_t ii = 0; ii < MESSAGE_BATCH; ii ++)
+      {
+         fx3_sendMessage(&messageReceiverTCB, &messages[ii]);
+      }
+
+      fx3_waitOnSemaphore(&batchReceived);
+
+      recordSample(&messageThroughput, (bsp_getCycleCount() - start) / MESSAGE_BATCH);
+   }
+}
+
+static void measureInterruptLatency(bool notify)
+{
+   notifyFromInterrupt = notify;
+
+   for (uint32_t round = 0; round < ROUNDS; round ++)
+   {
+      interruptRaisedAt = bsp_getCycleCount();
+      NVIC_SetPendingIRQ(SPARE_IRQn);
+      __ISB();
+   }
+}
+
+static char outBuffer[128];
+
+static const char benchmarkComplete[] = "benchmark complete\r\n";
+
+static void reportMeasurement(struct USARTHandle* usart, const struct measurement* meas)
+{
+   int len = snprintf(outBuffer, sizeof(outBuffer), "%s: min %u, avg %u, max %u cycles\r\n",
+                      meas->name, (unsigned) meas->minimum, (unsigned) (meas->total / meas->count), (unsigned) meas->maximum);
+
+   uint32_t bytesWritten = 0;
+   enum Status status = usart_write(usart, (const uint8_t*) outBuffer, (uint32_t) len, &bytesWritten);
+   assert(STATUS_OK == status);
+   assert(len == (int) bytesWritten);
+}
+
+static void runBenchmark(const void* arg)
+{
+   struct USARTHandle* usart = (struct USARTHandle*) arg;
+   uint32_t bytesWritten = 0;
+
+   NVIC_SetPriority(SPARE_IRQn, 2);
+   NVIC_EnableIRQ(SPARE_IRQn);
+
+   while (true)
+   {
+      for (uint32_t ii = 0; ii < sizeof(measurements) / sizeof(measurements[0]); ii ++)
+      {
+         resetMeasurement(measurements[ii]);
+      }
+
+      measureContextSwitch();
+      measureSemaphorePingPong();
+      measureMessageThroughput();
+      measureInterruptLatency(false);
+      measureInterruptLatency(true);
+
+      int len = snprintf(outBuffer, sizeof(outBuffer), "FX3 kernel benchmark, core clock %u Hz\r\n", (unsigned) SystemCoreClock);
+      enum Status status = usart_write(usart, (const uint8_t*) outBuffer, (uint32_t) len, &bytesWritten);
+      assert(STATUS_OK == status);
+      assert(len == (int) bytesWritten);
+
+      for (uint32_t ii = 0; ii < sizeof(measurements) / sizeof(measurements[0]); ii ++)
+      {
+         reportMeasurement(usart, measurements[ii]);
+      }
+
+      status = usart_write(usart, (const uint8_t*) benchmarkComplete, sizeof(benchmarkComplete) - 1, &bytesWritten);
+      assert(STATUS_OK == status);
+      assert((sizeof(benchmarkComplete) - 1) == bytesWritten);
+
+      fx3_suspendTask(5000);
+   }
+}
+
+static const struct USARTConfiguration usartConfig =
+{
+   .baudRate    = 115200,
+   .flowControl = USART_FLOW_CONTROL_NONE,
+   .bits        = 8,
+   .parity      = USART_PARITY_NONE,
+   .stopBits    = 1,
+};
+
+static uint8_t benchmarkStack[2048] __attribute__ ((aligned (16)));
+static uint8_t interruptWaiterStack[256] __attribute__ ((aligned (16)));
+static uint8_t notificationWaiterStack[256] __attribute__ ((aligned (16)));
+static uint8_t switchWaiterStack[256] __attribute__ ((aligned (16)));
+static uint8_t pingResponderStack[256] __attribute__ ((aligned (16)));
+static uint8_t messageReceiverStack[256] __attribute__ ((aligned (16)));
+
+static const struct task_config interruptWaiterTaskConfig =
+{
+   .name            = "Interrupt Waiter",
+   .handler         = waitForInterrupt,
+   .argument        = NULL,
+   .priority        = 1,
+   .stackBase       = interruptWaiterStack,
+   .stackSize       = sizeof(interruptWaiterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config notificationWaiterTaskConfig =
+{
+   .name            = "Notification Waiter",
+   .handler         = waitForNotification,
+   .argument        = NULL,
+   .priority        = 2,
+   .stackBase       = notificationWaiterStack,
+   .stackSize       = sizeof(notificationWaiterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config switchWaiterTaskConfig =
+{
+   .name            = "Switch Waiter",
+   .handler         = waitForSwitch,
+   .argument        = NULL,
+   .priority        = 3,
+   .stackBase       = switchWaiterStack,
+   .stackSize       = sizeof(switchWaiterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config pingResponderTaskConfig =
+{
+   .name            = "Ping Responder",
+   .handler         = answerPing,
+   .argument        = NULL,
+   .priority        = 4,
+   .stackBase       = pingResponderStack,
+   .stackSize       = sizeof(pingResponderStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config benchmarkTaskConfig =
+{
+   .name            = "Kernel Benchmark",
+   .handler         = runBenchmark,
+   .argument        = &CONSOLE_USART,
+   .priority        = 5,
+   .stackBase       = benchmarkStack,
+   .stackSize       = sizeof(benchmarkStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config messageReceiverTaskConfig =
+{
+   .name            = "Message Receiver",
+   .handler         = receiveMessages,
+   .argument        = NULL,
+   .priority        = 8,
+   .stackBase       = messageReceiverStack,
+   .stackSize       = sizeof(messageReceiverStack),
+   .timeSlice_ticks = 0,
+};
+
+static struct task_control_block interruptWaiterTCB;
+static struct task_control_block switchWaiterTCB;
+static struct task_control_block pingResponderTCB;
+static struct task_control_block benchmarkTCB;
+
+int main(void)
+{
+   bsp_initialize();
+   usart_initialize(&CONSOLE_USART, &usartConfig);
+
+   fx3_initialize();
+
+   fx3_initializeSemaphore(&switchSemaphore, 0);
+   fx3_initializeSemaphore(&pingSemaphore, 0);
+   fx3_initializeSemaphore(&pongSemaphore, 0);
+   fx3_initializeSemaphore(&batchReceived, 0);
+   fx3_initializeSemaphore(&interruptSemaphore, 0);
+
+   fx3_createTask(&interruptWaiterTCB, &interruptWaiterTaskConfig);
+   fx3_createTask(&notificationWaiterTCB, &notificationWaiterTaskConfig);
+   fx3_createTask(&switchWaiterTCB, &switchWaiterTaskConfig);
+   fx3_createTask(&pingResponderTCB, &pingResponderTaskConfig);
+   fx3_createTask(&benchmarkTCB, &benchmarkTaskConfig);
+   fx3_createTask(&messageReceiverTCB, &messageReceiverTaskConfig);
+
+   fx3_startMultitasking();
+
+   // never reached
+   assert(false);
+
+   return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file bench_ready_queue.c
+ * @brief Compare the cycle cost of the heap and bitmap ready queues
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <board.h>
+#include <task.h>
+
+#include <priority_queue.h>
+#include <bitmap_queue.h>
+
+#include <usart.h>
+
+/*
+ * Measures, with the board cycle counter (bsp_getCycleCount), the cost
+ * of one dispatch on a ready queue holding N tasks: pop the highest
+ * priority task, then push it back. This is the work
+ * selectNextRunningTask and markTaskReady do on every context switch.
+ */
+
+#define MAX_BENCH_TASKS    32
+#define PRIORITY_COUNT     16
+#define LEVEL_COUNT        (PRIORITY_COUNT * 2)
+#define DISPATCH_ROUNDS    256
+
+static const uint32_t benchTaskCounts[] = { 4, 12, 32 };
+
+struct bench_task
+{
+   struct priority_queue_entry readyEntry;
+
+   struct list_element         readyLink;
+   uint32_t                    level;
+};
+
+static struct bench_task benchTasks[MAX_BENCH_TASKS];
+
+static struct priority_queue_entry* heapMemPool[MAX_BENCH_TASKS + 1];
+static struct indexed_priority_queue heapQueue;
+
+static struct bitmap_queue_level bitmapLevels[LEVEL_COUNT];
+static uint32_t bitmapWords[BMQ_BITMAP_WORD_COUNT(LEVEL_COUNT)];
+static struct bitmap_queue bitmapQueue;
+
+static void initializeTasks(uint32_t taskCount)
+{
+   for (uint32_t ii = 0; ii < taskCount; ii ++)
+   {
+      // spread the tasks over the priorities, with some sharing
+      uint32_t priority = (ii * 7) % PRIORITY_COUNT;
+
+      benchTasks[ii].readyEntry.priority = priority * 16 + TS_READY;
+      benchTasks[ii].readyEntry.slot     = 0;
+      benchTasks[ii].level               = priority * 2;
+      benchTasks[ii].readyLink.next      = NULL;
+   }
+}
+
+static uint32_t measureHeapDispatch(uint32_t taskCount)
+{
+   ipq_initialize(&heapQueue, heapMemPool, taskCount);
+
+   for (uint32_t ii = 0; ii < taskCount; ii ++)
+   {
+      ipq_push(&heapQueue, &benchTasks[ii].readyEntry);
+   }
+
+   uint32_t start = bsp_getCycleCount();
+
+   for (uint32_t round = 0; round < DISPATCH_ROUNDS; round ++)
+   {
+      struct priority_queue_entry* readyEntry = ipq_pop(&heapQueue);
+      ipq_push(&heapQueue, readyEntry);
+   }
+
+   return (bsp_getCycleCount() - start) / DISPATCH_ROUNDS;
+}
+
+static uint32_t measureBitmapDispatch(uint32_t taskCount)
+{
+   bmq_initialize(&bitmapQueue, bitmapLevels, bitmapWords, LEVEL_COUNT);
+
+   for (uint32_t ii = 0; ii < taskCount; ii ++)
+   {
+      bmq_push(&bitmapQueue, &benchTasks[ii].readyLink, benchTasks[ii].level);
+   }
+
+   uint32_t start = bsp_getCycleCount();
+
+   for (uint32_t round = 0; round < DISPATCH_ROUNDS; round ++)
+   {
+      uint32_t level = 0;
+      struct list_element* readyLink = bmq_pop(&bitmapQueue, &level);
+      bmq_push(&bitmapQueue, readyLink, level);
+   }
+
+   return (bsp_getCycleCount() - start) / DISPATCH_ROUNDS;
+}
+
+static char outBuffer[96];
+
+static void runBenchmark(const void* arg)
+{
+   struct USARTHandle* usart = (struct USARTHandle*) arg;
+
+   while (true)
+   {
+      for (uint32_t ii = 0; ii < sizeof(benchTaskCounts) / sizeof(benchTaskCounts[0]); ii ++)
+      {
+         const uint32_t taskCount = benchTaskCounts[ii];
+
+         initializeTasks(taskCount);
+         uint32_t heapCycles = measureHeapDispatch(taskCount);
+
+         initializeTasks(taskCount);
+         uint32_t bitmapCycles = measureBitmapDispatch(taskCount);
+
+         int len = snprintf(outBuffer, sizeof(outBuffer), "ready queue, %u tasks: heap %u cycles, bitmap %u cycles per dispatch\r\n",
+                            (unsigned) taskCount, (unsigned) heapCycles, (unsigned) bitmapCycles);
+
+         uint32_t bytesWritten = 0;
+         enum Status status = usart_write(usart, (const uint8_t*) outBuffer, (uint32_t) len, &bytesWritten);
+         assert(STATUS_OK == status);
+         assert(len == (int) bytesWritten);
+      }
+
+      fx3_suspendTask(5000);
+   }
+}
+
+static const struct USARTConfiguration usartConfig =
+{
+   .baudRate    = 115200,
+   .flowControl = USART_FLOW_CONTROL_NONE,
+   .bits        = 8,
+   .parity      = USART_PARITY_NONE,
+   .stopBits    = 1,
+};
+
+static uint8_t benchmarkStack[2048] __attribute__ ((aligned (16)));
+
+static const struct task_config benchmarkTaskConfig =
+{
+   .name            = "Ready Queue Benchmark",
+   .handler         = runBenchmark,
+   .argument        = &CONSOLE_USART,
+   .priority        = 4,
+   .stackBase       = benchmarkStack,
+   .stackSize       = sizeof(benchmarkStack),
+   .timeSlice_ticks = 0,
+};
+
+static struct task_control_block benchmarkTCB;
+
+int main(void)
+{
+   bsp_initialize();
+   usart_initialize(&CONSOLE_USART, &usartConfig);
+
+   fx3_initialize();
+
+   fx3_createTask(&benchmarkTCB, &benchmarkTaskConfig);
+
+   fx3_startMultitasking();
+
+   // never reached
+   assert(false);
+
+   return 0;
+}
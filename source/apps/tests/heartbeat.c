@@ -23,11 +23,41 @@
 
 #include <board.h>
 #include <task.h>
+#include <timer.h>
+
+#include <fx3_config.h>
 
 #ifndef HEARTBEAT_INTERVAL_MS
 #define HEARTBEAT_INTERVAL_MS 500
 #endif
 
+#ifdef FX3_SOFTWARE_TIMERS
+
+static void toggleHeartbeatLED(void* arg __attribute__((unused)))
+{
+   bsp_toggleLED(LED_ID_BLUE);
+}
+
+static struct timer_config heartbeatTimerConfig =
+{
+   .handler         = toggleHeartbeatLED,
+   .argument        = NULL,
+   .interval_tick   = 0,
+   .type            = TT_PERIODIC,
+};
+
+static struct timer heartbeatTimer;
+
+void utl_startHeartbeat(void)
+{
+   heartbeatTimerConfig.interval_tick = bsp_getTicksForMS(HEARTBEAT_INTERVAL_MS);
+
+   tmr_initialize(&heartbeatTimer, &heartbeatTimerConfig);
+   tmr_start(&heartbeatTimer);
+}
+
+#else
+
 static void blinkHeartbeatLED(const void* arg __attribute__((unused)))
 {
    while (true)
@@ -61,3 +91,5 @@ void utl_startHeartbeat(void)
 {
    fx3_createTask(&heartbeatTCB, &heartbeatTaskConfig);
 }
+
+#endif
@@ -0,0 +1,1109 @@
+/**
+ * @file stress_kernel.c
+ * @brief Randomized kernel stress test and benchmark, for the POSIX host port
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <board.h>
+#include <task.h>
+#include <synchronization.h>
+
+#include <fx3_config.h>
+
+/*
+ * Worker tasks at several priorities, some of them round-robin, pick
+ * random operations: lock the shared mutex and work while holding it,
+ * signal or wait on the shared semaphore, with or without timeout,
+ * produce or consume items guarded by the mutex and a condition variable,
+ * send to or receive from a bounded message queue, send messages to a
+ * sink task, which receives them one at a time or in batches, or to a
+ * selecting task, notify a counting task or each other, wait for a
+ * notification, set, clear or wait for event flags, signal the objects
+ * the selecting task waits on, sleep, busy-work, or raise interrupts
+ * that signal the semaphore or the condition variable, send to the
+ * message queue, notify or set event flags. Each
+ * operation consumes a random number of cycles, so the interrupts,
+ * round-robin timeouts and sleeps land at different points on each seed.
+ *
+ * Checked along the way: mutual exclusion, sleeps and timeouts not
+ * ending early, event waits returning the flags they asked for; and at
+ * the end, that no signal, item, message, notification or event flag
+ * was lost.
+ *
+ * Environment:
+ *    FX3_STRESS_SEED      seed for the random choices (default 1)
+ *    FX3_STRESS_ROUNDS    operations per worker (default 20000)
+ *
+ * The exit status is 0 on success; the host time per context switch is
+ * printed as a benchmark of the scheduler paths.
+ */
+
+#define WORKER_COUNT                6
+#define MESSAGE_SLOTS               4
+#define QUEUE_SLOTS                 4
+
+#define STRESS_IRQ                  3
+
+#define MAX_WORK_CYCLES             (4 * POSIX_CYCLES_PER_MS)
+
+#define EVENT_DATA                  (1U << 0)
+#define EVENT_ERROR                 (1U << 1)
+#define EVENT_BOTH                  (EVENT_DATA | EVENT_ERROR)
+
+enum stress_operation
+{
+   OP_LOCK_MUTEX,
+   OP_TRY_LOCK_MUTEX,
+   OP_SIGNAL,
+   OP_WAIT_WITH_TIMEOUT,
+   OP_TRY_WAIT,
+   OP_PRODUCE_ITEM,
+   OP_CONSUME_ITEM,
+   OP_QUEUE_SEND,
+   OP_QUEUE_RECEIVE,
+   OP_NOTIFY,
+   OP_WAIT_FOR_NOTIFICATION,
+   OP_SET_EVENTS,
+   OP_WAIT_FOR_EVENTS,
+   OP_SIGNAL_SELECTOR,
+   OP_SEND_MESSAGE,
+   OP_SLEEP,
+   OP_RAISE_INTERRUPT,
+   OP_WORK,
+
+   OP_COUNT,
+};
+
+struct stress_message
+{
+   struct list_element element;
+   uint32_t sender;
+   volatile bool inFlight;
+};
+
+struct worker_state
+{
+   uint32_t index;
+   uint32_t random;
+
+   struct stress_message messages[MESSAGE_SLOTS];
+
+   uint32_t messagesSent;
+   volatile uint32_t messagesReceived;
+
+   uint64_t operations[OP_COUNT];
+};
+
+static struct worker_state workers[WORKER_COUNT];
+
+static uint32_t roundsPerWorker = 20000;
+
+static struct mutex sharedMutex;
+static volatile uint32_t mutexHolders;
+static uint64_t protectedCounter;
+static uint64_t mutexAcquisitions;
+
+static struct semaphore sharedSemaphore;
+static volatile uint32_t signalCount;
+static volatile uint32_t consumedCount;
+
+static struct condition_variable itemsAvailable;
+static uint32_t itemCount;
+static volatile uint32_t itemsProduced;
+static volatile uint32_t itemsConsumed;
+
+static struct message_queue boundedQueue;
+static void* boundedQueueSlots[QUEUE_SLOTS];
+static volatile uint32_t queueSent;
+static volatile uint32_t queueReceived;
+static volatile uint32_t queueRejected;
+
+/// Sent by the interrupt handler; the workers send their state
+static uint32_t interruptMessage;
+
+static volatile uint32_t notificationsSent;
+static volatile uint32_t notificationsTaken;
+
+static struct event_group stressEvents;
+static volatile uint32_t eventWakeups;
+
+static struct semaphore selectSemaphore;
+static struct event_group selectEvents;
+static volatile uint32_t selectSignalsSent;
+static volatile uint32_t selectSignalsTaken;
+static volatile uint32_t selectMessages;
+static volatile uint32_t selectEventWakeups;
+static volatile uint32_t selectTimeouts;
+
+static struct semaphore workersDone;
+
+static volatile uint32_t failureCount;
+
+static struct task_control_block workerTCB[WORKER_COUNT];
+static struct task_control_block sinkTCB;
+static struct task_control_block consumerTCB;
+static struct task_control_block itemConsumerTCB;
+static struct task_control_block queueDrainTCB;
+static struct task_control_block notificationCounterTCB;
+static struct task_control_block eventWaiterTCB;
+static struct task_control_block selectorTCB;
+static struct task_control_block checkerTCB;
+
+#define CHECK(condition)   check((condition), #condition, __LINE__)
+
+static void check(bool condition, const char* text, int line)
+{
+   if (! condition)
+   {
+      failureCount ++;
+      fprintf(stderr, "stress_kernel.c:%d: check failed: %s\n", line, text);
+   }
+}
+
+/* xorshift32; each task draws from its own sequence, so a seed
+ * reproduces a run
+ */
+static uint32_t nextRandom(struct worker_state* worker)
+{
+   uint32_t value = worker->random;
+   value ^= value << 13;
+   value ^= value >> 17;
+   value ^= value << 5;
+   worker->random = value;
+   return value;
+}
+
+static uint32_t pickBelow(struct worker_state* worker, uint32_t limit)
+{
+   return nextRandom(worker) % limit;
+}
+
+static void work(struct worker_state* worker)
+{
+   posix_consumeCycles(pickBelow(worker, MAX_WORK_CYCLES));
+}
+
+static void signalFromInterrupt(void)
+{
+   __atomic_add_fetch(&signalCount, 1, __ATOMIC_RELAXED);
+   fx3_signalSemaphore(&sharedSemaphore);
+}
+
+static void lockMutex(struct worker_state* worker, bool tryOnly)
+{
+   if (tryOnly)
+   {
+      if (! fx3_tryLockMutex(&sharedMutex))
+      {
+         return;
+      }
+   }
+   else
+   {
+      fx3_lockMutex(&sharedMutex);
+   }
+
+   mutexHolders ++;
+   CHECK(1 == mutexHolders);
+
+   const uint64_t before = protectedCounter;
+   work(worker);
+   protectedCounter = before + 1;
+   mutexAcquisitions ++;
+
+   mutexHolders --;
+
+   fx3_unlockMutex(&sharedMutex);
+}
+
+static void signalItemsFromInterrupt(void)
+{
+   fx3_signalConditionVariable(&itemsAvailable);
+}
+
+static void produceItem(struct worker_state* worker)
+{
+   fx3_lockMutex(&sharedMutex);
+
+   mutexHolders ++;
+   CHECK(1 == mutexHolders);
+
+   itemCount ++;
+   itemsProduced ++;
+
+   mutexHolders --;
+
+   switch (pickBelow(worker, 3))
+   {
+      case 0:
+         fx3_signalConditionVariable(&itemsAvailable);
+         break;
+
+      case 1:
+         fx3_broadcastConditionVariable(&itemsAvailable);
+         break;
+
+      default:
+         // a late signal; the untimed consumer picks up the item if none comes
+         posix_raiseInterrupt(STRESS_IRQ, signalItemsFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+         break;
+   }
+
+   fx3_unlockMutex(&sharedMutex);
+}
+
+/* Consume an item, waiting a while for one to be produced
+ */
+static void consumeItem(struct worker_state* worker)
+{
+   const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+   fx3_lockMutex(&sharedMutex);
+
+   bool timedOut = false;
+
+   while ((0 == itemCount) && (! timedOut))
+   {
+      if (! fx3_waitOnConditionVariableWithTimeout(&itemsAvailable, &sharedMutex, timeout_ms))
+      {
+         timedOut = true;
+         CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+      }
+   }
+
+   mutexHolders ++;
+   CHECK(1 == mutexHolders);
+
+   // the mutex is held again, even after a timeout
+   if (itemCount)
+   {
+      itemCount --;
+      itemsConsumed ++;
+   }
+
+   mutexHolders --;
+
+   fx3_unlockMutex(&sharedMutex);
+}
+
+static void sendFromInterrupt(void)
+{
+   if (fx3_trySendToMessageQueue(&boundedQueue, &interruptMessage))
+   {
+      __atomic_add_fetch(&queueSent, 1, __ATOMIC_RELAXED);
+   }
+   else
+   {
+      __atomic_add_fetch(&queueRejected, 1, __ATOMIC_RELAXED);
+   }
+}
+
+static void receivedFromQueue(void* msg)
+{
+   CHECK((msg == &interruptMessage) || ((msg >= (void*) &workers[0]) && (msg < (void*) &workers[WORKER_COUNT])));
+   __atomic_add_fetch(&queueReceived, 1, __ATOMIC_RELAXED);
+}
+
+static void sendToQueue(struct worker_state* worker)
+{
+   const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+   switch (pickBelow(worker, 4))
+   {
+      case 0:
+         fx3_sendToMessageQueue(&boundedQueue, worker);
+         __atomic_add_fetch(&queueSent, 1, __ATOMIC_RELAXED);
+         break;
+
+      case 1:
+         if (fx3_sendToMessageQueueWithTimeout(&boundedQueue, worker, timeout_ms))
+         {
+            __atomic_add_fetch(&queueSent, 1, __ATOMIC_RELAXED);
+         }
+         else
+         {
+            CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+         }
+         break;
+
+      case 2:
+         if (fx3_trySendToMessageQueue(&boundedQueue, worker))
+         {
+            __atomic_add_fetch(&queueSent, 1, __ATOMIC_RELAXED);
+         }
+         else
+         {
+            __atomic_add_fetch(&queueRejected, 1, __ATOMIC_RELAXED);
+         }
+         break;
+
+      default:
+         posix_raiseInterrupt(STRESS_IRQ, sendFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+         break;
+   }
+}
+
+static void receiveFromQueue(struct worker_state* worker)
+{
+   void* msg = NULL;
+
+   if (pickBelow(worker, 2))
+   {
+      msg = fx3_tryReceiveFromMessageQueue(&boundedQueue);
+   }
+   else
+   {
+      const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+      const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+      msg = fx3_receiveFromMessageQueueWithTimeout(&boundedQueue, timeout_ms);
+      if (NULL == msg)
+      {
+         CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+      }
+   }
+
+   if (msg)
+   {
+      receivedFromQueue(msg);
+   }
+}
+
+static void notifyFromInterrupt(void)
+{
+   __atomic_add_fetch(&notificationsSent, 1, __ATOMIC_RELAXED);
+   fx3_notifyTask(&notificationCounterTCB, FX3_NOTIFY_INCREMENT, 1);
+}
+
+static void notify(struct worker_state* worker)
+{
+   switch (pickBelow(worker, 3))
+   {
+      case 0:
+         __atomic_add_fetch(&notificationsSent, 1, __ATOMIC_RELAXED);
+         fx3_notifyTask(&notificationCounterTCB, FX3_NOTIFY_INCREMENT, 1);
+         break;
+
+      case 1:
+         posix_raiseInterrupt(STRESS_IRQ, notifyFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+         break;
+
+      default:
+         // each worker waits for its own bit
+         {
+            const uint32_t peer = pickBelow(worker, WORKER_COUNT);
+            fx3_notifyTask(&workerTCB[peer], FX3_NOTIFY_SET_BITS, 1U << peer);
+         }
+         break;
+   }
+}
+
+static void waitForNotification(struct worker_state* worker)
+{
+   const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+   const uint32_t bit = 1U << worker->index;
+
+   const uint32_t notification = fx3_waitForNotificationWithTimeout(bit, timeout_ms);
+
+   if (0 == notification)
+   {
+      CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+   }
+   else
+   {
+      CHECK(bit == notification);
+   }
+}
+
+static void setEventsFromInterrupt(void)
+{
+   fx3_setEvents(&stressEvents, EVENT_ERROR);
+}
+
+static void setEvents(struct worker_state* worker)
+{
+   switch (pickBelow(worker, 4))
+   {
+      case 0:
+         fx3_setEvents(&stressEvents, EVENT_DATA);
+         break;
+
+      case 1:
+         fx3_setEvents(&stressEvents, EVENT_ERROR);
+         break;
+
+      case 2:
+         posix_raiseInterrupt(STRESS_IRQ, setEventsFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+         break;
+
+      default:
+         fx3_clearEvents(&stressEvents, 1U << pickBelow(worker, 2));
+         break;
+   }
+}
+
+/* Watch the flags without clearing them; the event waiter takes them
+ */
+static void waitForEvents(struct worker_state* worker)
+{
+   const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+   const uint32_t events = fx3_waitForEventsWithTimeout(&stressEvents, EVENT_BOTH, FX3_EVENTS_WAIT_ANY, timeout_ms);
+
+   if (0 == events)
+   {
+      CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+   }
+   else
+   {
+      CHECK(0 == (events & ~EVENT_BOTH));
+   }
+}
+
+static void signalSelectorFromInterrupt(void)
+{
+   __atomic_add_fetch(&selectSignalsSent, 1, __ATOMIC_RELAXED);
+   fx3_signalSemaphore(&selectSemaphore);
+   fx3_setEvents(&selectEvents, EVENT_DATA);
+}
+
+static void signalSelector(struct worker_state* worker)
+{
+   switch (pickBelow(worker, 3))
+   {
+      case 0:
+         __atomic_add_fetch(&selectSignalsSent, 1, __ATOMIC_RELAXED);
+         fx3_signalSemaphore(&selectSemaphore);
+         break;
+
+      case 1:
+         fx3_setEvents(&selectEvents, EVENT_DATA);
+         break;
+
+      default:
+         posix_raiseInterrupt(STRESS_IRQ, signalSelectorFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+         break;
+   }
+}
+
+static void waitWithTimeout(struct worker_state* worker)
+{
+   const uint32_t timeout_ms = 1 + pickBelow(worker, 5);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+   if (fx3_waitOnSemaphoreWithTimeout(&sharedSemaphore, timeout_ms))
+   {
+      __atomic_add_fetch(&consumedCount, 1, __ATOMIC_RELAXED);
+   }
+   else
+   {
+      CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(timeout_ms));
+   }
+}
+
+static void sendMessage(struct worker_state* worker)
+{
+   struct task_control_block* receiver = pickBelow(worker, 4) ? &sinkTCB : &selectorTCB;
+
+   for (uint32_t ii = 0; ii < MESSAGE_SLOTS; ii ++)
+   {
+      struct stress_message* msg = &worker->messages[ii];
+      if (! msg->inFlight)
+      {
+         msg->inFlight = true;
+         worker->messagesSent ++;
+         fx3_sendMessage(receiver, &msg->element);
+         return;
+      }
+   }
+}
+
+static void sleepAWhile(struct worker_state* worker)
+{
+   const uint32_t duration_ms = 1 + pickBelow(worker, 4);
+   const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+   fx3_suspendTask(duration_ms);
+
+   CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(duration_ms));
+}
+
+static void runWorker(const void* arg)
+{
+   struct worker_state* worker = (struct worker_state*) arg;
+
+   for (uint32_t round = 0; round < roundsPerWorker; round ++)
+   {
+      const enum stress_operation operation = (enum stress_operation) pickBelow(worker, OP_COUNT);
+
+      worker->operations[operation] ++;
+
+      switch (operation)
+      {
+         case OP_LOCK_MUTEX:
+            lockMutex(worker, false);
+            break;
+
+         case OP_TRY_LOCK_MUTEX:
+            lockMutex(worker, true);
+            break;
+
+         case OP_SIGNAL:
+            __atomic_add_fetch(&signalCount, 1, __ATOMIC_RELAXED);
+            fx3_signalSemaphore(&sharedSemaphore);
+            break;
+
+         case OP_WAIT_WITH_TIMEOUT:
+            waitWithTimeout(worker);
+            break;
+
+         case OP_TRY_WAIT:
+            if (fx3_tryWaitOnSemaphore(&sharedSemaphore))
+            {
+               __atomic_add_fetch(&consumedCount, 1, __ATOMIC_RELAXED);
+            }
+            break;
+
+         case OP_PRODUCE_ITEM:
+            produceItem(worker);
+            break;
+
+         case OP_CONSUME_ITEM:
+            consumeItem(worker);
+            break;
+
+         case OP_QUEUE_SEND:
+            sendToQueue(worker);
+            break;
+
+         case OP_QUEUE_RECEIVE:
+            receiveFromQueue(worker);
+            break;
+
+         case OP_NOTIFY:
+            notify(worker);
+            break;
+
+         case OP_WAIT_FOR_NOTIFICATION:
+            waitForNotification(worker);
+            break;
+
+         case OP_SET_EVENTS:
+            setEvents(worker);
+            break;
+
+         case OP_WAIT_FOR_EVENTS:
+            waitForEvents(worker);
+            break;
+
+         case OP_SIGNAL_SELECTOR:
+            signalSelector(worker);
+            break;
+
+         case OP_SEND_MESSAGE:
+            sendMessage(worker);
+            break;
+
+         case OP_SLEEP:
+            sleepAWhile(worker);
+            break;
+
+         case OP_RAISE_INTERRUPT:
+            posix_raiseInterrupt(STRESS_IRQ, signalFromInterrupt, pickBelow(worker, MAX_WORK_CYCLES));
+            break;
+
+         case OP_WORK:
+         default:
+            work(worker);
+            break;
+      }
+   }
+
+   fx3_signalSemaphore(&workersDone);
+
+   while (true)
+   {
+      fx3_suspendTask(1000);
+   }
+}
+
+static void runSink(const void* arg)
+{
+   (void) arg;
+
+   for (uint32_t round = 0; true; round ++)
+   {
+      struct list_element* element = NULL;
+      uint32_t batchSize = 1;
+
+      // one at a time, in batches, and in batches with a linger
+      switch (round % 3)
+      {
+         case 0:
+            element = fx3_waitForMessage();
+            break;
+
+         case 1:
+            batchSize = fx3_waitForMessages(3, &element);
+            CHECK((batchSize >= 1) && (batchSize <= 3));
+            break;
+
+         default:
+            batchSize = fx3_waitForMessageBatch(2, MESSAGE_SLOTS, 2, &element);
+            CHECK((batchSize >= 1) && (batchSize <= MESSAGE_SLOTS));
+            break;
+      }
+
+      while (element)
+      {
+         struct stress_message* msg = (struct stress_message*) element;
+         element = element->next;
+
+         CHECK(msg->sender < WORKER_COUNT);
+         CHECK(msg->inFlight);
+         CHECK(batchSize);
+
+         workers[msg->sender].messagesReceived ++;
+         msg->inFlight = false;
+         batchSize --;
+      }
+
+      CHECK(0 == batchSize);
+   }
+}
+
+static void runConsumer(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_waitOnSemaphore(&sharedSemaphore);
+      __atomic_add_fetch(&consumedCount, 1, __ATOMIC_RELAXED);
+   }
+}
+
+static void runItemConsumer(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      fx3_lockMutex(&sharedMutex);
+
+      while (0 == itemCount)
+      {
+         fx3_waitOnConditionVariable(&itemsAvailable, &sharedMutex);
+      }
+
+      mutexHolders ++;
+      CHECK(1 == mutexHolders);
+
+      itemCount --;
+      itemsConsumed ++;
+
+      mutexHolders --;
+
+      fx3_unlockMutex(&sharedMutex);
+   }
+}
+
+static void runQueueDrain(const void* arg)
+{
+   (void) arg;
+
+   while (true)
+   {
+      receivedFromQueue(fx3_receiveFromMessageQueue(&boundedQueue));
+   }
+}
+
+static void runNotificationCounter(const void* arg)
+{
+   (void) arg;
+
+   for (uint32_t round = 0; true; round ++)
+   {
+      // the word is a counter; take all of it
+      const uint32_t count = (round & 1) ? fx3_waitForNotificationWithTimeout(UINT32_MAX, 3) : fx3_waitForNotification(UINT32_MAX);
+
+      __atomic_add_fetch(&notificationsTaken, count, __ATOMIC_RELAXED);
+   }
+}
+
+static void runEventWaiter(const void* arg)
+{
+   (void) arg;
+
+   for (uint32_t round = 0; true; round ++)
+   {
+      uint32_t events = 0;
+
+      // both flags, or either of them for a while
+      if (round & 1)
+      {
+         events = fx3_waitForEventsWithTimeout(&stressEvents, EVENT_BOTH, FX3_EVENTS_CLEAR_ON_EXIT, 3);
+         CHECK(0 == (events & ~EVENT_BOTH));
+      }
+      else
+      {
+         events = fx3_waitForEvents(&stressEvents, EVENT_BOTH, FX3_EVENTS_WAIT_ALL | FX3_EVENTS_CLEAR_ON_EXIT);
+         CHECK(EVENT_BOTH == events);
+      }
+
+      if (events)
+      {
+         eventWakeups ++;
+      }
+   }
+}
+
+static void runSelector(const void* arg)
+{
+   (void) arg;
+
+   struct fx3_select_entry entries[] =
+   {
+      { .type = FX3_SELECT_SEMAPHORE, .object = &selectSemaphore },
+      { .type = FX3_SELECT_INBOX },
+      { .type = FX3_SELECT_EVENTS, .object = &selectEvents, .eventFlags = EVENT_DATA, .eventOptions = FX3_EVENTS_CLEAR_ON_EXIT },
+   };
+   const uint32_t entryCount = sizeof(entries) / sizeof(entries[0]);
+
+   for (uint32_t round = 0; true; round ++)
+   {
+      const uint64_t start_ticks = bsp_getTimestamp64_ticks();
+
+      // forever, or for a periodic deadline
+      const uint32_t fired = (round & 1) ? fx3_selectWithTimeout(entries, entryCount, 2) : fx3_select(entries, entryCount);
+
+      switch (fired)
+      {
+         case 0:
+            __atomic_add_fetch(&selectSignalsTaken, 1, __ATOMIC_RELAXED);
+            break;
+
+         case 1:
+            {
+               // a message is queued, this does not block
+               struct stress_message* msg = (struct stress_message*) fx3_waitForMessage();
+
+               CHECK(msg->sender < WORKER_COUNT);
+               CHECK(msg->inFlight);
+
+               workers[msg->sender].messagesReceived ++;
+               msg->inFlight = false;
+               selectMessages ++;
+            }
+            break;
+
+         case 2:
+            CHECK(EVENT_DATA == entries[2].eventsTaken);
+            selectEventWakeups ++;
+            break;
+
+         case FX3_SELECT_TIMEOUT:
+            CHECK(round & 1);
+            CHECK(bsp_getTimestamp64_ticks() - start_ticks >= bsp_getTicksForMS(2));
+            selectTimeouts ++;
+            break;
+
+         default:
+            CHECK(false);
+            break;
+      }
+   }
+}
+
+static double getHostTime_s(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (double) now.tv_sec + 1e-9 * (double) now.tv_nsec;
+}
+
+static double startedAt_s;
+
+static void runChecker(const void* arg)
+{
+   (void) arg;
+
+   for (uint32_t ii = 0; ii < WORKER_COUNT; ii ++)
+   {
+      fx3_waitOnSemaphore(&workersDone);
+   }
+
+   // let the last interrupts, signals and messages through
+   fx3_suspendTask(100);
+
+   const double elapsed_s = getHostTime_s() - startedAt_s;
+
+   CHECK(0 == mutexHolders);
+   CHECK(protectedCounter == mutexAcquisitions);
+   CHECK(0 == sharedSemaphore.counter);
+   CHECK(signalCount == consumedCount);
+   CHECK(0 == itemCount);
+   CHECK(itemsProduced == itemsConsumed);
+   CHECK(queueSent == queueReceived);
+   CHECK(QUEUE_SLOTS == boundedQueue.freeSlots.counter);
+   CHECK(notificationsSent == notificationsTaken);
+
+   // the event waiter clears what it waits for, so it cannot be blocked with both flags set
+   CHECK(EVENT_BOTH != (fx3_getEvents(&stressEvents) & EVENT_BOTH));
+
+   // nor can the selecting task be blocked with one of its objects ready
+   CHECK(selectSignalsSent == selectSignalsTaken);
+   CHECK(0 == selectSemaphore.counter);
+   CHECK(0 == (fx3_getEvents(&selectEvents) & EVENT_DATA));
+
+   uint64_t operationCount = 0;
+
+   for (uint32_t ii = 0; ii < WORKER_COUNT; ii ++)
+   {
+      CHECK(workers[ii].messagesSent == workers[ii].messagesReceived);
+
+      for (uint32_t op = 0; op < OP_COUNT; op ++)
+      {
+         operationCount += workers[ii].operations[op];
+      }
+   }
+
+   struct posix_statistics stats;
+   posix_getStatistics(&stats);
+
+   struct fx3_command_statistics commandStats;
+   fx3_getCommandStatistics(&commandStats);
+
+   printf("%llu operations, %u signals, %u items, %llu mutex acquisitions in %llu ms of virtual time\n",
+         (unsigned long long) operationCount, signalCount, itemsProduced, (unsigned long long) mutexAcquisitions,
+         (unsigned long long) (bsp_getTimestamp64_ticks() / bsp_getTicksForMS(1)));
+   printf("%u sent to the bounded queue, %u rejected while full\n", queueSent, queueRejected);
+   printf("%u notifications counted, %u event group wake-ups\n", notificationsTaken, eventWakeups);
+   printf("select: %u signals, %u messages, %u events, %u timeouts\n",
+         selectSignalsTaken, selectMessages, selectEventWakeups, selectTimeouts);
+   printf("commands: %u of %u in flight at most, %u allocation failures, %u deferred requests\n",
+         commandStats.highWaterMark, commandStats.capacity, commandStats.allocationFailures, commandStats.deferredRequests);
+   printf("%llu context switches, %llu PendSV, %llu interrupts, %llu idle sleeps\n",
+         (unsigned long long) stats.contextSwitches, (unsigned long long) stats.pendSVCount,
+         (unsigned long long) stats.interruptCount, (unsigned long long) stats.idleSleeps);
+   printf("host: %.3f s, %.0f ns per context switch\n",
+         elapsed_s, stats.contextSwitches ? (1e9 * elapsed_s / (double) stats.contextSwitches) : 0.0);
+
+   if (failureCount)
+   {
+      printf("FAILED: %u checks\n", failureCount);
+      exit(EXIT_FAILURE);
+   }
+
+   printf("PASSED\n");
+   exit(EXIT_SUCCESS);
+}
+
+static uint8_t workerStack[WORKER_COUNT][256] __attribute__ ((aligned (16)));
+static uint8_t sinkStack[256] __attribute__ ((aligned (16)));
+static uint8_t consumerStack[256] __attribute__ ((aligned (16)));
+static uint8_t itemConsumerStack[256] __attribute__ ((aligned (16)));
+static uint8_t queueDrainStack[256] __attribute__ ((aligned (16)));
+static uint8_t notificationCounterStack[256] __attribute__ ((aligned (16)));
+static uint8_t eventWaiterStack[256] __attribute__ ((aligned (16)));
+static uint8_t selectorStack[256] __attribute__ ((aligned (16)));
+static uint8_t checkerStack[256] __attribute__ ((aligned (16)));
+
+/*
+ * Lower values are more urgent; the last two workers share a priority,
+ * and round-robin. The consumers drain the semaphore, the items and the
+ * bounded queue whenever all of them are blocked, so the waits with timeout sometimes
+ * succeed.
+ */
+static const uint32_t workerPriorities[WORKER_COUNT] = { 3, 4, 5, 6, 7, 7 };
+
+static struct task_config workerTaskConfig[WORKER_COUNT];
+
+static const struct task_config sinkTaskConfig =
+{
+   .name            = "Message Sink",
+   .handler         = runSink,
+   .argument        = NULL,
+   .priority        = 2,
+   .stackBase       = sinkStack,
+   .stackSize       = sizeof(sinkStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config consumerTaskConfig =
+{
+   .name            = "Semaphore Consumer",
+   .handler         = runConsumer,
+   .argument        = NULL,
+   .priority        = 8,
+   .stackBase       = consumerStack,
+   .stackSize       = sizeof(consumerStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config itemConsumerTaskConfig =
+{
+   .name            = "Item Consumer",
+   .handler         = runItemConsumer,
+   .argument        = NULL,
+   .priority        = 9,
+   .stackBase       = itemConsumerStack,
+   .stackSize       = sizeof(itemConsumerStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config queueDrainTaskConfig =
+{
+   .name            = "Queue Drain",
+   .handler         = runQueueDrain,
+   .argument        = NULL,
+   .priority        = 10,
+   .stackBase       = queueDrainStack,
+   .stackSize       = sizeof(queueDrainStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config notificationCounterTaskConfig =
+{
+   .name            = "Notification Counter",
+   .handler         = runNotificationCounter,
+   .argument        = NULL,
+   .priority        = 11,
+   .stackBase       = notificationCounterStack,
+   .stackSize       = sizeof(notificationCounterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config eventWaiterTaskConfig =
+{
+   .name            = "Event Waiter",
+   .handler         = runEventWaiter,
+   .argument        = NULL,
+   .priority        = 12,
+   .stackBase       = eventWaiterStack,
+   .stackSize       = sizeof(eventWaiterStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config selectorTaskConfig =
+{
+   .name            = "Selector",
+   .handler         = runSelector,
+   .argument        = NULL,
+   .priority        = 13,
+   .stackBase       = selectorStack,
+   .stackSize       = sizeof(selectorStack),
+   .timeSlice_ticks = 0,
+};
+
+static const struct task_config checkerTaskConfig =
+{
+   .name            = "Checker",
+   .handler         = runChecker,
+   .argument        = NULL,
+   .priority        = 14,
+   .stackBase       = checkerStack,
+   .stackSize       = sizeof(checkerStack),
+   .timeSlice_ticks = 0,
+};
+
+int main(void)
+{
+   bsp_initialize();
+
+   const char* seed   = getenv("FX3_STRESS_SEED");
+   const char* rounds = getenv("FX3_STRESS_ROUNDS");
+
+   const uint32_t seedValue = seed ? (uint32_t) strtoul(seed, NULL, 0) : 1;
+   if (rounds)
+   {
+      roundsPerWorker = (uint32_t) strtoul(rounds, NULL, 0);
+   }
+
+   printf("stress test: seed %u, %u rounds per worker\n", seedValue, roundsPerWorker);
+
+   fx3_initialize();
+
+   fx3_initializeMutex(&sharedMutex);
+   fx3_initializeSemaphore(&sharedSemaphore, 0);
+   fx3_initializeConditionVariable(&itemsAvailable);
+   fx3_initializeMessageQueue(&boundedQueue, boundedQueueSlots, QUEUE_SLOTS);
+   fx3_initializeEventGroup(&stressEvents, 0);
+   fx3_initializeSemaphore(&selectSemaphore, 0);
+   fx3_initializeEventGroup(&selectEvents, 0);
+   fx3_initializeSemaphore(&workersDone, 0);
+
+   for (uint32_t ii = 0; ii < WORKER_COUNT; ii ++)
+   {
+      struct worker_state* worker = &workers[ii];
+
+      worker->index  = ii;
+      worker->random = (seedValue + ii) * 2654435761U;      // Knuth's multiplicative hash, never 0 for small seeds
+      if (0 == worker->random)
+      {
+         worker->random = 1;
+      }
+
+      for (uint32_t jj = 0; jj < MESSAGE_SLOTS; jj ++)
+      {
+         worker->messages[jj].sender = ii;
+      }
+
+      workerTaskConfig[ii].name            = "Worker";
+      workerTaskConfig[ii].handler         = runWorker;
+      workerTaskConfig[ii].argument        = worker;
+      workerTaskConfig[ii].priority        = workerPriorities[ii];
+      workerTaskConfig[ii].stackBase       = workerStack[ii];
+      workerTaskConfig[ii].stackSize       = sizeof(workerStack[ii]);
+      workerTaskConfig[ii].timeSlice_ticks = (ii >= WORKER_COUNT - 2) ? bsp_getTicksForMS(2) : 0;
+
+      fx3_createTask(&workerTCB[ii], &workerTaskConfig[ii]);
+   }
+
+   fx3_createTask(&sinkTCB, &sinkTaskConfig);
+   fx3_createTask(&consumerTCB, &consumerTaskConfig);
+   fx3_createTask(&itemConsumerTCB, &itemConsumerTaskConfig);
+   fx3_createTask(&queueDrainTCB, &queueDrainTaskConfig);
+   fx3_createTask(&notificationCounterTCB, &notificationCounterTaskConfig);
+   fx3_createTask(&eventWaiterTCB, &eventWaiterTaskConfig);
+   fx3_createTask(&selectorTCB, &selectorTaskConfig);
+   fx3_createTask(&checkerTCB, &checkerTaskConfig);
+
+   startedAt_s = getHostTime_s();
+
+   fx3_startMultitasking();
+
+   // never reached
+   assert(false);
+
+   return 0;
+}
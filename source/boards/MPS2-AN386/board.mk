@@ -0,0 +1,37 @@
+#
+# Board: ARM MPS2+ with the AN386 (Cortex-M4) FPGA image
+# https://developer.arm.com/documentation/dai0386/latest/
+#
+# Emulated by QEMU as "mps2-an386"; the console is UART0:
+#
+#    qemu-system-arm -M mps2-an386 -nographic -kernel app.elf
+#
+
+BOARD_MPS2_AN386_MCU:=CMSDK_CM4
+
+BOARD_MPS2_AN386_DIR:=source/boards/MPS2-AN386
+
+BOARD_MPS2_AN386_INCLUDES:=\
+	-Isource/arch/inc \
+	-Isource/boards/inc \
+	-I$(BOARD_MPS2_AN386_DIR)/inc \
+	-I$(CHIP_MPS2_DIR)/inc \
+	-I$(CMSIS)/Include
+
+BOARD_MPS2_AN386_CFLAGS:=$(CHIP_MPS2_CFLAGS) -D$(BOARD_MPS2_AN386_MCU) -DMPS2_AN386
+BOARD_MPS2_AN386_AFLAGS:=$(CHIP_MPS2_AFLAGS) -D__HEAP_SIZE=1024
+BOARD_MPS2_AN386_LFLAGS:=$(CHIP_MPS2_LFLAGS) -T $(BOARD_MPS2_AN386_DIR)/linker/gcc/mps2_an386.ld
+
+BOARD_MPS2_AN386_C_VPATH:=\
+	$(CHIP_MPS2_C_VPATH) \
+	$(BOARD_MPS2_AN386_DIR)/src
+
+BOARD_MPS2_AN386_S_VPATH:=\
+	source/arch/cortex-m4/gcc \
+	$(BOARD_MPS2_AN386_DIR)/src/gcc
+
+BOARD_MPS2_AN386_OBJECTS:=\
+	$(CHIP_MPS2_OBJECTS) \
+	board_mps2_an386.o \
+	bitops.o \
+	startup_mps2_an386.o
@@ -0,0 +1,89 @@
+/**
+ * @file board_local.h
+ * @brief Board Support Package interface
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+
+#ifndef __BOARD_LOCAL_H__
+#define __BOARD_LOCAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <CMSDK_CM4.h>
+
+static inline uint32_t bsp_getTicksForMS(uint32_t time_ms)
+{
+   return time_ms;
+}
+
+extern volatile uint32_t lowClockBits;
+
+static inline uint32_t bsp_getTimestamp_ticks(void)
+{
+   return lowClockBits;
+}
+
+static inline uint32_t bsp_computeInterval_ticks(uint32_t start_ticks, uint32_t end_ticks)
+{
+   return end_ticks - start_ticks;     // intentional wrap-around
+}
+
+static inline void bsp_scheduleContextSwitch(void)
+{
+   SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk; // Set PendSV to pending
+   __ISB();
+}
+
+/*
+ * QEMU does not model the DWT, so count with the FPGA I/O counter, which
+ * runs at the core clock on both the board and the emulator.
+ */
+static inline uint32_t bsp_getCycleCount(void)
+{
+   return MPS2_FPGAIO->COUNTER;
+}
+
+enum BOARD_LED
+{
+   LED_ID_GREEN,
+   LED_ID_ORANGE,
+
+   LED_COUNT,
+
+   LED_ID_RED,
+   LED_ID_BLUE,
+};
+
+struct USARTHandle
+{
+   CMSDK_UART_TypeDef*        uart;
+};
+
+#define CONSOLE_USART usart0
+
+extern struct USARTHandle usart0;
+
+/// Not wired to any peripheral in use; for software-triggered interrupts
+#define SPARE_IRQn            TIMER1_IRQn
+#define SPARE_IRQHandler      TIMER1_IRQHandler
+
+#endif // __BOARD_LOCAL_H__
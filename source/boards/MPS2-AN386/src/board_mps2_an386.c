@@ -0,0 +1,81 @@
+/**
+ * @file board_mps2_an386.c
+ * @brief Board Support Package implementation for MPS2 with AN386
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+
+#include <stdbool.h>
+
+#include <board.h>
+
+#include <mps2_chp.h>
+
+struct USARTHandle usart0;
+
+static void initializeUART(void)
+{
+   usart0.uart = CMSDK_UART0;
+}
+
+void bsp_initialize(void)
+{
+   chp_initialize();
+
+   NVIC_SetPriority(PendSV_IRQn, 0xFF); // Set PendSV to lowest possible priority
+
+   MPS2_FPGAIO->LED0 = 0;
+
+   initializeUART();
+}
+
+void bsp_delay(uint32_t count)
+{
+   volatile uint32_t todo = 0;
+   while (count)
+   {
+      todo = count;
+      count --;
+   }
+}
+
+void bsp_turnOnLED(uint32_t ledId)
+{
+   if (LED_COUNT > ledId)
+   {
+      MPS2_FPGAIO->LED0 |= (1 << ledId);
+   }
+}
+
+void bsp_turnOffLED(uint32_t ledId)
+{
+   if (LED_COUNT > ledId)
+   {
+      MPS2_FPGAIO->LED0 &= ~(1 << ledId);
+   }
+}
+
+void bsp_toggleLED(uint32_t ledId)
+{
+   if (LED_COUNT > ledId)
+   {
+      MPS2_FPGAIO->LED0 ^= (1 << ledId);
+   }
+}
@@ -0,0 +1,232 @@
+/**
+ * @file board_local.h
+ * @brief Board Support Package interface, simulated on a POSIX host
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __BOARD_LOCAL_H__
+#define __BOARD_LOCAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef FX3_MPU_STACK_GUARD
+#error "FX3_MPU_STACK_GUARD needs a Cortex-M MPU; the POSIX port has none"
+#endif
+
+/*
+ * The simulated processor: a single core with one interrupt mask, where
+ * handlers run to completion and do not nest. Only the subset of CMSIS
+ * used by the kernel is provided.
+ */
+
+/// Core clock of the simulated processor
+#define POSIX_CYCLES_PER_MS      168000U
+
+/// One tick per millisecond, as on the Kinetis boards
+#define POSIX_CYCLES_PER_TICK    POSIX_CYCLES_PER_MS
+
+#define __NVIC_PRIO_BITS         4
+
+typedef enum
+{
+   SVCall_IRQn    = -5,
+   PendSV_IRQn    = -2,
+   SysTick_IRQn   = -1,
+} IRQn_Type;
+
+struct posix_cpu
+{
+   /// 1 while interrupts are disabled
+   volatile uint32_t primask;
+
+   /// Exception being handled, 0 in thread mode
+   volatile uint32_t ipsr;
+};
+
+extern struct posix_cpu posixCPU;
+
+/** Take the interrupts that are due, and PendSV, if not masked
+ */
+void posix_serviceInterrupts(void);
+
+static inline void __disable_irq(void)
+{
+   posixCPU.primask = 1;
+}
+
+static inline void __enable_irq(void)
+{
+   posixCPU.primask = 0;
+   posix_serviceInterrupts();
+}
+
+static inline uint32_t __get_PRIMASK(void)
+{
+   return posixCPU.primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+   posixCPU.primask = primask;
+   if (! primask)
+   {
+      posix_serviceInterrupts();
+   }
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+   return posixCPU.ipsr;
+}
+
+static inline void __DSB(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __ISB(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __DMB(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type irq);
+
+/*
+ * The DWT cycle counter follows the virtual clock
+ */
+typedef struct
+{
+   volatile uint32_t CTRL;
+   volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+   volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type posixDWT;
+extern CoreDebug_Type posixCoreDebug;
+
+#define DWT                         (&posixDWT)
+#define CoreDebug                   (&posixCoreDebug)
+
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+static inline uint32_t bsp_getCycleCount(void)
+{
+   return DWT->CYCCNT;
+}
+
+/*
+ * Virtual time: it only moves when the simulated code consumes cycles
+ * (posix_consumeCycles, bsp_delay) or sleeps in the idle task, which
+ * skips ahead to the next alarm.
+ */
+extern volatile uint64_t posixClock_cycles;
+extern volatile uint64_t posixClock_ticks;
+
+static inline uint32_t bsp_getTicksForMS(uint32_t time_ms)
+{
+   return time_ms;
+}
+
+static inline uint32_t bsp_getTimestamp_ticks(void)
+{
+   return (uint32_t) posixClock_ticks;
+}
+
+static inline uint32_t bsp_computeInterval_ticks(uint32_t start_ticks, uint32_t end_ticks)
+{
+   return end_ticks - start_ticks;     // intentional wrap-around
+}
+
+/** Pend PendSV; it is taken right away unless masked or in a handler
+ */
+void posix_pendSV(void);
+
+static inline void bsp_scheduleContextSwitch(void)
+{
+   posix_pendSV();
+}
+
+enum BOARD_LED
+{
+   LED_ID_GREEN,
+   LED_ID_ORANGE,
+   LED_ID_RED,
+   LED_ID_BLUE,
+
+   LED_COUNT,
+};
+
+/*
+ * Simulation controls, for the applications built for the host
+ */
+
+/** Create the host context a task starts in, replacing the initial
+ * Cortex-M exception frame; the kernel keeps it in the stack pointer.
+ *
+ * @param handler is the task entry point
+ * @param argument is passed to the handler
+ * @return the context, opaque to the kernel
+ */
+uint32_t* posix_createTaskContext(void (* handler)(const void* arg), const void* argument);
+
+/** Simulate code running for a while; the interrupts due in the mean
+ * time are taken, and may switch to other tasks, as on the target.
+ *
+ * @param cycles is the duration, in core clock cycles
+ */
+void posix_consumeCycles(uint64_t cycles);
+
+/** Raise an interrupt after a delay
+ *
+ * @param irq is the interrupt number, reported by __get_IPSR as irq + 16
+ * @param handler is the interrupt handler
+ * @param delay_cycles is the delay, in core clock cycles
+ * @return false if too many interrupts are pending
+ */
+bool posix_raiseInterrupt(uint32_t irq, void (* handler)(void), uint64_t delay_cycles);
+
+/** Statistics of the simulation
+ */
+struct posix_statistics
+{
+   uint64_t contextSwitches;
+   uint64_t pendSVCount;
+   uint64_t interruptCount;
+   uint64_t idleSleeps;
+};
+
+void posix_getStatistics(struct posix_statistics* stats);
+
+/** Number of times this LED was turned on or off
+ */
+uint32_t posix_getLEDChanges(uint32_t ledId);
+
+#endif // __BOARD_LOCAL_H__
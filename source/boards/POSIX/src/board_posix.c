@@ -0,0 +1,657 @@
+/**
+ * @file board_posix.c
+ * @brief Board Support Package implementation, simulated on a POSIX host
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+/*
+ * The simulated processor runs every task on its own host stack, in a
+ * ucontext; PendSV is a function call followed by swapcontext. Only one
+ * context runs at a time, so the kernel sees the same interleavings as
+ * on a single Cortex-M core, just at the points where the simulation
+ * takes interrupts: whenever they get unmasked, and when virtual time
+ * moves.
+ *
+ * Environment:
+ *    FX3_POSIX_DURATION_MS   end the simulation after this much virtual time
+ *    FX3_POSIX_VERBOSE       log the LED changes
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include <board.h>
+
+#include <task.h>
+#include <task_priv.h>
+
+#include <fx3_config.h>
+
+#define POSIX_TASK_STACK_SIZE          (256 * 1024)
+
+#define POSIX_MAX_PENDING_INTERRUPTS   16
+
+#define PENDSV_EXCEPTION               14
+#define SYSTICK_EXCEPTION              15
+
+/// All exceptions, except PendSV, get the most urgent priority
+#define PENDSV_PRIORITY                ((1U << __NVIC_PRIO_BITS) - 1)
+
+extern struct task_control_block* runningTask;
+extern struct task_control_block* nextRunningTask;
+
+bool fx3_processPendingCommands(void);
+
+struct posix_cpu posixCPU;
+
+DWT_Type posixDWT;
+CoreDebug_Type posixCoreDebug;
+
+volatile uint64_t posixClock_cycles;
+volatile uint64_t posixClock_ticks;
+
+struct posix_task_context
+{
+   ucontext_t context;
+
+   void (* handler)(const void* arg);
+   const void* argument;
+};
+
+struct posix_alarm
+{
+   bool requested;
+   uint64_t at_ticks;
+};
+
+struct posix_interrupt
+{
+   void (* handler)(void);
+   uint32_t irq;
+   uint64_t at_cycles;
+};
+
+static struct posix_alarm wakeupAlarm;
+static struct posix_alarm roundRobinAlarm;
+static struct posix_alarm debounceAlarm;
+
+static bool systemTimerEnabled;
+
+static bool pendSVPending;
+
+static struct posix_interrupt pendingInterrupts[POSIX_MAX_PENDING_INTERRUPTS];
+static uint32_t pendingInterruptCount;
+
+static uint64_t endOfSimulation_cycles;
+
+static bool verbose;
+
+static bool ledState[LED_COUNT];
+static uint32_t ledChanges[LED_COUNT];
+
+static struct posix_statistics statistics;
+
+/*
+ * System
+ */
+
+void bsp_initialize(void)
+{
+   memset(&posixCPU, 0, sizeof(posixCPU));
+
+   posixClock_cycles = 0;
+   posixClock_ticks  = 0;
+
+   pendSVPending         = false;
+   pendingInterruptCount = 0;
+   systemTimerEnabled    = true;
+
+   endOfSimulation_cycles = UINT64_MAX;
+
+   const char* duration = getenv("FX3_POSIX_DURATION_MS");
+   if (duration)
+   {
+      endOfSimulation_cycles = strtoull(duration, NULL, 0) * POSIX_CYCLES_PER_MS;
+   }
+
+   verbose = (NULL != getenv("FX3_POSIX_VERBOSE"));
+
+   memset(ledState, 0, sizeof(ledState));
+   memset(ledChanges, 0, sizeof(ledChanges));
+   memset(&statistics, 0, sizeof(statistics));
+}
+
+void bsp_reset(void)
+{
+   exit(EXIT_FAILURE);
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type irq)
+{
+   return (PendSV_IRQn == irq) ? PENDSV_PRIORITY : 0;
+}
+
+static void endSimulation(void)
+{
+   printf("simulation ended after %llu ms: %llu context switches, %llu PendSV, %llu interrupts\n",
+         (unsigned long long) (posixClock_cycles / POSIX_CYCLES_PER_MS),
+         (unsigned long long) statistics.contextSwitches,
+         (unsigned long long) statistics.pendSVCount,
+         (unsigned long long) statistics.interruptCount);
+
+   exit(EXIT_SUCCESS);
+}
+
+/*
+ * Virtual clock
+ */
+
+/* The first time after now when the low 32 bits match the timestamp, as
+ * the timer compare does it on the target
+ */
+static uint64_t computeAlarmTime_ticks(uint32_t timestamp_ticks)
+{
+   uint64_t at_ticks = (posixClock_ticks & ~(uint64_t) UINT32_MAX) | timestamp_ticks;
+   if (at_ticks <= posixClock_ticks)
+   {
+      at_ticks += ((uint64_t) UINT32_MAX) + 1;
+   }
+   return at_ticks;
+}
+
+static inline bool isAlarmDue(const struct posix_alarm* alarm)
+{
+   return alarm->requested && (alarm->at_ticks <= posixClock_ticks);
+}
+
+static inline uint64_t minimum(uint64_t left, uint64_t right)
+{
+   return (left < right) ? left : right;
+}
+
+/* When the next alarm or interrupt is due, after the given time, in
+ * cycles; UINT64_MAX if none
+ */
+static uint64_t computeNextEvent_cycles(uint64_t after_cycles)
+{
+   uint64_t next_cycles = UINT64_MAX;
+
+   const struct posix_alarm* alarms[] = { &wakeupAlarm, &roundRobinAlarm, &debounceAlarm };
+
+   for (uint32_t ii = 0; ii < sizeof(alarms) / sizeof(alarms[0]); ii ++)
+   {
+      const uint64_t at_cycles = alarms[ii]->at_ticks * POSIX_CYCLES_PER_TICK;
+      if (alarms[ii]->requested && (at_cycles > after_cycles))
+      {
+         next_cycles = minimum(next_cycles, at_cycles);
+      }
+   }
+
+   for (uint32_t ii = 0; ii < pendingInterruptCount; ii ++)
+   {
+      if (pendingInterrupts[ii].at_cycles > after_cycles)
+      {
+         next_cycles = minimum(next_cycles, pendingInterrupts[ii].at_cycles);
+      }
+   }
+
+   return next_cycles;
+}
+
+static void setClock(uint64_t now_cycles)
+{
+   if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+   {
+      DWT->CYCCNT += (uint32_t) (now_cycles - posixClock_cycles);
+   }
+
+   posixClock_cycles = now_cycles;
+   posixClock_ticks  = now_cycles / POSIX_CYCLES_PER_TICK;
+
+   if (posixClock_cycles >= endOfSimulation_cycles)
+   {
+      endSimulation();
+   }
+}
+
+/* Move the clock, stopping at each event on the way to take it
+ */
+static void advanceClock(uint64_t until_cycles)
+{
+   while (posixClock_cycles < until_cycles)
+   {
+      // the events already due are masked; they are taken once unmasked
+      const uint64_t next_cycles = computeNextEvent_cycles(posixClock_cycles);
+
+      setClock(minimum(minimum(next_cycles, until_cycles), endOfSimulation_cycles));
+
+      posix_serviceInterrupts();
+   }
+}
+
+void posix_consumeCycles(uint64_t cycles)
+{
+   advanceClock(posixClock_cycles + cycles);
+}
+
+void bsp_delay(uint32_t loops)
+{
+   // about 4 cycles per iteration, on the target
+   posix_consumeCycles(4 * (uint64_t) loops);
+}
+
+void bsp_startMainClock(void)
+{
+   wakeupAlarm.requested     = false;
+   roundRobinAlarm.requested = false;
+   debounceAlarm.requested   = false;
+
+   setClock(0);
+}
+
+uint64_t bsp_getTimestamp64_ticks(void)
+{
+   return posixClock_ticks;
+}
+
+void bsp_sleep(void)
+{
+   bsp_sleep_ticks(UINT32_MAX);
+}
+
+uint32_t bsp_sleep_ticks(uint32_t duration_ticks)
+{
+   statistics.idleSleeps ++;
+
+   const uint64_t start_ticks = posixClock_ticks;
+
+   const uint64_t next_cycles = minimum(computeNextEvent_cycles(posixClock_cycles), endOfSimulation_cycles);
+   if (UINT64_MAX == next_cycles)
+   {
+      fprintf(stderr, "FX3 simulation: all tasks are blocked, and no alarm is pending\n");
+      exit(EXIT_FAILURE);
+   }
+
+   const uint64_t until_cycles = minimum(next_cycles, (start_ticks + duration_ticks) * POSIX_CYCLES_PER_TICK);
+   if (until_cycles > posixClock_cycles)
+   {
+      advanceClock(until_cycles);
+   }
+   else
+   {
+      posix_serviceInterrupts();
+   }
+
+   return (uint32_t) (posixClock_ticks - start_ticks);
+}
+
+/*
+ * Interrupts
+ */
+
+static inline void enterHandler(uint32_t exceptionNumber)
+{
+   posixCPU.ipsr = exceptionNumber;
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   if (PENDSV_EXCEPTION != exceptionNumber)
+   {
+      bsp_onInterruptEntered();
+   }
+#endif
+}
+
+static inline void exitHandler(void)
+{
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   if (PENDSV_EXCEPTION != posixCPU.ipsr)
+   {
+      bsp_onInterruptExited();
+   }
+#endif
+
+   posixCPU.ipsr = 0;
+}
+
+static void takeSystemTimerInterrupt(void)
+{
+   statistics.interruptCount ++;
+
+   enterHandler(SYSTICK_EXCEPTION);
+
+   if (isAlarmDue(&wakeupAlarm))
+   {
+      wakeupAlarm.requested = false;
+      bsp_onWokenUp();
+   }
+
+   if (isAlarmDue(&roundRobinAlarm))
+   {
+      roundRobinAlarm.requested = false;
+      bsp_onRoundRobinSliceTimeout();
+   }
+
+   if (isAlarmDue(&debounceAlarm))
+   {
+      debounceAlarm.requested = false;
+      bsp_onDebounceIntervalTimeout();
+   }
+
+   exitHandler();
+}
+
+static bool takeExternalInterrupt(void)
+{
+   for (uint32_t ii = 0; ii < pendingInterruptCount; ii ++)
+   {
+      if (pendingInterrupts[ii].at_cycles <= posixClock_cycles)
+      {
+         const struct posix_interrupt interrupt = pendingInterrupts[ii];
+
+         pendingInterruptCount --;
+         pendingInterrupts[ii] = pendingInterrupts[pendingInterruptCount];
+
+         statistics.interruptCount ++;
+
+         enterHandler(interrupt.irq + 16);
+         interrupt.handler();
+         exitHandler();
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static inline struct posix_task_context* getTaskContext(struct task_control_block* tcb)
+{
+   return (struct posix_task_context*) tcb->stackPointer;
+}
+
+static void takePendSV(void)
+{
+   pendSVPending = false;
+   statistics.pendSVCount ++;
+
+   enterHandler(PENDSV_EXCEPTION);
+   const bool contextSwitchNeeded = fx3_processPendingCommands();
+   exitHandler();
+
+   if (contextSwitchNeeded)
+   {
+      struct task_control_block* previousTask = runningTask;
+
+      runningTask = nextRunningTask;
+
+      if (previousTask != runningTask)
+      {
+         statistics.contextSwitches ++;
+
+         // returns when the previous task is switched back in
+         swapcontext(&getTaskContext(previousTask)->context, &getTaskContext(runningTask)->context);
+      }
+   }
+}
+
+void posix_serviceInterrupts(void)
+{
+   // handlers do not nest; they are taken on return to thread mode
+   if (posixCPU.primask || posixCPU.ipsr)
+   {
+      return;
+   }
+
+   while (true)
+   {
+      if (systemTimerEnabled && (isAlarmDue(&wakeupAlarm) || isAlarmDue(&roundRobinAlarm) || isAlarmDue(&debounceAlarm)))
+      {
+         takeSystemTimerInterrupt();
+         continue;
+      }
+
+      if (takeExternalInterrupt())
+      {
+         continue;
+      }
+
+      if (! pendSVPending)
+      {
+         break;
+      }
+
+      // PendSV has the lowest priority, it is taken last
+      takePendSV();
+   }
+}
+
+void posix_pendSV(void)
+{
+   pendSVPending = true;
+   posix_serviceInterrupts();
+}
+
+bool posix_raiseInterrupt(uint32_t irq, void (* handler)(void), uint64_t delay_cycles)
+{
+   if (POSIX_MAX_PENDING_INTERRUPTS == pendingInterruptCount)
+   {
+      return false;
+   }
+
+   pendingInterrupts[pendingInterruptCount].handler   = handler;
+   pendingInterrupts[pendingInterruptCount].irq       = irq;
+   pendingInterrupts[pendingInterruptCount].at_cycles = posixClock_cycles + delay_cycles;
+   pendingInterruptCount ++;
+
+   if (0 == delay_cycles)
+   {
+      posix_serviceInterrupts();
+   }
+
+   return true;
+}
+
+void posix_getStatistics(struct posix_statistics* stats)
+{
+   *stats = statistics;
+}
+
+/*
+ * Tasks
+ */
+
+static void runTask(void)
+{
+   const struct posix_task_context* taskContext = getTaskContext(runningTask);
+
+   // tasks start from PendSV, with interrupts enabled
+   posixCPU.primask = 0;
+   posix_serviceInterrupts();
+
+   taskContext->handler(taskContext->argument);
+
+   fprintf(stderr, "FX3 simulation: task \"%s\" returned\n", runningTask->config->name);
+   abort();
+}
+
+uint32_t* posix_createTaskContext(void (* handler)(const void* arg), const void* argument)
+{
+   struct posix_task_context* taskContext = calloc(1, sizeof(*taskContext));
+   void* stack = malloc(POSIX_TASK_STACK_SIZE);
+
+   if ((NULL == taskContext) || (NULL == stack) || (0 != getcontext(&taskContext->context)))
+   {
+      fprintf(stderr, "FX3 simulation: cannot create task context\n");
+      abort();
+   }
+
+   taskContext->handler  = handler;
+   taskContext->argument = argument;
+
+   taskContext->context.uc_stack.ss_sp   = stack;
+   taskContext->context.uc_stack.ss_size = POSIX_TASK_STACK_SIZE;
+   taskContext->context.uc_link          = NULL;
+
+   makecontext(&taskContext->context, runTask, 0);
+
+   return (uint32_t*) taskContext;
+}
+
+void fx3_startMultitaskingImpl(uint32_t taskPSP, void (* handler)(const void* arg), const void* arg)
+{
+   (void) taskPSP;
+   (void) handler;
+   (void) arg;
+
+   setcontext(&getTaskContext(runningTask)->context);
+
+   fprintf(stderr, "FX3 simulation: cannot start the first task\n");
+   abort();
+}
+
+/*
+ * Timers
+ */
+
+void bsp_disableSystemTimer(void)
+{
+   systemTimerEnabled = false;
+}
+
+void bsp_enableSystemTimer(void)
+{
+   systemTimerEnabled = true;
+   posix_serviceInterrupts();
+}
+
+void bsp_wakeUpAt_ticks(uint32_t timestamp_ticks)
+{
+   wakeupAlarm.at_ticks  = computeAlarmTime_ticks(timestamp_ticks);
+   wakeupAlarm.requested = true;
+}
+
+void bsp_requestRoundRobinSliceTimeout_ticks(uint32_t timestamp_ticks)
+{
+   roundRobinAlarm.at_ticks  = computeAlarmTime_ticks(timestamp_ticks);
+   roundRobinAlarm.requested = true;
+}
+
+void bsp_cancelRoundRobinSliceTimeout(void)
+{
+   roundRobinAlarm.requested = false;
+}
+
+void bsp_requestDebounceTimeout_ticks(uint32_t timestamp_ticks)
+{
+   debounceAlarm.at_ticks  = computeAlarmTime_ticks(timestamp_ticks);
+   debounceAlarm.requested = true;
+}
+
+void bsp_cancelDebounceTimeout(void)
+{
+   debounceAlarm.requested = false;
+}
+
+bool __attribute__((weak)) bsp_onDebounceIntervalTimeout(void)
+{
+   return false;
+}
+
+/*
+ * Output
+ */
+
+static void setLED(uint32_t ledId, bool on)
+{
+   assert(ledId < LED_COUNT);
+
+   if (ledState[ledId] != on)
+   {
+      ledState[ledId] = on;
+      ledChanges[ledId] ++;
+
+      if (verbose)
+      {
+         printf("%10llu ms: LED %u %s\n", (unsigned long long) (posixClock_cycles / POSIX_CYCLES_PER_MS), ledId, on ? "on" : "off");
+      }
+   }
+}
+
+void bsp_turnOnLED(uint32_t ledId)
+{
+   setLED(ledId, true);
+}
+
+void bsp_turnOffLED(uint32_t ledId)
+{
+   setLED(ledId, false);
+}
+
+void bsp_toggleLED(uint32_t ledId)
+{
+   assert(ledId < LED_COUNT);
+
+   setLED(ledId, ! ledState[ledId]);
+}
+
+uint32_t posix_getLEDChanges(uint32_t ledId)
+{
+   assert(ledId < LED_COUNT);
+
+   return ledChanges[ledId];
+}
+
+void bsp_initializeOutputPin(uint32_t outputPin)
+{
+   (void) outputPin;
+}
+
+void bsp_setOutputPin(uint32_t outputPin, bool high)
+{
+   (void) outputPin;
+   (void) high;
+}
+
+/*
+ * Input
+ */
+
+bool bsp_getInputState(uint32_t inputPin)
+{
+   (void) inputPin;
+
+   return false;
+}
+
+void bsp_requestNotificationForInputChange(uint32_t inputPin)
+{
+   (void) inputPin;
+}
+
+void bsp_enableInputStateNotifications(void)
+{
+}
+
+void bsp_disableInputStateNotifications(void)
+{
+}
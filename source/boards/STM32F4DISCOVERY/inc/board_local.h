@@ -45,20 +45,11 @@ static inline uint32_t bsp_getTimestamp_ticks(void)
 
 static inline uint32_t bsp_computeInterval_ticks(uint32_t start_ticks, uint32_t end_ticks)
 {
-   uint32_t duration_ticks = 0;
-   if (end_ticks >= start_ticks)
-   {
-      duration_ticks = end_ticks - start_ticks;
-   }
-   else
-   {
 #ifdef TEST_TIMER_WRAP
-      duration_ticks = (0x10000 + end_ticks) - start_ticks;
+   return (end_ticks - start_ticks) & 0xffff;
 #else
-      duration_ticks = end_ticks + 1 + (0xffffffff - start_ticks);
+   return end_ticks - start_ticks;     // intentional wrap-around
 #endif
-   }
-   return duration_ticks;
 }
 
 static inline void bsp_scheduleContextSwitch(void)
@@ -67,15 +58,9 @@ static inline void bsp_scheduleContextSwitch(void)
    __ISB();
 }
 
-static inline bool bsp_computeWakeUp_ticks(uint32_t duration_ticks, uint32_t* wakeupAt_ticks)
+static inline uint32_t bsp_getCycleCount(void)
 {
-   uint32_t timestamp_ticks = bsp_getTimestamp_ticks();
-#ifdef TEST_TIMER_WRAP
-   *wakeupAt_ticks = (timestamp_ticks + duration_ticks) & 0xffff;
-#else
-   *wakeupAt_ticks = (timestamp_ticks + duration_ticks);
-#endif
-   return *wakeupAt_ticks < timestamp_ticks;
+   return DWT->CYCCNT;
 }
 
 enum BOARD_LED
@@ -130,6 +115,13 @@ struct USARTHandle
 
 #define CONSOLE_USART usart2
 
+extern struct USARTHandle usart1;
+extern struct USARTHandle usart2;
+
+/// Not wired to any peripheral in use; for software-triggered interrupts
+#define SPARE_IRQn            TIM7_IRQn
+#define SPARE_IRQHandler      TIM7_IRQHandler
+
 struct I2CHandle
 {
    I2C_HandleTypeDef          hi2c;
@@ -137,7 +129,7 @@ struct I2CHandle
    IRQn_Type                  evIRQ;
    IRQn_Type                  erIRQ;
 
-   struct semaphore           isAvailable;
+   struct mutex               busMutex;
 };
 
 #define MPU_6050_BUS    i2c2
@@ -148,7 +140,7 @@ struct SPIBus
 {
    SPI_HandleTypeDef          halHandle;
 
-   struct semaphore           isAvailable;
+   struct mutex               busMutex;
 };
 
 #define EN25F80_BUS           spiBus2
@@ -355,6 +355,10 @@ void bsp_initialize(void)
 
    NVIC_SetPriority(PendSV_IRQn, 0xFF); // Set PendSV to lowest possible priority
 
+   // start the cycle counter, for bsp_getCycleCount
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
    initializeMainClock();
 
    initializeLEDs();
@@ -34,7 +34,7 @@ static inline uint32_t bsp_getTicksForMS(uint32_t time_ms)
    return time_ms;
 }
 
-extern uint32_t lowClockBits;
+extern volatile uint32_t lowClockBits;
 
 static inline uint32_t bsp_getTimestamp_ticks(void)
 {
@@ -43,16 +43,7 @@ static inline uint32_t bsp_getTimestamp_ticks(void)
 
 static inline uint32_t bsp_computeInterval_ticks(uint32_t start_ticks, uint32_t end_ticks)
 {
-   uint32_t duration_ticks = 0;
-   if (end_ticks >= start_ticks)
-   {
-      duration_ticks = end_ticks - start_ticks;
-   }
-   else
-   {
-      duration_ticks = end_ticks + 1 + (0xffffffff - start_ticks);
-   }
-   return duration_ticks;
+   return end_ticks - start_ticks;     // intentional wrap-around
 }
 
 static inline void bsp_scheduleContextSwitch(void)
@@ -60,10 +51,9 @@ static inline void bsp_scheduleContextSwitch(void)
    SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk; // Set PendSV to pending
 }
 
-static inline bool bsp_computeWakeUp_ticks(uint32_t duration_ticks, uint32_t* wakeupAt_ticks)
+static inline uint32_t bsp_getCycleCount(void)
 {
-   *wakeupAt_ticks = (lowClockBits + duration_ticks);    // intentional wrap-around
-   return *wakeupAt_ticks < lowClockBits;
+   return DWT->CYCCNT;
 }
 
 enum BOARD_LED
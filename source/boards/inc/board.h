@@ -48,6 +48,15 @@ void bsp_sleep(void);
 // busy-loop
 void bsp_delay(uint32_t loops);
 
+/** Called by interrupt handlers on entry and on exit, so the kernel
+ * can charge their cycles to the interrupts (FX3_CPU_ACCOUNTING) and
+ * trace them (FX3_TRACE)
+ *
+ * @note nests, and may be called with interrupts enabled
+ */
+void bsp_onInterruptEntered(void);
+void bsp_onInterruptExited(void);
+
 /**
  * @}
  */
@@ -99,9 +108,30 @@ void bsp_disableInputStateNotifications(void);
 
 //uint32_t bsp_getTimestamp_ticks(void);
 
+/*
+ * Free-running core clock cycle counter, for measurements; the kernel
+ * timestamps FX3_TRACE records and accounts FX3_CPU_ACCOUNTING time with
+ * it, so every board provides it, from the DWT where the core has one.
+ */
+//uint32_t bsp_getCycleCount(void);
+
+/** Monotonic timestamp; the low 32 bits match bsp_getTimestamp_ticks
+ *
+ * All kernel deadlines are absolute values of this clock, which does not
+ * wrap in the lifetime of the device, so they compare without epochs.
+ *
+ * @note lock-free; can be called from task and interrupt context, at any
+ *       priority, and with interrupts disabled
+ */
 uint64_t bsp_getTimestamp64_ticks(void);
 
-/** "Blocks" until wakeup.
+/** "Blocks" until wakeup, without taking the system timer interrupts
+ * in between (tickless idle); the clock is compensated on wakeup.
+ *
+ * The sleep also ends at the next alarm, round-robin timeout or other
+ * interrupt.
+ *
+ * @note available with FX3_TICKLESS_IDLE, on the SysTick timer
  *
  * @param duration how much to sleep, in ticks
  * @return duration slept (less than input, if other interrupt)
@@ -120,6 +150,9 @@ void bsp_enableSystemTimer(void);
 
 
 /** Schedule a wake-up alarm at the given timestamp.
+ *
+ * The alarm fires when the low bits of the timestamp match, so a deadline
+ * in the next epoch is valid; the previous alarm, if any, is replaced.
  *
  * @param timestamp_ticks indicates when to call bsp_onWokenUp
  */
@@ -127,14 +160,13 @@ void bsp_wakeUpAt_ticks(uint32_t timestamp_ticks);
 
 /** Called by BSP on alarm
  *
+ * @note spurious calls are harmless; the kernel only wakes up the tasks that are due
  */
 bool bsp_onWokenUp(void);
 
-// Event
-bool bsp_onEpochRollover(void);
-
 /*
- * Round-robin support
+ * Round-robin support; like the wake-up alarm, the timeout is given as
+ * the low 32 bits of the bsp_getTimestamp64_ticks deadline.
  */
 void bsp_requestRoundRobinSliceTimeout_ticks(uint32_t timestamp_ticks);
 
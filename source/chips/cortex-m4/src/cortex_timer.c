@@ -24,13 +24,18 @@
 #include <board.h>
 #include <board_local.h>
 
+#include <fx3_config.h>
+
 #ifdef FX3_RTT_TRACE
 #include <SEGGER_SYSVIEW.h>
 #undef CAN_SLEEP_UNDER_DEBUGGER
 #endif
 
-uint32_t highClockBits;
-uint32_t lowClockBits;
+volatile uint32_t highClockBits;
+volatile uint32_t lowClockBits;
+
+/// Number of SysTick interrupts taken; with FX3_TICKLESS_IDLE, fewer than ticks elapsed
+volatile uint32_t systemTimerInterrupts;
 
 static bool wakeupRequested;
 static bool roundRobinRequested;
@@ -38,21 +43,47 @@ static bool roundRobinRequested;
 static uint32_t wakeupAt_ticks;
 static uint32_t roundRobinAt_ticks;
 
+/* Account for the ticks that elapsed since the last update
+ *
+ * The two halves are only written together on a carry, with interrupts
+ * masked, so a reader preempting this sees either the old or the new
+ * timestamp; a reader preempted by this re-reads.
+ */
+static void advanceClock(uint32_t elapsed_ticks)
+{
+   const uint32_t lowBits = lowClockBits + elapsed_ticks;
+
+   if (lowBits >= lowClockBits)
+   {
+      lowClockBits = lowBits;
+   }
+   else
+   {
+      const uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+
+      highClockBits ++;
+      lowClockBits = lowBits;
+
+      __set_PRIMASK(primask);
+   }
+}
+
 void SysTick_Handler(void)
 {
 #ifdef FX3_RTT_TRACE
    SEGGER_SYSVIEW_RecordEnterISR();
 #endif
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
    bool returnToScheduler = false;
 
-   lowClockBits ++;
-   if (0 == lowClockBits)
-   {
-      highClockBits ++;
+   systemTimerInterrupts ++;
 
-      returnToScheduler |= bsp_onEpochRollover();
-   }
+   advanceClock(1);
 
    if (wakeupRequested)
    {
@@ -76,6 +107,10 @@ void SysTick_Handler(void)
       }
    }
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+
 #ifdef FX3_RTT_TRACE
    if (returnToScheduler)
    {
@@ -88,8 +123,31 @@ void SysTick_Handler(void)
 #endif
 }
 
+uint64_t bsp_getTimestamp64_ticks(void)
+{
+   uint32_t upperBits;
+   uint32_t lowerBits;
+
+   // lock-free: re-read until SysTick did not carry into the high bits in between
+   do
+   {
+      upperBits = highClockBits;
+      lowerBits = lowClockBits;
+   }
+   while (upperBits != highClockBits);
+
+   return (((uint64_t) upperBits) << 32) | lowerBits;
+}
+
 extern uint32_t SystemCoreClock;
 
+#ifdef FX3_TICKLESS_IDLE
+static uint32_t cyclesPerTick;
+
+/// Longest stretch SysTick can count in one period
+static uint32_t maxSuppressedTicks;
+#endif
+
 void bsp_startMainClock(void)
 {
    wakeupRequested = false;
@@ -101,9 +159,131 @@ void bsp_startMainClock(void)
    highClockBits = 0;
    lowClockBits = 0;
 
+#ifdef FX3_TICKLESS_IDLE
+   cyclesPerTick      = SystemCoreClock / 1000;
+   maxSuppressedTicks = SysTick_LOAD_RELOAD_Msk / cyclesPerTick;
+#endif
+
    SysTick_Config(SystemCoreClock / 1000);         // 1 ms tick
 }
 
+#ifdef FX3_TICKLESS_IDLE
+
+static inline uint32_t minimum(uint32_t left, uint32_t right)
+{
+   return (left < right) ? left : right;
+}
+
+
+/* Restart SysTick for a partial tick, followed by regular ticks
+ */
+static void restartSystemTimer(uint32_t firstPeriod_cycles)
+{
+   SysTick->LOAD  = firstPeriod_cycles - 1;
+   SysTick->VAL   = 0;
+   SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+   // takes effect at the next reload, the first one has been latched
+   SysTick->LOAD  = cyclesPerTick - 1;
+}
+
+uint32_t bsp_sleep_ticks(uint32_t duration_ticks)
+{
+   __disable_irq();
+
+   /*
+    * Sleep until the tick before the next alarm, at most; SysTick_Handler
+    * takes the last tick itself, so it still sees the alarm match. An
+    * alarm at the current tick was already missed, and is a full epoch
+    * away, as it is when ticking.
+    */
+   uint32_t idle_ticks = minimum(duration_ticks, maxSuppressedTicks);
+
+   if (wakeupRequested && (wakeupAt_ticks != lowClockBits))
+   {
+      idle_ticks = minimum(idle_ticks, wakeupAt_ticks - lowClockBits);
+   }
+
+   if (roundRobinRequested && (roundRobinAt_ticks != lowClockBits))
+   {
+      idle_ticks = minimum(idle_ticks, roundRobinAt_ticks - lowClockBits);
+   }
+
+   if ((idle_ticks < 2) || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+   {
+      // not worth reprogramming the timer
+      __WFI();
+      __enable_irq();
+      return 0;
+   }
+
+   SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+   if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+   {
+      // the current tick ended while stopping the timer
+      restartSystemTimer(cyclesPerTick);
+      __enable_irq();
+      return 0;
+   }
+
+   // cycles left in the current tick, then whole ticks
+   const uint32_t firstTick_cycles = SysTick->VAL ? SysTick->VAL : cyclesPerTick;
+   const uint32_t idle_cycles      = firstTick_cycles + (idle_ticks - 1) * cyclesPerTick;
+
+   SysTick->LOAD  = idle_cycles - 1;
+   SysTick->VAL   = 0;
+   SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+   __DSB();
+   __WFI();
+   __ISB();
+
+   SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+   uint32_t slept_ticks = 0;
+
+   if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+   {
+      /*
+       * Slept the whole stretch; the pending SysTick interrupt accounts for
+       * the last tick. The counter reloaded, count what ran since.
+       */
+      const uint32_t sinceReload_cycles = (idle_cycles - 1) - SysTick->VAL;
+
+      slept_ticks = idle_ticks - 1;
+
+      restartSystemTimer((sinceReload_cycles < cyclesPerTick) ? (cyclesPerTick - sinceReload_cycles) : cyclesPerTick);
+   }
+   else
+   {
+      // woken up early by another interrupt; resume ticking on the tick boundary
+      const uint32_t elapsed_cycles = (idle_cycles - 1) - SysTick->VAL;
+
+      if (elapsed_cycles < firstTick_cycles)
+      {
+         restartSystemTimer(firstTick_cycles - elapsed_cycles);
+      }
+      else
+      {
+         const uint32_t wholeTicks_cycles = elapsed_cycles - firstTick_cycles;
+
+         // the first tick, and the whole ones after it
+         slept_ticks = 1 + wholeTicks_cycles / cyclesPerTick;
+
+         restartSystemTimer(cyclesPerTick - (wholeTicks_cycles % cyclesPerTick));
+      }
+   }
+
+   advanceClock(slept_ticks);
+
+   __enable_irq();
+
+   return slept_ticks;
+}
+
+#endif // FX3_TICKLESS_IDLE
+
 void bsp_wakeUpAt_ticks(uint32_t timestamp_ticks)
 {
    wakeupAt_ticks  = timestamp_ticks;
@@ -32,11 +32,6 @@
 #undef CAN_SLEEP_UNDER_DEBUGGER
 #endif
 
-uint64_t bsp_getTimestamp64_ticks(void)
-{
-   return 0;   // TODO
-}
-
 static bool runningUnderDebugger;
 
 void chp_initialize(void)
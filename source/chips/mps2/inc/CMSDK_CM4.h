@@ -0,0 +1,123 @@
+/**
+ * @file CMSDK_CM4.h
+ * @brief Device header for the Cortex-M4 MPS2 FPGA images (AN386)
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __CMSDK_CM4_H__
+#define __CMSDK_CM4_H__
+
+#include <stdint.h>
+
+/*
+ * Only the subset used by FX3 is described: the interrupt map, the UARTs
+ * and the FPGA I/O block. See ARM Application Note AN386.
+ */
+
+typedef enum IRQn
+{
+   NonMaskableInt_IRQn     = -14,
+   HardFault_IRQn          = -13,
+   MemoryManagement_IRQn   = -12,
+   BusFault_IRQn           = -11,
+   UsageFault_IRQn         = -10,
+   SVCall_IRQn             = -5,
+   DebugMonitor_IRQn       = -4,
+   PendSV_IRQn             = -2,
+   SysTick_IRQn            = -1,
+
+   UART0RX_IRQn            = 0,
+   UART0TX_IRQn            = 1,
+   UART1RX_IRQn            = 2,
+   UART1TX_IRQn            = 3,
+   UART2RX_IRQn            = 4,
+   UART2TX_IRQn            = 5,
+   GPIO0ALL_IRQn           = 6,
+   GPIO1ALL_IRQn           = 7,
+   TIMER0_IRQn             = 8,
+   TIMER1_IRQn             = 9,
+   DUALTIMER_IRQn          = 10,
+   SPI_0_1_IRQn            = 11,
+   UART_0_1_2_OVF_IRQn     = 12,
+   ETHERNET_IRQn           = 13,
+   I2S_IRQn                = 14,
+   TOUCHSCREEN_IRQn        = 15,
+   GPIO2_IRQn              = 16,
+   GPIO3_IRQn              = 17,
+   UART3RX_IRQn            = 18,
+   UART3TX_IRQn            = 19,
+   UART4RX_IRQn            = 20,
+   UART4TX_IRQn            = 21,
+   SPI_2_IRQn              = 22,
+   SPI_3_4_IRQn            = 23,
+} IRQn_Type;
+
+#define __CM4_REV                0x0001
+#define __MPU_PRESENT            1
+#define __NVIC_PRIO_BITS         3
+#define __Vendor_SysTickConfig   0
+#define __FPU_PRESENT            1
+
+#include <core_cm4.h>
+
+typedef struct
+{
+   __IO uint32_t  DATA;          /// received / transmitted byte
+   __IO uint32_t  STATE;         /// transmit and receive buffer status
+   __IO uint32_t  CTRL;          /// enables
+   __IO uint32_t  INTSTATUS;     /// interrupt status; write 1 to clear
+   __IO uint32_t  BAUDDIV;       /// main clock divider, at least 16
+} CMSDK_UART_TypeDef;
+
+#define CMSDK_UART_STATE_TXBF_Msk      (1UL << 0)
+#define CMSDK_UART_STATE_RXBF_Msk      (1UL << 1)
+#define CMSDK_UART_STATE_TXOR_Msk      (1UL << 2)
+#define CMSDK_UART_STATE_RXOR_Msk      (1UL << 3)
+
+#define CMSDK_UART_CTRL_TXEN_Msk       (1UL << 0)
+#define CMSDK_UART_CTRL_RXEN_Msk       (1UL << 1)
+
+typedef struct
+{
+   __IO uint32_t  LED0;          /// user LEDs, one bit each
+   uint32_t       RESERVED0[1];
+   __I  uint32_t  BUTTON;        /// user push buttons
+   uint32_t       RESERVED1[1];
+   __I  uint32_t  CLK1HZ;
+   __I  uint32_t  CLK100HZ;
+   __I  uint32_t  COUNTER;       /// free-running, at the main clock
+} MPS2_FPGAIO_TypeDef;
+
+#define CMSDK_UART0_BASE         (0x40004000UL)
+#define CMSDK_UART1_BASE         (0x40005000UL)
+#define CMSDK_UART2_BASE         (0x40006000UL)
+#define MPS2_FPGAIO_BASE         (0x40028000UL)
+
+#define CMSDK_UART0              ((CMSDK_UART_TypeDef*) CMSDK_UART0_BASE)
+#define CMSDK_UART1              ((CMSDK_UART_TypeDef*) CMSDK_UART1_BASE)
+#define CMSDK_UART2              ((CMSDK_UART_TypeDef*) CMSDK_UART2_BASE)
+#define MPS2_FPGAIO              ((MPS2_FPGAIO_TypeDef*) MPS2_FPGAIO_BASE)
+
+/// The FPGA images clock the core and the peripherals at 25 MHz
+#define MPS2_MAIN_CLOCK_HZ       25000000U
+
+extern uint32_t SystemCoreClock;
+
+#endif // __CMSDK_CM4_H__
@@ -0,0 +1,146 @@
+/**
+ * @file cmsdk_driver_usart.c
+ * @brief Polled USART driver for the CMSDK APB UART
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <stdbool.h>
+
+#include <usart.h>
+
+#include <board.h>
+#include <board_local.h>
+
+#include <task.h>
+
+/*
+ * The CMSDK UART buffers one byte each way and has no DMA, so the driver
+ * polls: the writer spins until each byte is taken, and the reader checks
+ * the receive buffer once per tick. It is meant for a console, or for
+ * QEMU, where the transmitter is never busy.
+ */
+
+enum Status usart_initialize(struct USARTHandle* handle, const struct USARTConfiguration* config)
+{
+   if ((0 == config->baudRate) ||
+       (USART_FLOW_CONTROL_NONE != config->flowControl) ||
+       (8 != config->bits) ||
+       (USART_PARITY_NONE != config->parity) ||
+       (1 != config->stopBits))
+   {
+      return STATUS_NOT_SUPPORTED;
+   }
+
+   uint32_t divider = SystemCoreClock / config->baudRate;
+   if (divider < 16)
+   {
+      return STATUS_INVALID_ARGUMENT;
+   }
+
+   handle->uart->CTRL      = 0;
+   handle->uart->BAUDDIV   = divider;
+   handle->uart->INTSTATUS = handle->uart->INTSTATUS;
+   handle->uart->CTRL      = CMSDK_UART_CTRL_TXEN_Msk | CMSDK_UART_CTRL_RXEN_Msk;
+
+   return STATUS_OK;
+}
+
+enum Status usart_flushInput(struct USARTHandle* handle)
+{
+   while (handle->uart->STATE & CMSDK_UART_STATE_RXBF_Msk)
+   {
+      (void) handle->uart->DATA;
+   }
+
+   return STATUS_OK;
+}
+
+enum Status usart_read(struct USARTHandle* handle, uint8_t* buffer, uint32_t bufferSize, uint32_t* bytesRead)
+{
+   *bytesRead = 0;
+
+   while ((*bytesRead < bufferSize) && (handle->uart->STATE & CMSDK_UART_STATE_RXBF_Msk))
+   {
+      buffer[*bytesRead] = (uint8_t) handle->uart->DATA;
+      (*bytesRead) ++;
+   }
+
+   return STATUS_OK;
+}
+
+enum Status usart_waitForReadable(struct USARTHandle* handle, uint32_t* bytesAvailable)
+{
+   while (! (handle->uart->STATE & CMSDK_UART_STATE_RXBF_Msk))
+   {
+      fx3_suspendTask(1);
+   }
+
+   *bytesAvailable = 1;
+
+   return STATUS_OK;
+}
+
+enum Status usart_waitForReadableWithTimeout(struct USARTHandle* handle, uint32_t timeout_ms, uint32_t* bytesAvailable)
+{
+   uint32_t waited_ms = 0;
+
+   while (! (handle->uart->STATE & CMSDK_UART_STATE_RXBF_Msk))
+   {
+      if (waited_ms >= timeout_ms)
+      {
+         *bytesAvailable = 0;
+         return STATUS_TIMEOUT;
+      }
+
+      fx3_suspendTask(1);
+      waited_ms ++;
+   }
+
+   *bytesAvailable = 1;
+
+   return STATUS_OK;
+}
+
+enum Status usart_write(struct USARTHandle* handle, const uint8_t* buffer, uint32_t bufferSize, uint32_t* bytesWritten)
+{
+   for (uint32_t ii = 0; ii < bufferSize; ii ++)
+   {
+      while (handle->uart->STATE & CMSDK_UART_STATE_TXBF_Msk)
+      {
+         // the transmitter takes a byte every ten bit times
+      }
+
+      handle->uart->DATA = buffer[ii];
+   }
+
+   *bytesWritten = bufferSize;
+
+   return STATUS_OK;
+}
+
+enum Status usart_waitForWriteComplete(struct USARTHandle* handle)
+{
+   while (handle->uart->STATE & CMSDK_UART_STATE_TXBF_Msk)
+   {
+      // wait for the last byte
+   }
+
+   return STATUS_OK;
+}
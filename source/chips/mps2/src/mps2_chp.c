@@ -0,0 +1,77 @@
+/**
+ * @file mps2_chp.c
+ * @brief Chip support for the Cortex-M4 MPS2 FPGA images
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <board.h>
+#include <board_local.h>
+#include <mps2_chp.h>
+
+uint32_t SystemCoreClock = MPS2_MAIN_CLOCK_HZ;
+
+/*
+ * Called by the startup code, before the data is initialized. The FPGA
+ * image has a fixed clock, so there are no PLLs to configure.
+ */
+void SystemInit(void)
+{
+   // full access to the FPU (CP10 and CP11)
+   SCB->CPACR |= (3UL << 20) | (3UL << 22);
+
+   SCB->VTOR = 0;
+}
+
+static bool runningUnderDebugger;
+
+void chp_initialize(void)
+{
+   SCB->CCR |= SCB_CCR_STKALIGN_Msk  // Enable double word stack alignment
+                                     // (recommended in Cortex-M3 r1p1, default in Cortex-M3 r2px and Cortex-M4)
+         ;
+
+   // enable all fault types
+   SCB->SHCSR |=
+      SCB_SHCSR_USGFAULTENA_Msk |
+      SCB_SHCSR_BUSFAULTENA_Msk |
+      SCB_SHCSR_MEMFAULTENA_Msk;
+
+   runningUnderDebugger = (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk);
+}
+
+void bsp_sleep(void)
+{
+   __WFI();
+}
+
+__attribute__((noreturn)) void bsp_reset(void)
+{
+   if (runningUnderDebugger)
+   {
+      __BKPT(0x42);
+   }
+
+   NVIC_SystemReset();
+
+   while (true)
+   {
+      __NOP();
+   }
+}
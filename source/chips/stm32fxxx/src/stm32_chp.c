@@ -27,6 +27,8 @@
 #include <board_local.h>
 #include <stm32_chp.h>
 
+#include <fx3_config.h>
+
 #ifdef FX3_RTT_TRACE
 #include <SEGGER_SYSVIEW.h>
 #undef CAN_SLEEP_UNDER_DEBUGGER
@@ -36,10 +38,33 @@ static volatile uint32_t clockUpperBits;
 
 uint64_t bsp_getTimestamp64_ticks(void)
 {
-   uint64_t now = clockUpperBits;
-   now <<= 31;
-   now |= (TIM2->CNT >> 1);
-   return now;
+   uint32_t upperBits;
+   uint32_t lowerBits;
+   bool     updatePending;
+
+   /*
+    * Lock-free: re-read until the upper bits are stable. If the caller
+    * masks or preempts the TIM2 interrupt, an update event can be pending:
+    * count it if the counter was read after it wrapped.
+    */
+   do
+   {
+      upperBits     = clockUpperBits;
+      lowerBits     = TIM2->CNT;
+      updatePending = (TIM2->SR & TIM_SR_UIF) && (lowerBits < (TIM2->ARR >> 1));
+   }
+   while (upperBits != clockUpperBits);
+
+   if (updatePending)
+   {
+      upperBits ++;
+   }
+
+#ifdef TEST_TIMER_WRAP
+   return (((uint64_t) upperBits) << 16) | lowerBits;
+#else
+   return (((uint64_t) upperBits) << 32) | lowerBits;
+#endif
 }
 
 static bool runningUnderDebugger;
@@ -131,15 +156,24 @@ void bsp_wakeUpAt_ticks(uint32_t timestamp_ticks)
 {
    wakeupRequestedAt = bsp_getTimestamp_ticks();
    wakeupRequested   = timestamp_ticks;
-   assert(wakeupRequested > wakeupRequestedAt);
 
+#ifdef TEST_TIMER_WRAP
+   TIM2->CCR1  = timestamp_ticks & 0xffff;
+#else
    TIM2->CCR1  = timestamp_ticks;
+#endif
+   // drop a stale match from a previous compare value
+   TIM2->SR    = ~TIM_SR_CC1IF;
    TIM2->DIER |= TIM_DIER_CC1IE;
 }
 
 void bsp_requestRoundRobinSliceTimeout_ticks(uint32_t timestamp_ticks)
 {
+#ifdef TEST_TIMER_WRAP
+   TIM2->CCR2  = timestamp_ticks & 0xffff;
+#else
    TIM2->CCR2  = timestamp_ticks;
+#endif
    TIM2->DIER |= TIM_DIER_CC2IE;
 }
 
@@ -150,7 +184,11 @@ void bsp_cancelRoundRobinSliceTimeout(void)
 
 void bsp_requestDebounceTimeout_ticks(uint32_t timestamp_ticks)
 {
+#ifdef TEST_TIMER_WRAP
+   TIM2->CCR3  = timestamp_ticks & 0xffff;
+#else
    TIM2->CCR3  = timestamp_ticks;
+#endif
    TIM2->DIER |= TIM_DIER_CC3IE;
 }
 
@@ -192,6 +230,10 @@ void TIM2_IRQHandler(void)
    SEGGER_SYSVIEW_RecordEnterISR();
 #endif
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
    bool returnToScheduler = false;
 
    bool handled = false;
@@ -248,20 +290,35 @@ void TIM2_IRQHandler(void)
 
    if ((TIM2->SR & TIM_SR_UIF))
    {
-      TIM2->SR = ~TIM_SR_UIF;
-
-      if ((TIM2->DIER & TIM_DIER_UIE))
+      /*
+       * Count the epoch and acknowledge the update as one step, so a
+       * higher priority handler reading the clock in between sees either
+       * the pending update or the new upper bits, never neither.
+       */
+      const uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+
+      const bool countEpoch = (TIM2->DIER & TIM_DIER_UIE);
+      if (countEpoch)
       {
          clockUpperBits ++;
+      }
+      TIM2->SR = ~TIM_SR_UIF;
 
-         returnToScheduler |= bsp_onEpochRollover();
+      __set_PRIMASK(primask);
 
+      if (countEpoch)
+      {
          handled = true;
       }
    }
 
    assert(handled);
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+
 #ifdef FX3_RTT_TRACE
    if (returnToScheduler)
    {
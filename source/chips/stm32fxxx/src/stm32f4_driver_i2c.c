@@ -54,7 +54,7 @@ void i2c_initialize(struct I2CHandle* handle, const struct I2CConfiguration* con
       assert(false);
    }
 
-   fx3_initializeSemaphore(&handle->isAvailable, 1);
+   fx3_initializeMutex(&handle->busMutex);
 
 #if 0
    HAL_NVIC_SetPriority(handle->erIRQ, 1, 0);
@@ -66,12 +66,12 @@ void i2c_initialize(struct I2CHandle* handle, const struct I2CConfiguration* con
 
 void i2c_acquireBus(struct I2CHandle* handle)
 {
-   fx3_waitOnSemaphore(&handle->isAvailable);
+   fx3_lockMutex(&handle->busMutex);
 }
 
 void i2c_releaseBus(struct I2CHandle* handle)
 {
-   fx3_signalSemaphore(&handle->isAvailable);
+   fx3_unlockMutex(&handle->busMutex);
 }
 
 enum Status i2c_readRegisters(struct I2CHandle* handle, uint16_t deviceAddress, uint16_t registerAddress, uint8_t* buffer, uint16_t bufferSize, uint16_t* bytesReceived)
@@ -27,6 +27,8 @@
 #include <board.h>
 #include <board_local.h>
 
+#include <fx3_config.h>
+
 #ifdef FX3_RTT_TRACE
 #include <SEGGER_SYSVIEW.h>
 #endif
@@ -67,6 +69,10 @@ void EXTI0_IRQHandler(void)
    SEGGER_SYSVIEW_RecordEnterISR();
 #endif
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
    if ((EXTI->PR & GPIO_PIN_0))
    {
       EXTI->PR = GPIO_PIN_0;
@@ -75,6 +81,10 @@ void EXTI0_IRQHandler(void)
       bsp_onInputStateChanged(PIN('A', 0), PA0_status);
    }
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+
 #ifdef FX3_RTT_TRACE
    // we send a message that will wake-up the debouncing task
    SEGGER_SYSVIEW_RecordExitISRToScheduler();
@@ -87,6 +97,10 @@ void EXTI1_IRQHandler(void)
    SEGGER_SYSVIEW_RecordEnterISR();
 #endif
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
    if ((EXTI->PR & GPIO_PIN_1))
    {
       EXTI->PR = GPIO_PIN_1;
@@ -95,6 +109,10 @@ void EXTI1_IRQHandler(void)
       bsp_onInputStateChanged(PIN('C', 1), PC1_status);
    }
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+
 #ifdef FX3_RTT_TRACE
    // we send a message that will wake-up the debouncing task
    SEGGER_SYSVIEW_RecordExitISRToScheduler();
@@ -111,6 +129,10 @@ void EXTI2_IRQHandler(void)
    SEGGER_SYSVIEW_RecordEnterISR();
 #endif
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptEntered();
+#endif
+
    if ((EXTI->PR & GPIO_PIN_2))
    {
       EXTI->PR = GPIO_PIN_2;
@@ -119,6 +141,10 @@ void EXTI2_IRQHandler(void)
       bsp_onInputStateChanged(PIN('C', 2), PC2_status);
    }
 
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   bsp_onInterruptExited();
+#endif
+
 #ifdef FX3_RTT_TRACE
    // we send a message that will wake-up the debouncing task
    SEGGER_SYSVIEW_RecordExitISRToScheduler();
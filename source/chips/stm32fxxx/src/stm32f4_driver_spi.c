@@ -32,7 +32,7 @@ void spi_initialize(struct SPIBus* bus, const struct SPIConfiguration* config)
 {
    (void) config;
 
-   fx3_initializeSemaphore(&bus->isAvailable, 1);
+   fx3_initializeMutex(&bus->busMutex);
 
    SPI_HandleTypeDef* handle = &bus->halHandle;
 
@@ -54,7 +54,7 @@ void spi_initialize(struct SPIBus* bus, const struct SPIConfiguration* config)
 
 enum Status spi_reserveBus(struct SPIBus* bus, bool polarity, bool phase)
 {
-   fx3_waitOnSemaphore(&bus->isAvailable);
+   fx3_lockMutex(&bus->busMutex);
 
    SPI_HandleTypeDef* handle = &bus->halHandle;
 
@@ -100,13 +100,13 @@ enum Status spi_reserveBus(struct SPIBus* bus, bool polarity, bool phase)
 
 failed:
 
-   fx3_signalSemaphore(&bus->isAvailable);
+   fx3_unlockMutex(&bus->busMutex);
    return STATUS_HARDWARE_CONFIGURATION_FAILED;
 }
 
 enum Status spi_releaseBus(struct SPIBus* bus)
 {
-   fx3_signalSemaphore(&bus->isAvailable);
+   fx3_unlockMutex(&bus->busMutex);
 
    return STATUS_OK;
 }
@@ -168,6 +168,18 @@ enum Status usart_read(struct USARTHandle* handle, uint8_t* buffer, uint32_t buf
    return STATUS_OK;
 }
 
+static void computeBytesAvailable(struct USARTHandle* handle, uint32_t* bytesAvailable)
+{
+   if (handle->receiveBuffer.head < handle->receiveBuffer.tail)
+   {
+      *bytesAvailable = handle->receiveBuffer.tail - handle->receiveBuffer.head;
+   }
+   else
+   {
+      *bytesAvailable = handle->receiveBuffer.size + handle->receiveBuffer.head - handle->receiveBuffer.tail - 1;
+   }
+}
+
 enum Status usart_waitForReadable(struct USARTHandle* handle, uint32_t* bytesAvailable)
 {
    if (handle->receiveBuffer.tail == handle->receiveBuffer.head)
@@ -177,15 +189,27 @@ enum Status usart_waitForReadable(struct USARTHandle* handle, uint32_t* bytesAva
       fx3_waitOnSemaphore(&handle->receiveBufferNotEmpty);
    }
 
-   if (handle->receiveBuffer.head < handle->receiveBuffer.tail)
-   {
-      *bytesAvailable = handle->receiveBuffer.tail - handle->receiveBuffer.head;
-   }
-   else
+   computeBytesAvailable(handle, bytesAvailable);
+
+   return STATUS_OK;
+}
+
+enum Status usart_waitForReadableWithTimeout(struct USARTHandle* handle, uint32_t timeout_ms, uint32_t* bytesAvailable)
+{
+   if (handle->receiveBuffer.tail == handle->receiveBuffer.head)
    {
-      *bytesAvailable = handle->receiveBuffer.size + handle->receiveBuffer.head - handle->receiveBuffer.tail - 1;
+      handle->readerIsWaiting = true;
+
+      if (! fx3_waitOnSemaphoreWithTimeout(&handle->receiveBufferNotEmpty, timeout_ms))
+      {
+         handle->readerIsWaiting = false;
+         *bytesAvailable = 0;
+         return STATUS_TIMEOUT;
+      }
    }
 
+   computeBytesAvailable(handle, bytesAvailable);
+
    return STATUS_OK;
 }
 
@@ -348,9 +348,8 @@ static void debounceInputs(const void* arg __attribute__((unused)))
 
       if (debouncePeriods)
       {
-         uint32_t debounceDeadline = 0;
-         bsp_computeWakeUp_ticks(DEBOUNCE_INTERVAL_MS, &debounceDeadline);
-         bsp_requestDebounceTimeout_ticks(debounceDeadline);
+         const uint64_t debounceDeadline_ticks = bsp_getTimestamp64_ticks() + DEBOUNCE_INTERVAL_MS;
+         bsp_requestDebounceTimeout_ticks((uint32_t) debounceDeadline_ticks);
       }
       else
       {
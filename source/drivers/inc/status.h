@@ -34,6 +34,7 @@ enum Status
    STATUS_FULL,
    STATUS_COMMUNICATION_FAILED,
    STATUS_HARDWARE_CONFIGURATION_FAILED,
+   STATUS_TIMEOUT,
 };
 
 #endif // __STATUS_H__
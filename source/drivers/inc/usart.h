@@ -65,6 +65,8 @@ enum Status usart_flushInput(struct USARTHandle* handle);
 
 enum Status usart_waitForReadable(struct USARTHandle* handle, uint32_t* bytesAvailable);
 
+enum Status usart_waitForReadableWithTimeout(struct USARTHandle* handle, uint32_t timeout_ms, uint32_t* bytesAvailable);
+
 enum Status usart_read(struct USARTHandle* handle, uint8_t* buffer, uint32_t bufferSize, uint32_t* bytesRead);
 
 
@@ -25,13 +25,18 @@
 #define __SYNCHRONIZATION_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include <list_utils.h>
+#include <pairing_heap.h>
 
 /** @defgroup FX3_Synchronization Synchronization
  * Synchronization primitives for FX3
  * @{
  */
 
-struct list_element;
+struct task_control_block;
+struct fx3_select_entry;
 
 struct semaphore
 {
@@ -39,7 +44,11 @@ struct semaphore
 
    volatile struct list_element* antechamber;
 
-   struct task_control_block* waitList;
+   /// Waiting tasks, highest priority first
+   struct pairing_heap waitQueue;
+
+   /// The task selecting on this semaphore, if any
+   struct fx3_select_entry* volatile selector;
 };
 
 /** Initialize this semaphore
@@ -57,6 +66,24 @@ void fx3_initializeSemaphore(struct semaphore* sem, uint32_t count);
  */
 uint32_t fx3_waitOnSemaphore(struct semaphore* sem);
 
+/** Wait for this semaphore, for a limited time; block this thread
+ * until the semaphore is signaled or the timeout expires
+ *
+ * @param sem is the semaphore
+ * @param timeout_ms is the maximum amount of time to wait
+ * @return true if the semaphore was acquired, false on timeout
+ */
+bool fx3_waitOnSemaphoreWithTimeout(struct semaphore* sem, uint32_t timeout_ms);
+
+/** Acquire this semaphore if it is available, without blocking
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param sem is the semaphore
+ * @return true if the semaphore was acquired
+ */
+bool fx3_tryWaitOnSemaphore(struct semaphore* sem);
+
 /** Signal this semaphore
  *
  * @param sem is the semaphore
@@ -64,6 +91,376 @@ uint32_t fx3_waitOnSemaphore(struct semaphore* sem);
  */
 uint32_t fx3_signalSemaphore(struct semaphore* sem);
 
+/** Mutual exclusion lock, with priority inheritance
+ *
+ * @note not recursive; only the owner can unlock it
+ */
+struct mutex
+{
+   /** Task holding the mutex, 0 when unlocked; bit 0 is set when
+    * other tasks are waiting, so the unlock goes through the kernel
+    */
+   volatile uintptr_t owner;
+
+   volatile struct list_element* antechamber;
+
+   /// Waiting tasks, highest priority first
+   struct pairing_heap waitQueue;
+
+   /// Next contended mutex held by the same owner
+   struct mutex* nextContended;
+};
+
+/** Initialize this mutex, unlocked
+ *
+ * @param mtx is the mutex
+ */
+void fx3_initializeMutex(struct mutex* mtx);
+
+/** Lock this mutex; block this thread until the mutex is available
+ *
+ * While blocked, the owner of the mutex runs with the priority of
+ * this thread, if higher than its own.
+ *
+ * @param mtx is the mutex
+ */
+void fx3_lockMutex(struct mutex* mtx);
+
+/** Lock this mutex if it is available, without blocking
+ *
+ * @param mtx is the mutex
+ * @return true if the mutex was locked
+ */
+bool fx3_tryLockMutex(struct mutex* mtx);
+
+/** Unlock this mutex; the highest priority waiting thread, if any,
+ * becomes the owner
+ *
+ * @param mtx is the mutex
+ */
+void fx3_unlockMutex(struct mutex* mtx);
+
+/** Condition variable, used with a mutex
+ *
+ * Signaling does not wake the waiting threads up: they are moved to the
+ * wait queue of the mutex (wait morphing), and woken up one at a time as
+ * the mutex is handed over to them. A broadcast does not make all the
+ * waiters run, just to contend for the mutex and block again.
+ *
+ * @note all threads waiting at the same time must use the same mutex
+ */
+struct condition_variable
+{
+   /// Waiting tasks, highest priority first
+   struct pairing_heap waitQueue;
+
+   /// The mutex the waiting tasks released, and will lock again
+   struct mutex* mutex;
+
+   /// @privatesection
+   /// Links signals from interrupt handlers that found the kernel command pool exhausted
+   struct list_element deferredLink;
+
+   /// Set while the condition variable is linked through deferredLink
+   volatile bool isSignalDeferred;
+
+   /// Set if one of the deferred signals is a broadcast
+   volatile bool isBroadcastDeferred;
+
+   /// Number of deferred signals
+   volatile uint32_t deferredSignalCount;
+};
+
+/** Initialize this condition variable, with no waiting threads
+ *
+ * @param cond is the condition variable
+ */
+void fx3_initializeConditionVariable(struct condition_variable* cond);
+
+/** Unlock the mutex and wait for this condition variable, as one step;
+ * the mutex is locked again when this returns
+ *
+ * @param cond is the condition variable
+ * @param mtx is the mutex, held by this thread
+ */
+void fx3_waitOnConditionVariable(struct condition_variable* cond, struct mutex* mtx);
+
+/** Unlock the mutex and wait for this condition variable, for a limited
+ * time; the mutex is locked again when this returns, even on timeout
+ *
+ * @param cond is the condition variable
+ * @param mtx is the mutex, held by this thread
+ * @param timeout_ms is the maximum amount of time to wait for the signal
+ * @return true if signaled, false on timeout
+ */
+bool fx3_waitOnConditionVariableWithTimeout(struct condition_variable* cond, struct mutex* mtx, uint32_t timeout_ms);
+
+/** Wake up the highest priority thread waiting on this condition variable
+ *
+ * @note safe to call from interrupt handlers; the signal is lost if no
+ *       thread waits when the kernel processes it
+ *
+ * @param cond is the condition variable
+ */
+void fx3_signalConditionVariable(struct condition_variable* cond);
+
+/** Wake up all the threads waiting on this condition variable
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param cond is the condition variable
+ */
+void fx3_broadcastConditionVariable(struct condition_variable* cond);
+
+/** Bounded queue of message pointers, first in, first out
+ *
+ * Unlike a task inbox, the queue holds at most its capacity: a producer
+ * blocks, or fails, when the consumers fall behind, instead of handing
+ * them all the buffers in the pool. The messages are not copied; the ring
+ * stores the pointers only.
+ *
+ * The non-blocking calls are safe from interrupt handlers; a handler that
+ * finds the queue full drops its message, and keeps the buffer.
+ */
+struct message_queue
+{
+   /// Free slots, waited on by the senders
+   struct semaphore freeSlots;
+
+   /// Queued messages, waited on by the receivers
+   struct semaphore queuedMessages;
+
+   void** slots;
+   uint32_t capacity;
+
+   /// Next slot to receive from
+   uint32_t head;
+
+   /// Next slot to send to
+   uint32_t tail;
+};
+
+/** Initialize this message queue, empty
+ *
+ * @param mq is the message queue
+ * @param slots holds the queued messages
+ * @param capacity is the number of slots
+ */
+void fx3_initializeMessageQueue(struct message_queue* mq, void** slots, uint32_t capacity);
+
+/** Send a message; block this thread while the queue is full
+ *
+ * @param mq is the message queue
+ * @param msg is the message, not NULL
+ */
+void fx3_sendToMessageQueue(struct message_queue* mq, void* msg);
+
+/** Send a message; block this thread while the queue is full, for a
+ * limited time
+ *
+ * @param mq is the message queue
+ * @param msg is the message, not NULL
+ * @param timeout_ms is the maximum amount of time to wait for a free slot
+ * @return true if the message was queued, false on timeout
+ */
+bool fx3_sendToMessageQueueWithTimeout(struct message_queue* mq, void* msg, uint32_t timeout_ms);
+
+/** Send a message if the queue is not full, without blocking
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param mq is the message queue
+ * @param msg is the message, not NULL
+ * @return true if the message was queued, false if the queue is full
+ */
+bool fx3_trySendToMessageQueue(struct message_queue* mq, void* msg);
+
+/** Receive the oldest message; block this thread while the queue is empty
+ *
+ * @param mq is the message queue
+ * @return the message
+ */
+void* fx3_receiveFromMessageQueue(struct message_queue* mq);
+
+/** Receive the oldest message; block this thread while the queue is
+ * empty, for a limited time
+ *
+ * @param mq is the message queue
+ * @param timeout_ms is the maximum amount of time to wait for a message
+ * @return the message, or NULL on timeout
+ */
+void* fx3_receiveFromMessageQueueWithTimeout(struct message_queue* mq, uint32_t timeout_ms);
+
+/** Receive the oldest message if the queue is not empty, without blocking
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param mq is the message queue
+ * @return the message, or NULL if the queue is empty
+ */
+void* fx3_tryReceiveFromMessageQueue(struct message_queue* mq);
+
+/** Group of event flags, that tasks wait on in combinations
+ *
+ * The flags are levels, not counts: setting a flag that is already set
+ * has no effect. A task waits until any, or all, of the flags it names
+ * are set, and can clear them as it wakes up. Setting flags wakes all the
+ * satisfied waiters in one pass of the kernel, not one command each.
+ */
+struct event_group
+{
+   volatile uint32_t flags;
+
+   /// Waiting tasks, in no particular order; only the kernel changes the list
+   struct task_control_block* volatile waiters;
+
+   /// The task selecting on this event group, if any
+   struct fx3_select_entry* volatile selector;
+};
+
+/// Options for fx3_waitForEvents, combined with "or"
+enum fx3_event_options
+{
+   /// Wake up when any of the flags is set
+   FX3_EVENTS_WAIT_ANY        = 0,
+
+   /// Wake up when all the flags are set
+   FX3_EVENTS_WAIT_ALL        = 1U << 0,
+
+   /// Clear the flags waited for, as the wait is satisfied
+   FX3_EVENTS_CLEAR_ON_EXIT   = 1U << 1,
+};
+
+/** Initialize this event group
+ *
+ * @param grp is the event group
+ * @param flags are the flags initially set
+ */
+void fx3_initializeEventGroup(struct event_group* grp, uint32_t flags);
+
+/** Set flags in this event group, and wake up the tasks whose wait is
+ * now satisfied
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param grp is the event group
+ * @param flags are the flags to set
+ */
+void fx3_setEvents(struct event_group* grp, uint32_t flags);
+
+/** Clear flags in this event group
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param grp is the event group
+ * @param flags are the flags to clear
+ * @return the flags set before clearing
+ */
+uint32_t fx3_clearEvents(struct event_group* grp, uint32_t flags);
+
+/** Read the flags of this event group
+ *
+ * @param grp is the event group
+ * @return the flags currently set
+ */
+uint32_t fx3_getEvents(const struct event_group* grp);
+
+/** Wait for flags of this event group; block this thread until any, or
+ * all, of them are set
+ *
+ * @param grp is the event group
+ * @param flags are the flags to wait for, not 0
+ * @param options are FX3_EVENTS_* options
+ * @return the flags waited for that were set when the wait was satisfied
+ */
+uint32_t fx3_waitForEvents(struct event_group* grp, uint32_t flags, uint32_t options);
+
+/** Wait for flags of this event group, for a limited time
+ *
+ * @param grp is the event group
+ * @param flags are the flags to wait for, not 0
+ * @param options are FX3_EVENTS_* options
+ * @param timeout_ms is the maximum amount of time to wait
+ * @return the flags waited for that were set when the wait was
+ *         satisfied, or 0 on timeout
+ */
+uint32_t fx3_waitForEventsWithTimeout(struct event_group* grp, uint32_t flags, uint32_t options, uint32_t timeout_ms);
+
+/** Take flags of this event group if the wait would be satisfied,
+ * without blocking
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param grp is the event group
+ * @param flags are the flags to wait for, not 0
+ * @param options are FX3_EVENTS_* options
+ * @return the flags waited for that were set, or 0 if the wait would block
+ */
+uint32_t fx3_tryWaitForEvents(struct event_group* grp, uint32_t flags, uint32_t options);
+
+/// What an entry of fx3_select waits for
+enum fx3_select_type
+{
+   /// Acquire a semaphore
+   FX3_SELECT_SEMAPHORE,
+
+   /// Take flags of an event group, as fx3_waitForEvents does
+   FX3_SELECT_EVENTS,
+
+   /// A message in the inbox of the selecting task
+   FX3_SELECT_INBOX,
+};
+
+/** One of the objects a task selects on
+ *
+ * While the task is in fx3_select, the object points to the entry, so a
+ * signal, or a set of flags, readies the task directly; only one task
+ * at a time can select on an object.
+ */
+struct fx3_select_entry
+{
+   enum fx3_select_type type;
+
+   /// The semaphore or the event group; unused for the inbox
+   void* object;
+
+   /// For an event group: the flags to wait for, and FX3_EVENTS_* options
+   uint32_t eventFlags;
+   uint32_t eventOptions;
+
+   /// For an event group, on return: the flags taken
+   uint32_t eventsTaken;
+
+   /** @privatesection */
+   struct task_control_block* task;
+};
+
+/// Returned by fx3_selectWithTimeout when no object fired in time
+#define FX3_SELECT_TIMEOUT       UINT32_MAX
+
+/** Wait on several objects at once; block this thread until one of them
+ * fires
+ *
+ * The entries are checked in order, so the first one that fired is
+ * taken: the semaphore is acquired, or the event flags are taken. For
+ * the inbox, the message stays there; fx3_waitForMessage returns it
+ * without blocking.
+ *
+ * @param entries are the objects to wait on
+ * @param count is the number of entries
+ * @return the index of the entry that fired
+ */
+uint32_t fx3_select(struct fx3_select_entry* entries, uint32_t count);
+
+/** Wait on several objects at once, for a limited time
+ *
+ * @param entries are the objects to wait on
+ * @param count is the number of entries
+ * @param timeout_ms is the maximum amount of time to wait
+ * @return the index of the entry that fired, or FX3_SELECT_TIMEOUT
+ */
+uint32_t fx3_selectWithTimeout(struct fx3_select_entry* entries, uint32_t count, uint32_t timeout_ms);
+
 /** @} */
 
 #endif // __SYNCHRONIZATION_H__
@@ -29,6 +29,12 @@
 
 #include <buffer.h>
 #include <list_utils.h>
+#include <timer_wheel.h>
+#include <pairing_heap.h>
+#include <priority_queue.h>
+#include <trace_ring.h>
+
+struct mutex;
 
 /** @mainpage FX3 RTOS
  *
@@ -58,8 +64,11 @@ enum task_state
    TS_ABOUT_TO_SLEEP,
    TS_WAITING_FOR_MUTEX,
    TS_WAITING_FOR_SEMAPHORE,
+   TS_WAITING_FOR_CONDITION,
    TS_WAITING_FOR_EVENT,
    TS_WAITING_FOR_MESSAGE,
+   TS_WAITING_FOR_NOTIFICATION,
+   TS_WAITING_FOR_SELECT,
 
    TS_STATE_COUNT,
 };
@@ -105,21 +114,50 @@ struct task_control_block
    /// @note must be the second element (context_switch.S uses it)
    uint32_t*                     stackPointer;
 
+   /// MPU_RBAR value placing the stack guard region, with FX3_MPU_STACK_GUARD
+   /// @note must be the third element (context_switch.S uses it)
+   uint32_t                      stackGuard_rbar;
+
+   /// Lowest usable word of the stack; overwritten when the stack overflows
+   uint32_t*                     stackLimit;
+
    /// Points to task configuration
    const struct task_config*     config;
 
-   /// Unique identifier for this task
+   /// Unique identifier for this task; 1 + its index in the table of valid tasks
    uint32_t                      id;
 
-   /** The effective priority of this task
+   /// Stamped when the task is created; tells a valid task control block from a stray pointer
+   uint32_t                      validationTag;
+
+   /** The effective priority of this task, and its slot on the ready heap
     * @note used when on the runnable list
     */
-   uint32_t                      effectivePriority;
+   struct priority_queue_entry   readyEntry;
+
+   /** The nominal priority of this task; the configured one, unless
+    * raised by a task waiting on a mutex this task holds
+    */
+   uint32_t                      priority;
 
-   /** The absolute tick until this task will sleep
-    * @note used when on the sleeping list
+   /// Mutexes held by this task, that other tasks are waiting on
+   struct mutex*                 contendedMutexes;
+
+   /** Link on the ready queue
+    * @note used when on the runnable list, with FX3_BITMAP_READY_QUEUE
+    */
+   struct list_element           readyLink;
+
+   /** Link on the wait queue of a semaphore, mutex or condition variable,
+    * keyed on the nominal priority
+    * @note used when waiting on a semaphore, mutex or condition variable
     */
-   uint32_t                      sleepUntil_ticks;
+   struct pairing_heap_node      waitLink;
+
+   /** Link on the sleeping tasks wheel; holds the absolute tick until this task will sleep
+    * @note used when on the sleeping list, or when waiting with a timeout
+    */
+   struct timer_wheel_entry      sleepLink;
 
    /** Current state for this task
     */
@@ -129,9 +167,13 @@ struct task_control_block
     */
    uint8_t                       visited;
 
-   /** Unused for now
+   /** Set when the last wait with a timeout has expired
     */
-   uint8_t                       reserved[2];
+   bool                          waitTimedOut;
+
+   /** FX3_EVENTS_* options of the event group wait
+    */
+   uint8_t                       eventOptions;
 
    /** What object is this task waiting on
     */
@@ -144,6 +186,9 @@ struct task_control_block
    uint32_t                      totalRunTime_ticks;
    uint32_t                      startedRunningAt_ticks;
 
+   /// Number of core clock cycles used to execute this task, with FX3_CPU_ACCOUNTING
+   uint64_t                      totalRunTime_cycles;
+
    /// number of times this task has transitioned to running state
    uint32_t                      startedRunning_count;
 
@@ -158,6 +203,21 @@ struct task_control_block
 
    /// linked list of received messages that are about to be processed
    struct list_element*                messageQueue;
+
+   /// Updated by fx3_notifyTask; the task takes the bits it waits for
+   volatile uint32_t                   notificationValue;
+
+   /// Bits of the notification word the task is waiting for
+   uint32_t                            notificationMask;
+
+   /// Flags of the event group the task is waiting for; once woken up, those that were set
+   uint32_t                            eventFlags;
+
+   /// Set by the kernel when an object the task selects on fires
+   volatile bool                       selectSignaled;
+
+   /// The inbox is one of the objects the task selects on
+   bool                                selectsInbox;
 };
 
 /** Initialize the FX3 data structures
@@ -199,6 +259,192 @@ void fx3_sendMessage(struct task_control_block* tcb, struct list_element* msg);
  */
 struct list_element* fx3_waitForMessage(void);
 
+/** Wait until there is a message in my task queue, for a limited time
+ *
+ * @param timeout_ms is the maximum amount of time to wait
+ * @return the buffer containing the message, or NULL on timeout
+ */
+struct list_element* fx3_waitForMessageWithTimeout(uint32_t timeout_ms);
+
+/** How fx3_notifyTask updates the notification word of a task
+ */
+enum fx3_notification_action
+{
+   /// Set these bits; a task waiting for any of them wakes up
+   FX3_NOTIFY_SET_BITS,
+
+   /// Add to the word, used as a counter; wait for it with a mask of all ones
+   FX3_NOTIFY_INCREMENT,
+
+   /// Replace the word, even if the task did not take the previous value
+   FX3_NOTIFY_OVERWRITE,
+};
+
+/** Update the notification word of a task, and wake it up if it waits
+ * for any of the bits that are now set
+ *
+ * Lighter than a semaphore for waking up one known task: a single
+ * atomic update, and a kernel command only if the task is blocked.
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param tcb identifies the task
+ * @param action selects how the value is applied
+ * @param value is the bits, the increment or the new word
+ */
+void fx3_notifyTask(struct task_control_block* tcb, enum fx3_notification_action action, uint32_t value);
+
+/** Wait until any of the bits in the mask is set in my notification word
+ *
+ * @param mask selects the bits to wait for, not 0
+ * @return the bits of the mask that were set; they are cleared
+ */
+uint32_t fx3_waitForNotification(uint32_t mask);
+
+/** Wait until any of the bits in the mask is set in my notification
+ * word, for a limited time
+ *
+ * @param mask selects the bits to wait for, not 0
+ * @param timeout_ms is the maximum amount of time to wait
+ * @return the bits of the mask that were set, and are now cleared, or 0 on timeout
+ */
+uint32_t fx3_waitForNotificationWithTimeout(uint32_t mask, uint32_t timeout_ms);
+
+/** Wait until there is a message in my task queue, and receive all the
+ * queued messages at once, up to a limit
+ *
+ * @param maxCount is the largest number of messages to receive, at least 1
+ * @param messages receives the list of messages, oldest first, linked
+ *                 through list_element::next and terminated by NULL
+ * @return the number of messages received, at least 1
+ */
+uint32_t fx3_waitForMessages(uint32_t maxCount, struct list_element** messages);
+
+/** Wait until there is a message in my task queue, then linger until at
+ * least minCount messages are queued, or linger_ms expires; receive all
+ * the queued messages at once, up to a limit
+ *
+ * @note each message arriving while lingering wakes up the task briefly,
+ *       to count it; the caller is not returned to until the batch is ready
+ *
+ * @param minCount is the batch size that ends the linger early
+ * @param maxCount is the largest number of messages to receive, at least minCount
+ * @param linger_ms is the longest wait for the batch after the first message;
+ *                  0 receives what is queued right away
+ * @param messages receives the list of messages, oldest first, linked
+ *                 through list_element::next and terminated by NULL
+ * @return the number of messages received, at least 1
+ */
+uint32_t fx3_waitForMessageBatch(uint32_t minCount, uint32_t maxCount, uint32_t linger_ms, struct list_element** messages);
+
+/** Usage counters of the kernel command pool
+ */
+struct fx3_command_statistics
+{
+   /// Number of commands in the pool (FX3_COMMAND_QUEUE_SIZE)
+   uint32_t                            capacity;
+
+   /// Highest number of commands in flight at the same time
+   uint32_t                            highWaterMark;
+
+   /// Number of commands that could not be allocated; tasks wait for
+   /// the kernel to free some, interrupt handlers defer their requests
+   uint32_t                            allocationFailures;
+
+   /// Number of requests from interrupt handlers that were folded into
+   /// a sweep of the waiting tasks, for lack of commands
+   uint32_t                            deferredRequests;
+};
+
+/** Retrieve the usage counters of the kernel command pool
+ *
+ * @param stats receives the counters
+ */
+void fx3_getCommandStatistics(struct fx3_command_statistics* stats);
+
+/** Stack high-water mark of a task
+ *
+ * The stacks are painted when the tasks are created; this counts the words
+ * that were never written, from the bottom of the stack.
+ *
+ * @param tcb identifies the task
+ * @return the smallest amount of stack left free so far, in bytes
+ */
+uint32_t fx3_getUnusedStack(const struct task_control_block* tcb);
+
+/** CPU time since fx3_initialize, in core clock cycles (bsp_getCycleCount)
+ */
+struct fx3_cpu_usage
+{
+   /// Cycles elapsed; the sum of the other accounts and of all tasks
+   uint64_t                            elapsed_cycles;
+
+   /// Cycles spent in interrupt handlers that report to the kernel
+   uint64_t                            interrupts_cycles;
+
+   /// Cycles spent processing kernel commands (PendSV), and before multitasking
+   uint64_t                            kernel_cycles;
+};
+
+/** CPU time of one task, in core clock cycles (bsp_getCycleCount)
+ */
+struct fx3_task_cpu_usage
+{
+   const struct task_control_block*    task;
+   uint64_t                            run_cycles;
+};
+
+/** Take a consistent snapshot of the CPU time accounts (FX3_CPU_ACCOUNTING)
+ *
+ * The load over an interval is the difference between two snapshots; the
+ * idle task's account is the time the CPU was not used.
+ *
+ * @param usage receives the totals
+ * @param tasks receives the per-task accounts, in task creation order
+ * @param taskCount is the capacity of tasks
+ * @return the number of tasks filled in
+ */
+uint32_t fx3_getCpuUsage(struct fx3_cpu_usage* usage, struct fx3_task_cpu_usage* tasks, uint32_t taskCount);
+
+/** Kernel events recorded in the trace ring (FX3_TRACE)
+ *
+ * @note the values are decoded by tools/trace/fx3_trace.py
+ */
+enum fx3_trace_event
+{
+   FX3_TRACE_NONE,
+
+   /// Payload: the id of the task switched to
+   FX3_TRACE_CONTEXT_SWITCH,
+
+   /// Payload: the command type
+   FX3_TRACE_COMMAND_POSTED,
+   FX3_TRACE_COMMAND_PROCESSED,
+
+   /// Payload: the low 24 bits of the semaphore address
+   FX3_TRACE_SEMAPHORE_WAIT,
+   FX3_TRACE_SEMAPHORE_SIGNAL,
+
+   /// Payload: the id of the receiving task
+   FX3_TRACE_MESSAGE_SENT,
+   FX3_TRACE_MESSAGE_RECEIVED,
+
+   /// Payload: the exception number
+   FX3_TRACE_INTERRUPT_ENTERED,
+   FX3_TRACE_INTERRUPT_EXITED,
+};
+
+/** Copy the kernel trace records written since the cursor (FX3_TRACE),
+ * for example to stream them over a serial port
+ *
+ * @param cursor is the number of records already read; it is advanced
+ * @param records receives the records, oldest first
+ * @param count is the capacity of records
+ * @param lost is incremented by the number of records overwritten before they were read
+ * @return the number of records copied
+ */
+uint32_t fx3_fetchTrace(uint32_t* cursor, struct trace_record* records, uint32_t count, uint32_t* lost);
+
 /** @} */
 
 #endif // __FX3_TASK_H__
@@ -25,13 +25,27 @@
 #define __TIMER_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include <list_utils.h>
+#include <timer_wheel.h>
+
+/** @defgroup FX3_Timers Software timers
+ * Software timers for FX3
+ *
+ * Timers are kept by the kernel next to the sleeping tasks, and share their
+ * wake-up alarm. The callbacks of all the timers that expired are run, in
+ * order, by a single timer task, so a timer costs no stack of its own.
+ *
+ * @note enabled with FX3_SOFTWARE_TIMERS
+ * @{
+ */
 
 enum timer_status
 {
-   TS_UNINITIALIZED,
-   TS_ARMED,
-   TS_PENDING,
-   TS_FIRED,
+   TMR_STOPPED,
+   TMR_ARMED,
+   TMR_FIRED,
 };
 
 enum timer_type
@@ -50,18 +64,58 @@ struct timer_config
 
 struct timer
 {
-   struct timer_config* config;
+   /// @note must be the first element (the timer task inbox is linked through it)
+   struct list_element           firedLink;
+
+   const struct timer_config*    config;
+
+   /// Holds the absolute tick of the next expiration, when armed
+   struct timer_wheel_entry      wheelLink;
+
+   /// @note only changed by the kernel
+   volatile enum timer_status    status;
+
+   /// Set while the timer waits for its callback to be run
+   volatile bool                 isPending;
+
+   /// Number of expirations that did not get their own callback
+   uint32_t                      overrun_count;
+
+   /// @privatesection
+   /// Links a request from an interrupt handler that found the kernel command pool exhausted
+   struct list_element           deferredLink;
 
-   uint32_t             deadline;
+   /// Set while the timer is linked through deferredLink
+   volatile bool                 isRequestDeferred;
 
-   enum timer_status    status;
+   /// The latest deferred request: start, or stop
+   volatile bool                 isStartDeferred;
 };
 
-void tmr_initialize(struct timer* tmr);
+/** Initialize this timer, stopped
+ *
+ * @param tmr is the timer
+ * @param config contains the timer configuration
+ */
+void tmr_initialize(struct timer* tmr, const struct timer_config* config);
 
+/** Arm this timer to expire interval_tick from now; a periodic timer is
+ * re-armed relative to its previous deadline, so it does not drift
+ *
+ * @note restarts an armed timer; safe to call from interrupt handlers
+ *
+ * @param tmr is the timer
+ */
 void tmr_start(struct timer* tmr);
 
+/** Disarm this timer; a callback that is pending is not run
+ *
+ * @note safe to call from interrupt handlers
+ *
+ * @param tmr is the timer
+ */
 void tmr_stop(struct timer* tmr);
 
-#endif // __TIMER_H__
+/** @} */
 
+#endif // __TIMER_H__
@@ -29,5 +29,5 @@ FX3_INCLUDES:=\
 	-Isource/modules/inc
 
 FX3_OBJECTS:=\
-	priority_queue.o buffer.o synchronization.o \
+	priority_queue.o bitmap_queue.o bitmap_allocator.o pairing_heap.o timer_wheel.o trace_ring.o buffer.o synchronization.o \
 	context_switch.o faults.o fx3.o fx3_cortex.o
@@ -122,14 +122,21 @@ void HardFault_Handler_C(const uint32_t* hardfault_args, uint32_t lrValue)
       faultRegisters.busFaultAddress = 0;
    }
 
-   faultRegisters.r0 =  hardfault_args[0];
-   faultRegisters.r1 =  hardfault_args[1];
-   faultRegisters.r2 =  hardfault_args[2];
-   faultRegisters.r3 =  hardfault_args[3];
-   faultRegisters.r12 = hardfault_args[4];
-   faultRegisters.lr  = hardfault_args[5];
-   faultRegisters.pc  = hardfault_args[6];
-   faultRegisters.psr = hardfault_args[7];
+   /*
+    * Stacking the frame failed (for example, into a stack guard region);
+    * reading it would fault again.
+    */
+   if (! (faultRegisters.mskterr || faultRegisters.stkerr))
+   {
+      faultRegisters.r0 =  hardfault_args[0];
+      faultRegisters.r1 =  hardfault_args[1];
+      faultRegisters.r2 =  hardfault_args[2];
+      faultRegisters.r3 =  hardfault_args[3];
+      faultRegisters.r12 = hardfault_args[4];
+      faultRegisters.lr  = hardfault_args[5];
+      faultRegisters.pc  = hardfault_args[6];
+      faultRegisters.psr = hardfault_args[7];
+   }
 
    faultRegisters.exceptionLr = lrValue;
 
@@ -26,25 +26,85 @@
 #include <stddef.h>
 
 #include <priority_queue.h>
-#include <bitops.h>
+#include <bitmap_queue.h>
+#include <timer_wheel.h>
+#include <bitmap_allocator.h>
 
 #include <board.h>
 
 #include <task.h>
 #include <synchronization.h>
+#include <timer.h>
 
 #include <fx3_config.h>
 
 #include <task_priv.h>
 
+#ifdef FX3_TRACE
+#include <trace_ring.h>
+#endif
+
 #ifdef FX3_RTT_TRACE
 #include <SEGGER_SYSVIEW.h>
 #endif
 
+/*
+ * Kernel self-checks, selected by FX3_AUDIT_LEVEL
+ */
+#define FX3_AUDIT_OFF            0     ///< no checks
+#define FX3_AUDIT_INVARIANTS     1     ///< constant-time checks at each kernel entry
+#define FX3_AUDIT_INCREMENTAL    2     ///< ... plus the full check, a few tasks per idle loop
+#define FX3_AUDIT_FULL           3     ///< full check at each kernel entry
+
+#ifndef FX3_AUDIT_LEVEL
+#ifdef NDEBUG
+#define FX3_AUDIT_LEVEL FX3_AUDIT_OFF
+#else
+#define FX3_AUDIT_LEVEL FX3_AUDIT_INVARIANTS
+#endif
+#endif
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+
+/* Start the DWT cycle counter, which bsp_getCycleCount reads on the boards
+ * that do not have a counter of their own
+ */
+static void enableCycleCounter(void)
+{
+   CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+   DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#endif
+
+#ifdef FX3_TRACE
+
+#ifndef FX3_TRACE_RECORD_COUNT
+#define FX3_TRACE_RECORD_COUNT 256
+#endif
+
+/// Global, and followed by its records, so it can be found in a memory dump
+TRC_DECLARE_RING(fx3Trace, FX3_TRACE_RECORD_COUNT);
+
+/* Record a kernel event, timestamped with the board cycle counter
+ */
+static inline void traceEvent(enum fx3_trace_event type, uint32_t payload)
+{
+   trc_record(&fx3Trace.ring, bsp_getCycleCount(), TRC_EVENT(type, payload));
+}
+
+uint32_t fx3_fetchTrace(uint32_t* cursor, struct trace_record* records, uint32_t count, uint32_t* lost)
+{
+   return trc_fetch(&fx3Trace.ring, cursor, records, count, lost);
+}
+
+#endif // FX3_TRACE
+
 /*
  * FX3 command infrastructure
  */
 
+/// @note the values are decoded by tools/trace/fx3_trace.py
 enum command_type
 {
    FX3_INVALID_COMMAND,
@@ -57,16 +117,54 @@ enum command_type
    FX3_TIMER_REQUEST_SUSPEND,
 
    FX3_CHECK_INBOX_FOR_LATE_ARRIVAL,
+   FX3_CHECK_NOTIFICATION_FOR_LATE_ARRIVAL,
+   FX3_CHECK_SELECT_FOR_LATE_SIGNAL,
+
+   FX3_CHECK_SEMAPHORE_FOR_LATE_SIGNAL,
+
+   FX3_LOCK_MUTEX,
+   FX3_UNLOCK_MUTEX,
+
+   FX3_WAIT_ON_CONDITION,
+   FX3_SIGNAL_CONDITION,
+   FX3_BROADCAST_CONDITION,
+
+   FX3_WAIT_FOR_EVENTS,
+   FX3_SET_EVENTS,
+
+   FX3_START_TIMER,
+   FX3_STOP_TIMER,
 
    /// Sent by timer handler to FX3
    FX3_TIMER_EVENT_WAKEUP,
-   FX3_TIMER_EVENT_EPOCH_ROLLOVER,
+
+   /// Requests from interrupt handlers that found the pool exhausted
+   FX3_RUN_DEFERRED_WORK,
 };
 
 #ifndef FX3_COMMAND_QUEUE_SIZE
-#define FX3_COMMAND_QUEUE_SIZE 16
+#define FX3_COMMAND_QUEUE_SIZE 64
 #endif
 
+#ifndef FX3_COMMAND_PRIORITY_LEVELS
+#define FX3_COMMAND_PRIORITY_LEVELS (1U << __NVIC_PRIO_BITS)
+#endif
+
+#ifndef FX3_COMMAND_RESERVED_PER_LEVEL
+#define FX3_COMMAND_RESERVED_PER_LEVEL 1
+#endif
+
+_Static_assert(FX3_COMMAND_QUEUE_SIZE <= BMA_MAX_SLOT_COUNT, "FX3_COMMAND_QUEUE_SIZE exceeds the allocator capacity");
+_Static_assert(FX3_COMMAND_QUEUE_SIZE > FX3_COMMAND_PRIORITY_LEVELS * FX3_COMMAND_RESERVED_PER_LEVEL,
+               "FX3_COMMAND_QUEUE_SIZE must exceed the commands reserved for interrupt priority levels");
+
+/*
+ * A task waiting for a command can only be stuck behind commands that
+ * other tasks allocated, and were preempted before posting; one per task.
+ */
+_Static_assert(FX3_COMMAND_QUEUE_SIZE > FX3_COMMAND_PRIORITY_LEVELS * FX3_COMMAND_RESERVED_PER_LEVEL + FX3_MAX_TASK_COUNT,
+               "FX3_COMMAND_QUEUE_SIZE must exceed the commands reserved for interrupt priority levels, plus one per task");
+
 struct fx3_command
 {
    /// used for intrusive data structures
@@ -81,6 +179,9 @@ struct fx3_command
    struct task_control_block* task;
 
    void*                      object;
+
+   /// number of identical commands folded into this one
+   uint32_t                   coalescedCount;
 };
 
 static struct fx3_message_center
@@ -88,17 +189,85 @@ static struct fx3_message_center
    /// pool of available commands
    struct fx3_command         pool[FX3_COMMAND_QUEUE_SIZE];
 
-   /// bitmap
-   volatile uint32_t          available;
+   /// tracks which commands in the pool are available
+   struct bitmap_allocator    allocator;
+
+   volatile uint32_t          bitmap[BMA_BITMAP_WORD_COUNT(FX3_COMMAND_QUEUE_SIZE)];
 
    volatile struct list_element*       inbox;
 
+   /// work deferred by interrupt handlers that found the pool exhausted
+   volatile uint32_t          deferredWork;
+
+   /// posted when deferredWork becomes non-zero; never freed
+   struct fx3_command         deferredWorkCommand;
+
+   /// number of requests folded into the deferred work
+   volatile uint32_t          deferredRequestCount;
+
+   /// condition variables signaled by deferred requests, linked through deferredLink
+   volatile struct list_element*       deferredConditions;
+
+#ifdef FX3_SOFTWARE_TIMERS
+   /// timers started or stopped by deferred requests, linked through deferredLink
+   volatile struct list_element*       deferredTimers;
+#endif
+
 }  fx3MessageCenter;
 
+/// Kinds of work deferred by interrupt handlers; see deferFX3Work
+enum fx3_deferred_work
+{
+   /// Wake up the tasks whose wait is satisfied, and end the time slice that ran out
+   FX3_DEFERRED_TASK_SWEEP    = 1U << 0,
+
+   /// Hand over the sleeping tasks that are due
+   FX3_DEFERRED_WAKEUP        = 1U << 1,
+
+   /// Apply the signals on fx3MessageCenter.deferredConditions
+   FX3_DEFERRED_CONDITIONS    = 1U << 2,
+
+   /// Apply the requests on fx3MessageCenter.deferredTimers
+   FX3_DEFERRED_TIMERS        = 1U << 3,
+};
+
+/** Computes how many commands the caller must leave in the pool
+ *
+ * Every interrupt priority level more urgent than the caller's is
+ * guaranteed FX3_COMMAND_RESERVED_PER_LEVEL commands, so a burst of
+ * posts from tasks or from low-priority handlers cannot starve the
+ * handlers that preempt them. Thread mode ranks below all handlers.
+ */
+static inline uint32_t computeCommandReserve(void)
+{
+   const uint32_t exceptionNumber = __get_IPSR();
+
+   uint32_t level = FX3_COMMAND_PRIORITY_LEVELS;
+
+   if (0 != exceptionNumber)
+   {
+      level = NVIC_GetPriority((IRQn_Type) ((int32_t) exceptionNumber - 16));
+      if (FX3_COMMAND_PRIORITY_LEVELS <= level)
+      {
+         level = FX3_COMMAND_PRIORITY_LEVELS - 1;
+      }
+   }
+
+   return level * FX3_COMMAND_RESERVED_PER_LEVEL;
+}
+
+/** Allocates a command from the pool
+ *
+ * @return the command, or NULL if the pool is exhausted for the caller's
+ *         priority level; see allocateTaskCommand and deferFX3Work
+ */
 static inline struct fx3_command* allocateFX3Command(void)
 {
-   uint32_t idx = bit_alloc(&fx3MessageCenter.available);
-   assert(FX3_COMMAND_QUEUE_SIZE > idx);
+   uint32_t idx = bma_alloc(&fx3MessageCenter.allocator, computeCommandReserve());
+   if (FX3_COMMAND_QUEUE_SIZE <= idx)
+   {
+      return NULL;
+   }
 
    struct fx3_command* cmd = &fx3MessageCenter.pool[idx];
 
@@ -107,28 +276,155 @@ static inline struct fx3_command* allocateFX3Command(void)
    assert(NULL == cmd->task);
    assert(NULL == cmd->object);
    assert(NULL == cmd->next);
+   assert(0 == cmd->coalescedCount);
 
    return cmd;
 }
 
 static inline void postFX3Command(struct fx3_command* cmd)
 {
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_COMMAND_POSTED, cmd->type);
+#endif
+
    lst_pushElement(&fx3MessageCenter.inbox, &cmd->element);
    bsp_scheduleContextSwitch();
 }
 
+/** Allocates a command for a task, waiting for the kernel to free some if
+ * the pool is exhausted
+ *
+ * Thread mode ranks below PendSV, so pending PendSV processes, and frees,
+ * the commands in flight before returning; the pool is sized so at least
+ * one of them is posted. The task may be preempted in the mean time, so
+ * callers allocate before changing its state.
+ */
+static struct fx3_command* allocateTaskCommand(void)
+{
+   assert(0 == __get_IPSR());
+
+   struct fx3_command* cmd = allocateFX3Command();
+
+   while (NULL == cmd)
+   {
+      assert(0 == __get_PRIMASK());
+
+      bsp_scheduleContextSwitch();
+
+      cmd = allocateFX3Command();
+   }
+
+   return cmd;
+}
+
+/** Allocates a command for a request that may come from an interrupt handler
+ *
+ * @return the command, or NULL if called from a handler and the pool is
+ *         exhausted; the caller then defers the request, see deferFX3Work
+ */
+static inline struct fx3_command* allocateRequestCommand(void)
+{
+   return (0 == __get_IPSR()) ? allocateTaskCommand() : allocateFX3Command();
+}
+
+/** Folds a request from an interrupt handler that found the pool exhausted
+ * into the deferred work, which the kernel runs with a command of its own
+ *
+ * The deferred work finds what to do from the kernel state, not from the
+ * requests: it wakes up every task whose wait is satisfied, so a request
+ * is never lost, but the requests of the same kind are not told apart.
+ *
+ * @param work is a combination of fx3_deferred_work
+ */
+static void deferFX3Work(uint32_t work)
+{
+   __atomic_fetch_add(&fx3MessageCenter.deferredRequestCount, 1, __ATOMIC_RELAXED);
+
+   const uint32_t pendingWork = __atomic_fetch_or(&fx3MessageCenter.deferredWork, work, __ATOMIC_RELEASE);
+
+   // the kernel clears the work before running it, then the command can be posted again
+   if (0 == pendingWork)
+   {
+      postFX3Command(&fx3MessageCenter.deferredWorkCommand);
+   }
+}
+
 static inline void freeFX3Command(struct fx3_command* cmd)
 {
-   assert(cmd > fx3MessageCenter.pool);
+   assert(cmd >= fx3MessageCenter.pool);
    ptrdiff_t idx = cmd - fx3MessageCenter.pool;
    assert(FX3_COMMAND_QUEUE_SIZE > idx);
-   assert(0 == (fx3MessageCenter.available & (1 << idx)));
 
    memset(cmd, 0, sizeof(*cmd));
 
-   bit_free(&fx3MessageCenter.available, idx);
+   bma_free(&fx3MessageCenter.allocator, (uint32_t) idx);
+}
+
+#ifdef FX3_COALESCE_COMMANDS
+
+#ifndef FX3_COALESCING_SLOT_COUNT
+#define FX3_COALESCING_SLOT_COUNT 8
+#endif
+
+_Static_assert(0 == (FX3_COALESCING_SLOT_COUNT & (FX3_COALESCING_SLOT_COUNT - 1)), "FX3_COALESCING_SLOT_COUNT must be a power of 2");
+
+/**
+ * @return the object a command can be folded on, or NULL if it cannot
+ */
+static inline const void* getCoalescingKey(const struct fx3_command* cmd)
+{
+   switch (cmd->type)
+   {
+      case FX3_READY_TASK:
+         return cmd->task;
+
+      case FX3_SIGNAL_SEMAPHORE:
+      case FX3_SET_EVENTS:
+         return cmd->object;
+
+      default:
+         return NULL;
+   }
+}
+
+/** Folds a command into a later identical command from the same batch
+ *
+ * Readying a task is idempotent, each semaphore signal wakes one waiter,
+ * and setting events reads the flags when processed, not when posted;
+ * processing the request at the position of the latest copy has the
+ * same outcome, since nothing runs between the commands of a batch.
+ * Recent commands are remembered in a small direct-mapped table, so a
+ * collision only costs a missed fold.
+ *
+ * @param laterCommands is the table of commands already seen, newer than cmd
+ * @param cmd is the command
+ * @return true if the command was folded, and freed
+ */
+static bool coalesceFX3Command(struct fx3_command** laterCommands, struct fx3_command* cmd)
+{
+   const void* key = getCoalescingKey(cmd);
+
+   if (NULL == key)
+   {
+      return false;
+   }
+
+   struct fx3_command** slot  = &laterCommands[(((uintptr_t) key) >> 2) & (FX3_COALESCING_SLOT_COUNT - 1)];
+   struct fx3_command*  later = *slot;
+
+   if (later && (later->type == cmd->type) && (getCoalescingKey(later) == key))
+   {
+      later->coalescedCount += cmd->coalescedCount + 1;
+      freeFX3Command(cmd);
+      return true;
+   }
+
+   *slot = cmd;
+   return false;
 }
 
+#endif // FX3_COALESCE_COMMANDS
+
 
 /*
  * A task can be:
@@ -142,30 +438,75 @@ static bool fx3IsInitialized = false;
 struct task_control_block* runningTask;
 struct task_control_block* nextRunningTask;
 
+#ifdef FX3_BITMAP_READY_QUEUE
+
+#ifndef FX3_READY_QUEUE_PRIORITY_COUNT
+#define FX3_READY_QUEUE_PRIORITY_COUNT 16
+#endif
+
+/*
+ * Two levels for each nominal priority: ready tasks are ahead of the
+ * tasks that exhausted their round-robin slice.
+ */
+#define FX3_READY_QUEUE_LEVEL_COUNT (FX3_READY_QUEUE_PRIORITY_COUNT * 2)
+
+static struct bitmap_queue_level runnableTasksLevels[FX3_READY_QUEUE_LEVEL_COUNT];
+static uint32_t runnableTasksBitmap[BMQ_BITMAP_WORD_COUNT(FX3_READY_QUEUE_LEVEL_COUNT)];
+static struct bitmap_queue runnableTasks;
+
+#else
+
 // +1 for the heap header and +1 for the idle task
-static uint32_t* runnableTasksMemPool[FX3_MAX_TASK_COUNT + 2];
-static struct priority_queue runnableTasks;
+static struct priority_queue_entry* runnableTasksMemPool[FX3_MAX_TASK_COUNT + 2];
+static struct indexed_priority_queue runnableTasks;
+
+#endif
 
 static struct task_control_block* allValidTaskControlBlocks[FX3_MAX_TASK_COUNT];
 
-static struct fx3_timer
+/// Marks a valid task control block, with the generation in the top byte
+#define FX3_TCB_MAGIC 0x00543346U
+
+/// Fills the stacks of new tasks; the words still holding it were never used
+#define FX3_STACK_PAINT 0x5AC0FFEEU
+
+/// Incremented by fx3_initialize, so task control blocks from before are invalid
+static uint32_t taskGeneration;
+
+static inline uint32_t computeValidationTag(void)
 {
-   struct task_control_block* firstSleepingTaskToAwake;
+   return FX3_TCB_MAGIC | (taskGeneration << 24);
+}
+
+/*
+ * Tasks created, but not linked yet; drained in priority order when
+ * multitasking starts.
+ */
+// +1 for the heap header
+static uint32_t* parkedTasksMemPool[FX3_MAX_TASK_COUNT + 1];
+static struct priority_queue parkedTasks;
 
-   // +1 for the heap header and +1 for the idle task
-   uint32_t* sleepingTasksMemPool_0[FX3_MAX_TASK_COUNT + 2];
-   struct priority_queue sleepingTasks_0;
-   // +1 for the heap header and +1 for the idle task
-   uint32_t* sleepingTasksMemPool_1[FX3_MAX_TASK_COUNT + 2];
-   struct priority_queue sleepingTasks_1;
+static struct fx3_timer
+{
+   /// Sleeping tasks, keyed on the 64-bit timestamp of their deadline
+   struct timer_wheel sleepingTasks;
 
-   struct priority_queue* sleepingTasks;
-   struct priority_queue* sleepingTasksNextEpoch;
+#ifdef FX3_SOFTWARE_TIMERS
+   /// Armed software timers, keyed like the sleeping tasks
+   struct timer_wheel softwareTimers;
+#endif
 
-   volatile uint32_t lastWokenUpAt;
+   /// Deadline the wake-up alarm is armed for, UINT64_MAX if none
+   uint64_t wakeUpAlarmAt_ticks;
 
 }  fx3Timer;
 
+static bool wakeUpSleepingTasks(void);
+
+#if FX3_AUDIT_LEVEL == FX3_AUDIT_INCREMENTAL
+static void auditNextTaskControlBlocks(void);
+#endif
+
 /*
  *
  */
@@ -177,8 +518,20 @@ static void idleTaskHandler(const void* arg __attribute__((unused)))
 {
    while (true)
    {
+#if FX3_AUDIT_LEVEL == FX3_AUDIT_INCREMENTAL
+      __disable_irq();
+      auditNextTaskControlBlocks();
+      __enable_irq();
+#endif
+
       sleepCycles ++;
+
+#ifdef FX3_TICKLESS_IDLE
+      // until the next alarm, which the timer knows
+      bsp_sleep_ticks(UINT32_MAX);
+#else
       bsp_sleep();
+#endif
    }
 }
 
@@ -195,7 +548,57 @@ static const struct task_config idleTaskConfig =
 
 struct task_control_block idleTask;
 
-static inline uint32_t computeEffectivePriority(enum task_state state, const struct task_config* config)
+#ifdef FX3_SOFTWARE_TIMERS
+
+#ifndef FX3_TIMER_TASK_PRIORITY
+#define FX3_TIMER_TASK_PRIORITY 1
+#endif
+
+#ifdef FX3_BITMAP_READY_QUEUE
+_Static_assert(FX3_TIMER_TASK_PRIORITY < FX3_READY_QUEUE_PRIORITY_COUNT, "FX3_TIMER_TASK_PRIORITY has no ready queue level");
+#endif
+
+#ifndef FX3_TIMER_TASK_STACK_SIZE
+#define FX3_TIMER_TASK_STACK_SIZE 512
+#endif
+
+static uint8_t timerTaskStack[FX3_TIMER_TASK_STACK_SIZE] __attribute__ ((aligned (16)));
+
+/*
+ * Expired timers are posted to this task's inbox, by the kernel; it runs
+ * their callbacks in batches.
+ */
+static void timerTaskHandler(const void* arg __attribute__((unused)))
+{
+   while (true)
+   {
+      struct timer* tmr = (struct timer*) fx3_waitForMessage();
+
+      tmr->isPending = false;
+
+      if (TMR_STOPPED != tmr->status)
+      {
+         tmr->config->handler(tmr->config->argument);
+      }
+   }
+}
+
+static const struct task_config timerTaskConfig =
+{
+   .name            = "Timers",
+   .handler         = timerTaskHandler,
+   .argument        = NULL,
+   .priority        = FX3_TIMER_TASK_PRIORITY,
+   .stackBase       = timerTaskStack,
+   .stackSize       = sizeof(timerTaskStack),
+   .timeSlice_ticks = 0,
+};
+
+static struct task_control_block timerTask;
+
+#endif
+
+static inline uint32_t computeEffectivePriority(enum task_state state, const struct task_control_block* tcb)
 {
    /*
     * Shift priority value to allow ready / resting / exhausted "sub-priorities"
@@ -208,198 +611,419 @@ static inline uint32_t computeEffectivePriority(enum task_state state, const str
     * priorities than runnable tasks with lower priorities. Just, when
     * selecting between two tasks with the same nominal priority, the
     * not-exhausted one is clearly more ready to run.
+    *
+    * The nominal priority is the task's own, unless raised by a mutex it holds.
     */
-   return config->priority * 16 + state;
+   return tcb->priority * 16 + state;
 }
 
-/* Mark task ready
- */
-static bool markTaskReady(struct task_control_block* tcb)
+#ifdef FX3_BITMAP_READY_QUEUE
+static inline uint32_t computeReadyLevel(enum task_state state, const struct task_control_block* tcb)
 {
-   if (TS_READY != tcb->state)
-   {
-      for (uint32_t ii = 0; ii < runnableTasks.size; ii ++)
-      {
-         uint32_t* priority = runnableTasks.memPool[ii + 1];
-         struct task_control_block* readyTask = (struct task_control_block*) (((uint8_t*) priority) - (offsetof(struct task_control_block, effectivePriority)));
-
-         assert(readyTask != tcb);
-
-         assert((TS_READY == readyTask->state) || (TS_EXHAUSTED == readyTask->state));
-      }
-
-      assert(tcb->config->timeSlice_ticks >= tcb->roundRobinSliceLeft_ticks);
-      if (tcb->config->timeSlice_ticks && (0 == tcb->roundRobinSliceLeft_ticks))
-      {
-         tcb->state = TS_EXHAUSTED;
-      }
-      else
-      {
-         tcb->state = TS_READY;
-      }
-
-      tcb->sleepUntil_ticks  = 0;
-      tcb->effectivePriority = computeEffectivePriority(tcb->state, tcb->config);
-      prq_push(&runnableTasks, &tcb->effectivePriority);
+   /*
+    * Task creation rejects priorities beyond the bitmap range, and an
+    * inherited priority is never lower than the task's own.
+    */
+   assert(tcb->priority < FX3_READY_QUEUE_PRIORITY_COUNT);
 
-#ifdef FX3_RTT_TRACE
-      if (&idleTask != tcb)
-      {
-         SEGGER_SYSVIEW_OnTaskStartReady((uint32_t) tcb);
-      }
+   return tcb->priority * 2 + ((TS_EXHAUSTED == state) ? 1 : 0);
+}
 #endif
-      return (tcb->effectivePriority < runningTask->effectivePriority);
-   }
-   else
+
+static inline void pushReadyTask(struct task_control_block* tcb)
+{
+#ifdef FX3_BITMAP_READY_QUEUE
+   /*
+    * The idle task is never queued, it is selected when the queue is empty.
+    */
+   if (&idleTask != tcb)
    {
-      return true;
+      bmq_push(&runnableTasks, &tcb->readyLink, computeReadyLevel(tcb->state, tcb));
    }
+#else
+   bool isQueued = ipq_push(&runnableTasks, &tcb->readyEntry);
+   assert(isQueued);
+   (void) isQueued;
+#endif
 }
 
-static void scheduleReadyTask(struct task_control_block* tcb)
+static inline struct task_control_block* popReadyTask(void)
 {
-   struct fx3_command* cmd = allocateFX3Command();
+#ifdef FX3_BITMAP_READY_QUEUE
+   struct list_element* readyLink = bmq_pop(&runnableTasks, NULL);
+   if (NULL == readyLink)
+   {
+      assert(TS_READY == idleTask.state);
+      return &idleTask;
+   }
 
-   cmd->type = FX3_READY_TASK;
-   cmd->task = tcb;
+   return (struct task_control_block*) (((uint8_t*) readyLink) - (offsetof(struct task_control_block, readyLink)));
+#else
+   struct priority_queue_entry* readyEntry = ipq_pop(&runnableTasks);
+   assert(readyEntry);    // idle task, if nothing else
 
-   postFX3Command(cmd);
+   return (struct task_control_block*) (((uint8_t*) readyEntry) - (offsetof(struct task_control_block, readyEntry)));
+#endif
 }
 
-static uint32_t tasksCreated_count;
+#if FX3_AUDIT_LEVEL >= FX3_AUDIT_INCREMENTAL
 
-static void verifyTaskControlBlocks(bool expectTaskInRunningState)
+/* Check all tasks on the ready queue are in a ready state
+ *
+ * @param excludedTask must not be on the ready queue
+ * @param markVisited increments the visited counter of each ready task
+ */
+static void verifyReadyTasks(const struct task_control_block* excludedTask, bool markVisited)
 {
-#ifdef FX3_RTT_TRACE
-   //SEGGER_SYSVIEW_RecordVoid(32);
-#endif
+#ifdef FX3_BITMAP_READY_QUEUE
+   uint32_t readyTasks = 0;
 
-   for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
+   for (uint32_t level = 0; level < FX3_READY_QUEUE_LEVEL_COUNT; level ++)
    {
-      allValidTaskControlBlocks[ii]->visited = 0;
+      for (struct list_element* readyLink = runnableTasks.levels[level].head; readyLink; readyLink = readyLink->next)
+      {
+         struct task_control_block* readyTask = (struct task_control_block*) (((uint8_t*) readyLink) - (offsetof(struct task_control_block, readyLink)));
+
+         assert(readyTask != excludedTask);
+         assert((TS_READY == readyTask->state) || (TS_EXHAUSTED == readyTask->state));
+
+         if (markVisited)
+         {
+            readyTask->visited ++;
+         }
+
+         readyTasks ++;
+      }
    }
 
-   bool foundTaskInRunningState = false;
-   uint32_t tasksVisited = 0;
+   assert(readyTasks == runnableTasks.size);
 
+   if (markVisited && (TS_READY == idleTask.state))
+   {
+      idleTask.visited ++;
+   }
+#else
    /*
-    * check task links
+    * note; the queue is a heap, and indices start at 1
     */
-
-   struct task_control_block* tcb = &idleTask;
-   do
+   for (uint32_t ii = 0; ii < runnableTasks.size; ii ++)
    {
-      assert(tcb);
-      assert(tcb->config);
-      assert(tcb->config->priority);
+      struct priority_queue_entry* readyEntry = runnableTasks.memPool[ii + 1];
+      struct task_control_block* readyTask = (struct task_control_block*) (((uint8_t*) readyEntry) - (offsetof(struct task_control_block, readyEntry)));
 
-      tcb->visited ++;
+      assert((ii + 1) == readyEntry->slot);
 
-      tasksVisited ++;
+      assert(readyTask != excludedTask);
+      assert((TS_READY == readyTask->state) || (TS_EXHAUSTED == readyTask->state));
 
-      if (TS_RUNNING == tcb->state)
+      if (markVisited)
       {
-         assert(! foundTaskInRunningState);
-         foundTaskInRunningState = true;
+         readyTask->visited ++;
       }
+   }
+#endif
+}
+
+#endif // FX3_AUDIT_LEVEL >= FX3_AUDIT_INCREMENTAL
 
-      assert(tcb->nextWithSamePriority);
+/* Mark task ready
+ *
+ * @note exhausted tasks are queued already; a round-robin timeout can
+ * ready a task that the same batch of commands preempted
+ */
+static bool markTaskReady(struct task_control_block* tcb)
+{
+   if ((TS_READY != tcb->state) && (TS_EXHAUSTED != tcb->state))
+   {
+#if FX3_AUDIT_LEVEL >= FX3_AUDIT_FULL
+      verifyReadyTasks(tcb, false);
+#endif
 
-      if (tcb->nextWithSamePriority == tcb)
+      assert(tcb->config->timeSlice_ticks >= tcb->roundRobinSliceLeft_ticks);
+      if (tcb->config->timeSlice_ticks && (0 == tcb->roundRobinSliceLeft_ticks))
       {
-         assert(0 == tcb->config->timeSlice_ticks);
+         if (tcb->priority == tcb->config->priority)
+         {
+            tcb->state = TS_EXHAUSTED;
+         }
+         else
+         {
+            /*
+             * Running with an inherited priority, outside of its round-robin
+             * ring; just give it another slice.
+             */
+            tcb->roundRobinSliceLeft_ticks = tcb->config->timeSlice_ticks;
+            tcb->state                     = TS_READY;
+         }
       }
       else
       {
-         assert(tcb->config->timeSlice_ticks);
+         tcb->state = TS_READY;
       }
 
-      struct task_control_block* peerPriorityTask = tcb;
-      do
-      {
-         assert(tcb->config->priority == peerPriorityTask->config->priority);
+      twh_cancel(&fx3Timer.sleepingTasks, &tcb->sleepLink);
 
-         peerPriorityTask = peerPriorityTask->nextWithSamePriority;
-      }
-      while (peerPriorityTask != tcb);
+      tcb->readyEntry.priority = computeEffectivePriority(tcb->state, tcb);
+      pushReadyTask(tcb);
 
-      tcb = tcb->nextTaskInTheGreatLink;
+#ifdef FX3_RTT_TRACE
+      if (&idleTask != tcb)
+      {
+         SEGGER_SYSVIEW_OnTaskStartReady((uint32_t) tcb);
+      }
+#endif
 
       /*
-       * verify tcb points to a valid task
+       * No task runs yet while setupTasksLinks readies them; the running
+       * task, readied at the end of its slice, is queued now, and has to
+       * be selected again.
        */
-      uint32_t tt = 0;
-      while (tt < tasksCreated_count)
-      {
-         if (allValidTaskControlBlocks[tt] == tcb)
-         {
-            break;
-         }
-         else
-         {
-            tt ++;
-         }
-      }
-      assert(tt < tasksCreated_count);
+      return runningTask && ((runningTask == tcb) || (tcb->readyEntry.priority < runningTask->readyEntry.priority));
    }
-   while (&idleTask != tcb);
+   else
+   {
+      return true;
+   }
+}
+
+static void scheduleReadyTask(struct task_control_block* tcb)
+{
+   struct fx3_command* cmd = allocateRequestCommand();
+
+   if (NULL == cmd)
+   {
+      deferFX3Work(FX3_DEFERRED_TASK_SWEEP);
+      return;
+   }
+
+   cmd->type = FX3_READY_TASK;
+   cmd->task = tcb;
+
+   postFX3Command(cmd);
+}
+
+static uint32_t tasksCreated_count;
+
+/* Check that a pointer designates a task control block created since
+ * fx3_initialize: a bounds check on its index and two compares
+ */
+static inline bool isValidTaskControlBlock(const struct task_control_block* tcb)
+{
+   if (NULL == tcb)
+   {
+      return false;
+   }
+
+   // id is 1-based; an id of 0 wraps around and fails the bounds check
+   const uint32_t index = tcb->id - 1;
+
+   return (index < tasksCreated_count)
+      && (allValidTaskControlBlocks[index] == tcb)
+      && (computeValidationTag() == tcb->validationTag);
+}
+
+/* Check the constant-time invariants of the kernel state
+ */
+static inline void verifyKernelInvariants(bool expectTaskInRunningState)
+{
+   assert(runningTask);
+   assert(runningTask->config);
+   assert(runningTask->nextWithSamePriority);
+
+   // the running task has not overflowed its stack, yet
+   assert(FX3_STACK_PAINT == *runningTask->stackLimit);
 
    if (expectTaskInRunningState)
    {
-      assert(foundTaskInRunningState);
+      // or the task selected to run, until PendSV switches to it
+      assert((TS_RUNNING == runningTask->state) || (TS_RUNNING == nextRunningTask->state));
    }
 
-   assert(tasksVisited == tasksCreated_count);
+   assert((TS_RUNNING == idleTask.state) || (TS_READY == idleTask.state));
 
-   for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
+   assert(tasksCreated_count <= FX3_MAX_TASK_COUNT);
+
+   // a task is either ready, or sleeping, or neither
+   assert(runnableTasks.size + fx3Timer.sleepingTasks.size <= tasksCreated_count);
+}
+
+#if FX3_AUDIT_LEVEL >= FX3_AUDIT_INCREMENTAL
+
+/* Check all tasks on one list of the sleeping wheel are sleeping or
+ * waiting with a timeout, and mark them visited
+ *
+ * @return the number of tasks on the list
+ */
+static uint32_t verifySleepingList(struct timer_wheel_entry* sleepLink)
+{
+   uint32_t sleepingTasks = 0;
+
+   for (; sleepLink; sleepLink = sleepLink->next)
    {
-      assert(1 == allValidTaskControlBlocks[ii]->visited);
+      struct task_control_block* sleepingTask = (struct task_control_block*) (((uint8_t*) sleepLink) - (offsetof(struct task_control_block, sleepLink)));
+
+      sleepingTask->visited ++;
+
+      assert((TS_SLEEPING == sleepingTask->state)
+            || (TS_WAITING_FOR_SEMAPHORE == sleepingTask->state)
+            || (TS_WAITING_FOR_CONDITION == sleepingTask->state)
+            || (TS_WAITING_FOR_EVENT == sleepingTask->state)
+            || (TS_WAITING_FOR_MESSAGE == sleepingTask->state)
+            || (TS_WAITING_FOR_NOTIFICATION == sleepingTask->state)
+            || (TS_WAITING_FOR_SELECT == sleepingTask->state));
+
+      sleepingTasks ++;
    }
 
-   /*
-    * check running queue
-    * note; the queue is a heap, and indices start at 1
-    */
-   for (uint32_t ii = 0; ii < runnableTasks.size; ii ++)
+   return sleepingTasks;
+}
+
+static void verifySleepingTasks(void)
+{
+   uint32_t sleepingTasks = verifySleepingList(fx3Timer.sleepingTasks.overflow);
+
+   for (uint32_t level = 0; level < TWH_LEVEL_COUNT; level ++)
    {
-      uint32_t* priority = runnableTasks.memPool[ii + 1];
-      struct task_control_block* readyTask = (struct task_control_block*) (((uint8_t*) priority) - (offsetof(struct task_control_block, effectivePriority)));
+      for (uint32_t slot = 0; slot < TWH_SLOT_COUNT; slot ++)
+      {
+         sleepingTasks += verifySleepingList(fx3Timer.sleepingTasks.slots[level][slot]);
+      }
+   }
 
-      readyTask->visited ++;
+   assert(sleepingTasks == fx3Timer.sleepingTasks.size);
+}
 
-      assert((TS_READY == readyTask->state) || (TS_EXHAUSTED == readyTask->state));
+/* Check a task is queued where its state says it is
+ */
+static void verifyTaskControlBlock(const struct task_control_block* tcb)
+{
+   assert(tcb);
+   assert(tcb->config);
+   assert(tcb->config->priority);
+   assert(tcb->nextWithSamePriority);
+   assert(FX3_STACK_PAINT == *tcb->stackLimit);
+
+   if (tcb->nextWithSamePriority == tcb)
+   {
+      assert(0 == tcb->config->timeSlice_ticks);
+   }
+   else
+   {
+      assert(tcb->config->timeSlice_ticks);
    }
 
-   /*
-    * check sleeping queue
-    * note; the queue is a heap, and indices start at 1
-    */
-   for (uint32_t ii = 0; ii < fx3Timer.sleepingTasks->size; ii ++)
+   const struct task_control_block* peerPriorityTask = tcb;
+   do
    {
-      uint32_t* sleepUntil = fx3Timer.sleepingTasks->memPool[ii + 1];
-      struct task_control_block* sleepingTask = (struct task_control_block*) (((uint8_t*) sleepUntil) - (offsetof(struct task_control_block, sleepUntil_ticks)));;
+      assert(tcb->config->priority == peerPriorityTask->config->priority);
 
-      sleepingTask->visited ++;
+      peerPriorityTask = peerPriorityTask->nextWithSamePriority;
+   }
+   while (peerPriorityTask != tcb);
+
+   switch (tcb->state)
+   {
+      case TS_RUNNING:
+         // or selected to run, until PendSV switches to it
+         assert((runningTask == tcb) || (nextRunningTask == tcb));
+         assert(! twh_isQueued(&tcb->sleepLink));
+         break;
+
+      case TS_READY:
+      case TS_EXHAUSTED:
+         assert(! twh_isQueued(&tcb->sleepLink));
+         break;
+
+      case TS_SLEEPING:
+         assert(twh_isQueued(&tcb->sleepLink));
+         break;
+
+      case TS_WAITING_FOR_MUTEX:
+         assert(! twh_isQueued(&tcb->sleepLink));
+         break;
+
+      case TS_ABOUT_TO_SLEEP:
+      case TS_WAITING_FOR_SEMAPHORE:
+      case TS_WAITING_FOR_CONDITION:
+      case TS_WAITING_FOR_EVENT:
+      case TS_WAITING_FOR_MESSAGE:
+      case TS_WAITING_FOR_NOTIFICATION:
+      case TS_WAITING_FOR_SELECT:
+         // queued on the wheel only if waiting with a timeout
+         break;
+
+      default:
+         assert(false);
+         break;
+   }
+}
+
+#if FX3_AUDIT_LEVEL >= FX3_AUDIT_FULL
+
+/* Check every task, the ready queue and the sleeping wheel, and that each
+ * task is on exactly the structures its state calls for
+ */
+static void verifyTaskControlBlocks(bool expectTaskInRunningState)
+{
+#ifdef FX3_RTT_TRACE
+   //SEGGER_SYSVIEW_RecordVoid(32);
+#endif
 
-      assert(TS_SLEEPING == sleepingTask->state);
+   for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
+   {
+      allValidTaskControlBlocks[ii]->visited = 0;
    }
 
-   for (uint32_t ii = 0; ii < fx3Timer.sleepingTasksNextEpoch->size; ii ++)
+   bool foundTaskInRunningState = false;
+   uint32_t tasksVisited = 0;
+
+   /*
+    * check task links
+    */
+
+   struct task_control_block* tcb = &idleTask;
+   do
    {
-      uint32_t* sleepUntil = fx3Timer.sleepingTasksNextEpoch->memPool[ii + 1];
-      struct task_control_block* sleepingTask = (struct task_control_block*) (((uint8_t*) sleepUntil) - (offsetof(struct task_control_block, sleepUntil_ticks)));;
+      verifyTaskControlBlock(tcb);
 
-      sleepingTask->visited ++;
+      tcb->visited ++;
+
+      tasksVisited ++;
+
+      if (TS_RUNNING == tcb->state)
+      {
+         assert(! foundTaskInRunningState);
+         foundTaskInRunningState = true;
+      }
+
+      tcb = tcb->nextTaskInTheGreatLink;
+
+      assert(isValidTaskControlBlock(tcb));
+   }
+   while (&idleTask != tcb);
 
-      assert(TS_SLEEPING == sleepingTask->state);
+   if (expectTaskInRunningState)
+   {
+      assert(foundTaskInRunningState);
    }
 
-   if (fx3Timer.firstSleepingTaskToAwake)
+   assert(tasksVisited == tasksCreated_count);
+
+   for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
    {
-      assert(1 == fx3Timer.firstSleepingTaskToAwake->visited);
-      fx3Timer.firstSleepingTaskToAwake->visited ++;
+      assert(1 == allValidTaskControlBlocks[ii]->visited);
    }
 
+   /*
+    * check running queue
+    */
+   verifyReadyTasks(NULL, true);
+
+   /*
+    * check sleeping wheel
+    */
+   verifySleepingTasks();
+
    for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
    {
       /*
@@ -410,6 +1034,12 @@ static void verifyTaskControlBlocks(bool expectTaskInRunningState)
       if (1 == allValidTaskControlBlocks[ii]->visited)
       {
          assert((TS_WAITING_FOR_MESSAGE == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_NOTIFICATION == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_SELECT == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_SEMAPHORE == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_CONDITION == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_EVENT == allValidTaskControlBlocks[ii]->state)
+               || (TS_WAITING_FOR_MUTEX == allValidTaskControlBlocks[ii]->state)
                || (TS_RUNNING == allValidTaskControlBlocks[ii]->state)
                || (TS_ABOUT_TO_SLEEP == allValidTaskControlBlocks[ii]->state));
       }
@@ -421,71 +1051,362 @@ static void verifyTaskControlBlocks(bool expectTaskInRunningState)
 #endif
 }
 
-void fx3_initialize(void)
-{
-   idleTask.nextTaskInTheGreatLink = 0;
-
-   tasksCreated_count = 0;
+#endif // FX3_AUDIT_LEVEL >= FX3_AUDIT_FULL
 
-#ifdef FX3_RTT_TRACE
-   SEGGER_SYSVIEW_Conf();
-#endif
+#endif // FX3_AUDIT_LEVEL >= FX3_AUDIT_INCREMENTAL
 
-   prq_initialize(&runnableTasks, runnableTasksMemPool, FX3_MAX_TASK_COUNT + 2);
-   memset(allValidTaskControlBlocks, 0, sizeof(allValidTaskControlBlocks));
+#if FX3_AUDIT_LEVEL == FX3_AUDIT_INCREMENTAL
 
-   prq_initialize(&fx3Timer.sleepingTasks_0, fx3Timer.sleepingTasksMemPool_0, FX3_MAX_TASK_COUNT + 1);
-   prq_initialize(&fx3Timer.sleepingTasks_1, fx3Timer.sleepingTasksMemPool_1, FX3_MAX_TASK_COUNT + 1);
-   fx3Timer.sleepingTasks          = &fx3Timer.sleepingTasks_0;
-   fx3Timer.sleepingTasksNextEpoch = &fx3Timer.sleepingTasks_1;
-   fx3Timer.firstSleepingTaskToAwake = NULL;
+#ifndef FX3_AUDIT_TASKS_PER_IDLE_LOOP
+#define FX3_AUDIT_TASKS_PER_IDLE_LOOP 2
+#endif
 
-   memset(&fx3MessageCenter, 0, sizeof(fx3MessageCenter));
-   bit_initialize(&fx3MessageCenter.available, FX3_COMMAND_QUEUE_SIZE);
+static uint32_t auditCursor;
 
-   sleepCycles = 0;
+/* Run the next steps of the full check: one step per task, then one for
+ * the ready queue and one for the sleeping wheel
+ *
+ * @note called from the idle task, with interrupts disabled, so the
+ * kernel state is consistent while it is inspected
+ */
+static void auditNextTaskControlBlocks(void)
+{
+   for (uint32_t step = 0; step < FX3_AUDIT_TASKS_PER_IDLE_LOOP; step ++)
+   {
+      if (auditCursor < tasksCreated_count)
+      {
+         verifyTaskControlBlock(allValidTaskControlBlocks[auditCursor]);
+      }
+      else if (auditCursor == tasksCreated_count)
+      {
+         verifyReadyTasks(NULL, false);
+      }
+      else
+      {
+         verifySleepingTasks();
+      }
 
-   fx3IsInitialized = true;
+      auditCursor ++;
+      if (tasksCreated_count + 2 <= auditCursor)
+      {
+         auditCursor = 0;
+      }
+   }
+}
 
-   fx3_createTask(&idleTask, &idleTaskConfig);
+#endif // FX3_AUDIT_LEVEL == FX3_AUDIT_INCREMENTAL
 
-#ifdef FX3_RTT_TRACE
-   SEGGER_SYSVIEW_Conf();
+/* Check the kernel state, as thoroughly as FX3_AUDIT_LEVEL asks
+ */
+static inline void auditKernelState(bool expectTaskInRunningState)
+{
+#if FX3_AUDIT_LEVEL >= FX3_AUDIT_FULL
+   verifyTaskControlBlocks(expectTaskInRunningState);
+#elif FX3_AUDIT_LEVEL >= FX3_AUDIT_INVARIANTS
+   verifyKernelInvariants(expectTaskInRunningState);
+#else
+   (void) expectTaskInRunningState;
 #endif
 }
 
-void createTaskImpl(struct task_control_block* tcb, const struct task_config* config, uint32_t* stackPointer, const void* argument)
+#ifdef FX3_CPU_ACCOUNTING
+
+/*
+ * CPU time, in bsp_getCycleCount cycles: the cycles since lastAccountedAt_cycles belong to
+ * the account of whatever runs now, a task, the interrupts or the kernel.
+ */
+static uint32_t lastAccountedAt_cycles;
+static uint64_t* chargedAccount;
+
+static uint64_t elapsedCycles;
+static uint64_t interruptCycles;
+static uint64_t kernelCycles;
+
+/// Account interrupted by the outermost interrupt handler
+static uint64_t* interruptedAccount;
+static uint32_t interruptNesting;
+
+/* Charge the cycles since the last switch to the current account, then
+ * charge the following ones to the given account
+ *
+ * @note interrupts must be disabled
+ * @return the previous account
+ */
+static uint64_t* switchCycleAccount(uint64_t* account)
 {
-   allValidTaskControlBlocks[tasksCreated_count] = tcb;
-   tasksCreated_count ++;
-   assert(tasksCreated_count <= FX3_MAX_TASK_COUNT);
+   const uint32_t now_cycles      = bsp_getCycleCount();
+   const uint32_t elapsed_cycles  = now_cycles - lastAccountedAt_cycles;
+   uint64_t* previousAccount      = chargedAccount;
 
-   tcb->id = tasksCreated_count;
+   lastAccountedAt_cycles  = now_cycles;
+   elapsedCycles          += elapsed_cycles;
+   *previousAccount       += elapsed_cycles;
+   chargedAccount          = account;
 
-   tcb->config = config;
-   tcb->roundRobinSliceLeft_ticks = config->timeSlice_ticks;
+   return previousAccount;
+}
 
-#ifdef FX3_RTT_TRACE
-   if (&idleTask != tcb)
-   {
-      SEGGER_SYSVIEW_TASKINFO taskInfo;
-      memset(&taskInfo, 0, sizeof(taskInfo));
+/* Start counting cycles; until multitasking starts, they are charged to
+ * the kernel
+ */
+static void startCycleAccounting(void)
+{
+   lastAccountedAt_cycles = bsp_getCycleCount();
+   chargedAccount         = &kernelCycles;
+   elapsedCycles          = 0;
+   interruptCycles        = 0;
+   kernelCycles           = 0;
+   interruptNesting       = 0;
+}
 
-      taskInfo.TaskID    = (uint32_t) tcb,
-      taskInfo.sName     = config->name,
-      taskInfo.Prio      = config->priority,
-      taskInfo.StackBase = (uint32_t) stackPointer,
-      taskInfo.StackSize = config->stackSize,
+static void accountInterruptEntry(void)
+{
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
 
-      SEGGER_SYSVIEW_OnTaskCreate((uint32_t) tcb);
-      SEGGER_SYSVIEW_SendTaskInfo(&taskInfo);
+   if (0 == interruptNesting)
+   {
+      interruptedAccount = switchCycleAccount(&interruptCycles);
    }
-#endif
+   interruptNesting ++;
 
-   // park the task for now
-   tcb->effectivePriority = config->priority;
-   prq_push(fx3Timer.sleepingTasks, &tcb->effectivePriority);
+   __set_PRIMASK(primask);
+}
+
+static void accountInterruptExit(void)
+{
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+
+   assert(interruptNesting);
+   interruptNesting --;
+   if (0 == interruptNesting)
+   {
+      switchCycleAccount(interruptedAccount);
+   }
+
+   __set_PRIMASK(primask);
+}
+
+uint32_t fx3_getCpuUsage(struct fx3_cpu_usage* usage, struct fx3_task_cpu_usage* tasks, uint32_t taskCount)
+{
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+
+   // bring the running account up to date
+   switchCycleAccount(chargedAccount);
+
+   usage->elapsed_cycles    = elapsedCycles;
+   usage->interrupts_cycles = interruptCycles;
+   usage->kernel_cycles     = kernelCycles;
+
+   if (taskCount > tasksCreated_count)
+   {
+      taskCount = tasksCreated_count;
+   }
+
+   for (uint32_t ii = 0; ii < taskCount; ii ++)
+   {
+      tasks[ii].task       = allValidTaskControlBlocks[ii];
+      tasks[ii].run_cycles = allValidTaskControlBlocks[ii]->totalRunTime_cycles;
+   }
+
+   __set_PRIMASK(primask);
+
+   return taskCount;
+}
+
+#endif // FX3_CPU_ACCOUNTING
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+
+void bsp_onInterruptEntered(void)
+{
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_INTERRUPT_ENTERED, __get_IPSR());
+#endif
+
+#ifdef FX3_CPU_ACCOUNTING
+   accountInterruptEntry();
+#endif
+}
+
+void bsp_onInterruptExited(void)
+{
+#ifdef FX3_CPU_ACCOUNTING
+   accountInterruptExit();
+#endif
+
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_INTERRUPT_EXITED, __get_IPSR());
+#endif
+}
+
+#endif
+
+void fx3_initialize(void)
+{
+   idleTask.nextTaskInTheGreatLink = 0;
+
+   tasksCreated_count = 0;
+
+#ifdef FX3_RTT_TRACE
+   SEGGER_SYSVIEW_Conf();
+#endif
+
+#ifdef FX3_BITMAP_READY_QUEUE
+   bmq_initialize(&runnableTasks, runnableTasksLevels, runnableTasksBitmap, FX3_READY_QUEUE_LEVEL_COUNT);
+#else
+   ipq_initialize(&runnableTasks, runnableTasksMemPool, FX3_MAX_TASK_COUNT + 1);
+#endif
+   memset(allValidTaskControlBlocks, 0, sizeof(allValidTaskControlBlocks));
+   taskGeneration ++;
+
+   prq_initialize(&parkedTasks, parkedTasksMemPool, FX3_MAX_TASK_COUNT + 1);
+
+   twh_initialize(&fx3Timer.sleepingTasks, bsp_getTimestamp64_ticks());
+#ifdef FX3_SOFTWARE_TIMERS
+   twh_initialize(&fx3Timer.softwareTimers, bsp_getTimestamp64_ticks());
+#endif
+   fx3Timer.wakeUpAlarmAt_ticks = UINT64_MAX;
+
+   memset(&fx3MessageCenter, 0, sizeof(fx3MessageCenter));
+   bma_initialize(&fx3MessageCenter.allocator, fx3MessageCenter.bitmap, FX3_COMMAND_QUEUE_SIZE);
+   fx3MessageCenter.deferredWorkCommand.type = FX3_RUN_DEFERRED_WORK;
+
+   sleepCycles = 0;
+
+#if defined(FX3_CPU_ACCOUNTING) || defined(FX3_TRACE)
+   enableCycleCounter();
+#endif
+
+#ifdef FX3_CPU_ACCOUNTING
+   startCycleAccounting();
+#endif
+
+#ifdef FX3_TRACE
+   trc_initialize(&fx3Trace.ring, fx3Trace.records, FX3_TRACE_RECORD_COUNT);
+#endif
+
+   fx3IsInitialized = true;
+
+   fx3_createTask(&idleTask, &idleTaskConfig);
+
+#ifdef FX3_SOFTWARE_TIMERS
+   fx3_createTask(&timerTask, &timerTaskConfig);
+#endif
+
+#ifdef FX3_RTT_TRACE
+   SEGGER_SYSVIEW_Conf();
+#endif
+}
+
+static void paintStack(const void* stackBase, uint32_t stackSize)
+{
+   uint32_t* word = (uint32_t*) stackBase;
+
+   for (uint32_t ii = 0; ii < stackSize / sizeof(uint32_t); ii ++)
+   {
+      word[ii] = FX3_STACK_PAINT;
+   }
+}
+
+#ifdef FX3_MPU_STACK_GUARD
+
+/// Smallest MPU region
+#define FX3_STACK_GUARD_SIZE  32U
+
+#ifndef FX3_MPU_STACK_GUARD_REGION
+#define FX3_MPU_STACK_GUARD_REGION 7
+#endif
+
+_Static_assert(offsetof(struct task_control_block, stackGuard_rbar) == 2 * sizeof(void*), "context_switch.S loads the stack guard from the third word");
+
+/* Compute the MPU_RBAR value placing the guard region at the lowest aligned
+ * 32 bytes of the stack, and move the stack limit above it
+ *
+ * @param stackPointer is the initial stack pointer; tcb->stackPointer is
+ *                     only set once the initial frame is written
+ */
+static uint32_t computeStackGuard(struct task_control_block* tcb, const uint32_t* stackPointer)
+{
+   const uint32_t guardBase = ((uint32_t) tcb->stackLimit + FX3_STACK_GUARD_SIZE - 1) & ~(FX3_STACK_GUARD_SIZE - 1);
+
+   tcb->stackLimit = (uint32_t*) (guardBase + FX3_STACK_GUARD_SIZE);
+   assert((const uint8_t*) tcb->stackLimit < (const uint8_t*) stackPointer);
+
+   return guardBase | MPU_RBAR_VALID_Msk | FX3_MPU_STACK_GUARD_REGION;
+}
+
+/* Enable the MPU, with the guard region on the stack of the first task;
+ * the privileged default map covers everything else
+ */
+static void enableStackGuard(const struct task_control_block* tcb)
+{
+   MPU->RBAR = tcb->stackGuard_rbar;
+   MPU->RASR = MPU_RASR_XN_Msk                                       // no access, no execution
+      | ((__builtin_ctz(FX3_STACK_GUARD_SIZE) - 1) << MPU_RASR_SIZE_Pos)
+      | MPU_RASR_ENABLE_Msk;
+   MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+
+   __DSB();
+   __ISB();
+}
+
+#endif // FX3_MPU_STACK_GUARD
+
+void createTaskImpl(struct task_control_block* tcb, const struct task_config* config, uint32_t* stackPointer, const void* argument)
+{
+   allValidTaskControlBlocks[tasksCreated_count] = tcb;
+   tasksCreated_count ++;
+   assert(tasksCreated_count <= FX3_MAX_TASK_COUNT);
+
+   tcb->id = tasksCreated_count;
+   tcb->validationTag = computeValidationTag();
+
+#ifdef FX3_BITMAP_READY_QUEUE
+   // every task but idle, which is never queued, needs its own ready level
+   assert((&idleTask == tcb) || (config->priority < FX3_READY_QUEUE_PRIORITY_COUNT));
+#endif
+
+   tcb->totalRunTime_cycles = 0;
+
+   tcb->stackLimit = (uint32_t*) (((uint8_t*) stackPointer + 18 * 4) - config->stackSize);
+#ifdef FX3_MPU_STACK_GUARD
+   tcb->stackGuard_rbar = computeStackGuard(tcb, stackPointer);
+#endif
+
+   tcb->config = config;
+   tcb->priority = config->priority;
+   tcb->roundRobinSliceLeft_ticks = config->timeSlice_ticks;
+
+   twh_initializeEntry(&tcb->sleepLink);
+
+#ifdef FX3_RTT_TRACE
+   if (&idleTask != tcb)
+   {
+      SEGGER_SYSVIEW_TASKINFO taskInfo;
+      memset(&taskInfo, 0, sizeof(taskInfo));
+
+      taskInfo.TaskID    = (uint32_t) tcb,
+      taskInfo.sName     = config->name,
+      taskInfo.Prio      = config->priority,
+      taskInfo.StackBase = (uint32_t) stackPointer,
+      taskInfo.StackSize = config->stackSize,
+
+      SEGGER_SYSVIEW_OnTaskCreate((uint32_t) tcb);
+      SEGGER_SYSVIEW_SendTaskInfo(&taskInfo);
+   }
+#endif
+
+   // park the task for now
+   tcb->readyEntry.priority = config->priority;
+   prq_push(&parkedTasks, &tcb->readyEntry.priority);
 
+#ifdef FX3_POSIX_PORT
+   // the simulated processor keeps the task contexts, on host-sized stacks
+   tcb->stackPointer = posix_createTaskContext(config->handler, argument);
+#else
    // set up stack
    stackPointer[0]  = 0xFFFFFFFDUL;                   // initial EXC_RETURN
    stackPointer[1]  = 0x2;                            // initial CONTROL : privileged, PSP, no FP
@@ -508,6 +1429,7 @@ void createTaskImpl(struct task_control_block* tcb, const struct task_config* co
    stackPointer[17] = 0x01000000;                     // initial xPSR
 
    tcb->stackPointer = stackPointer;
+#endif
 }
 
 void fx3_createTask(struct task_control_block* tcb, const struct task_config* config)
@@ -515,7 +1437,7 @@ void fx3_createTask(struct task_control_block* tcb, const struct task_config* co
    assert(fx3IsInitialized);
 
    memset(tcb, 0, sizeof(*tcb));
-   memset((void*) config->stackBase, 0, config->stackSize);
+   paintStack(config->stackBase, config->stackSize);
 
    uint32_t* stackPointer = (uint32_t*) (((uint8_t*) config->stackBase + config->stackSize) - 18 * 4);
    createTaskImpl(tcb, config, stackPointer, config->argument);
@@ -524,11 +1446,11 @@ void fx3_createTask(struct task_control_block* tcb, const struct task_config* co
 void fx3_createTaskPool(struct task_control_block* tcb, const struct task_config* config, uint32_t argumentSize, uint32_t poolSize)
 {
    memset(tcb, 0, sizeof(*tcb) * poolSize);
-   memset((void*) config->stackBase, 0, config->stackSize * poolSize);
+   paintStack(config->stackBase, config->stackSize * poolSize);
 
    for (uint32_t ii = 0; ii < poolSize; ii ++)
    {
-      uint32_t thisStackBase = (uint32_t) (config->stackBase) + ii * config->stackSize;
+      uintptr_t thisStackBase = (uintptr_t) (config->stackBase) + ii * config->stackSize;
       uint32_t* stackPointer = (uint32_t*) (thisStackBase + config->stackSize - 18 * 4);
       createTaskImpl(&tcb[ii], config, stackPointer, ((const uint8_t*) config->argument) + ii * argumentSize);
    }
@@ -536,12 +1458,12 @@ void fx3_createTaskPool(struct task_control_block* tcb, const struct task_config
 
 static void setupTasksLinks(void)
 {
-   uint32_t* taskPrio = prq_pop(fx3Timer.sleepingTasks);
+   uint32_t* taskPrio = prq_pop(&parkedTasks);
    assert(taskPrio);    // we should have a task
 
    uint32_t lastPrio = *taskPrio;
 
-   struct task_control_block* currentTask = (struct task_control_block*) (((uint8_t*) taskPrio) - (offsetof(struct task_control_block, effectivePriority)));
+   struct task_control_block* currentTask = (struct task_control_block*) (((uint8_t*) taskPrio) - (offsetof(struct task_control_block, readyEntry.priority)));
    assert(&idleTask != currentTask);
 
    struct task_control_block* firstTaskAtCurrentPrio             = currentTask;
@@ -551,10 +1473,10 @@ static void setupTasksLinks(void)
    idleTask.nextWithSamePriority   = &idleTask;
    markTaskReady(currentTask);
 
-   while (! prq_isEmpty(fx3Timer.sleepingTasks))
+   while (! prq_isEmpty(&parkedTasks))
    {
-      taskPrio = prq_pop(fx3Timer.sleepingTasks);
-      struct task_control_block* nextTask = (struct task_control_block*) (((uint8_t*) taskPrio) - (offsetof(struct task_control_block, effectivePriority)));
+      taskPrio = prq_pop(&parkedTasks);
+      struct task_control_block* nextTask = (struct task_control_block*) (((uint8_t*) taskPrio) - (offsetof(struct task_control_block, readyEntry.priority)));
 
       if (*taskPrio == lastPrio)
       {
@@ -592,11 +1514,6 @@ static void setupTasksLinks(void)
       markTaskReady(currentTask);
    }
 
-   memset(fx3Timer.sleepingTasksMemPool_0, 0, sizeof(fx3Timer.sleepingTasksMemPool_0));
-   memset(fx3Timer.sleepingTasksMemPool_1, 0, sizeof(fx3Timer.sleepingTasksMemPool_1));
-   prq_initialize(&fx3Timer.sleepingTasks_0, fx3Timer.sleepingTasksMemPool_0, FX3_MAX_TASK_COUNT + 1);
-   prq_initialize(&fx3Timer.sleepingTasks_1, fx3Timer.sleepingTasksMemPool_1, FX3_MAX_TASK_COUNT + 1);
-
    /*
     * the last task is the idleTask, as it has the lowest priority
     */
@@ -607,18 +1524,31 @@ void fx3_startMultitasking(void)
 {
    setupTasksLinks();
 
-   uint32_t* firstTaskPrio = prq_pop(&runnableTasks);
-
-   runningTask = (struct task_control_block*) (((uint8_t*) firstTaskPrio) - (offsetof(struct task_control_block, effectivePriority)));
+   runningTask = popReadyTask();
    assert(TS_READY == runningTask->state);
    runningTask->state = TS_RUNNING;
    runningTask->startedRunningAt_ticks = bsp_getTimestamp_ticks();
 
-   uint32_t runningTaskPSP = (uint32_t) (runningTask->stackPointer + 16);
+#ifdef FX3_CPU_ACCOUNTING
+   __disable_irq();
+   switchCycleAccount(&runningTask->totalRunTime_cycles);
+   __enable_irq();
+#endif
+
+   uint32_t runningTaskPSP = (uint32_t) (uintptr_t) (runningTask->stackPointer + 16);
+
+#ifdef FX3_MPU_STACK_GUARD
+   enableStackGuard(runningTask);
+#endif
 
    bsp_startMainClock();
 
-   verifyTaskControlBlocks(true);
+#ifdef FX3_SOFTWARE_TIMERS
+   // arm the alarm for the timers started before multitasking
+   wakeUpSleepingTasks();
+#endif
+
+   auditKernelState(true);
 
    fx3_startMultitaskingImpl(runningTaskPSP, runningTask->config->handler, runningTask->config->argument);
 }
@@ -645,12 +1575,9 @@ static void selectNextRunningTask(void)
    runningTask->totalRunTime_ticks += runTime;
    runningTask->startedRunningAt_ticks = 0;
 
-   verifyTaskControlBlocks(false);
+   auditKernelState(false);
 
-   uint32_t* nextRunningTaskPriority = prq_pop(&runnableTasks);
-   assert(nextRunningTaskPriority);    // idle task, if nothing else
-
-   nextRunningTask = (struct task_control_block*) (((uint8_t*) nextRunningTaskPriority) - (offsetof(struct task_control_block, effectivePriority)));
+   nextRunningTask = popReadyTask();
 
    if (TS_EXHAUSTED == nextRunningTask->state)
    {
@@ -663,7 +1590,7 @@ static void selectNextRunningTask(void)
        */
       nextRunningTask->state                     = TS_READY;
       nextRunningTask->roundRobinSliceLeft_ticks = nextRunningTask->config->timeSlice_ticks;
-      nextRunningTask->effectivePriority         = computeEffectivePriority(runningTask->state, runningTask->config);
+      nextRunningTask->readyEntry.priority       = computeEffectivePriority(TS_READY, nextRunningTask);
 
       for (struct task_control_block* tcb = nextRunningTask->nextWithSamePriority; tcb != nextRunningTask; tcb = tcb->nextWithSamePriority)
       {
@@ -672,14 +1599,31 @@ static void selectNextRunningTask(void)
          if (TS_EXHAUSTED == tcb->state)
          {
             tcb->state             = TS_READY;
-            tcb->effectivePriority = computeEffectivePriority(runningTask->state, runningTask->config);
+            tcb->readyEntry.priority = computeEffectivePriority(TS_READY, tcb);
          }
          else
          {
-            assert((TS_SLEEPING == tcb->state) || (TS_WAITING_FOR_MESSAGE == tcb->state));
+            assert((TS_SLEEPING == tcb->state)
+                  || (TS_WAITING_FOR_MUTEX == tcb->state)
+                  || (TS_WAITING_FOR_SEMAPHORE == tcb->state)
+                  || (TS_WAITING_FOR_CONDITION == tcb->state)
+                  || (TS_WAITING_FOR_EVENT == tcb->state)
+                  || (TS_WAITING_FOR_MESSAGE == tcb->state)
+                  || (TS_WAITING_FOR_NOTIFICATION == tcb->state)
+                  || (TS_WAITING_FOR_SELECT == tcb->state));
          }
          tcb->roundRobinSliceLeft_ticks = nextRunningTask->config->timeSlice_ticks;
       }
+
+#ifdef FX3_BITMAP_READY_QUEUE
+      /*
+       * The peers are still queued on the exhausted level; move them,
+       * in order, to the ready level of the same priority.
+       */
+      bmq_appendLevel(&runnableTasks,
+            computeReadyLevel(TS_EXHAUSTED, nextRunningTask),
+            computeReadyLevel(TS_READY, nextRunningTask));
+#endif
    }
 
    assert(TS_READY == nextRunningTask->state);
@@ -688,17 +1632,21 @@ static void selectNextRunningTask(void)
    {
       assert(nextRunningTask->roundRobinSliceLeft_ticks);
 
-      uint32_t roundRobinDeadline = 0;
-      bsp_computeWakeUp_ticks(nextRunningTask->roundRobinSliceLeft_ticks, &roundRobinDeadline);
+      const uint64_t roundRobinDeadline_ticks = bsp_getTimestamp64_ticks() + nextRunningTask->roundRobinSliceLeft_ticks;
       roundRobinTimeoutFor = nextRunningTask;
-      bsp_requestRoundRobinSliceTimeout_ticks(roundRobinDeadline);
+      // the hardware timer matches on the low bits, like the wake-up alarm
+      bsp_requestRoundRobinSliceTimeout_ticks((uint32_t) roundRobinDeadline_ticks);
    }
 
    nextRunningTask->state = TS_RUNNING;
    nextRunningTask->startedRunning_count ++;
    nextRunningTask->startedRunningAt_ticks = lastContextSwitchAt;
 
-   verifyTaskControlBlocks(true);
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_CONTEXT_SWITCH, nextRunningTask->id);
+#endif
+
+   auditKernelState(true);
 
 #ifdef FX3_RTT_TRACE
    if (&idleTask != nextRunningTask)
@@ -713,576 +1661,2767 @@ static void selectNextRunningTask(void)
 }
 
 
-/** Transition this task from running to asleep
- *
- */
-bool handleSleepRequest(struct fx3_command* cmd)
+static inline struct task_control_block* getWaitingTask(struct pairing_heap_node* waitLink)
 {
-   assert(FX3_TIMER_REQUEST_SUSPEND == cmd->type);
+   if (NULL == waitLink)
+   {
+      return NULL;
+   }
 
-   struct task_control_block* sleepyTask = cmd->task;
-   uint32_t timeout_ms = (uint32_t) cmd->object;
-   freeFX3Command(cmd);
+   return (struct task_control_block*) (((uint8_t*) waitLink) - (offsetof(struct task_control_block, waitLink)));
+}
 
-   bsp_disableSystemTimer();
+/* Move the late arrivals from the antechamber to the wait queue
+ */
+static void collectWaiters(volatile struct list_element** antechamber, struct pairing_heap* waitQueue)
+{
+   // fetch late arrivals; most recent first
+   struct list_element* todo     = lst_fetchAll(antechamber);
+   struct list_element* arrivals = NULL;
 
+   // reverse them, so tasks with the same priority are served in arrival order
+   while (todo)
    {
-      /*
-       * verify tcb points to a valid task
-       */
-      uint32_t tt = 0;
-      while (tt < tasksCreated_count)
-      {
-         if (allValidTaskControlBlocks[tt] == sleepyTask)
-         {
-            break;
-         }
-         else
-         {
-            tt ++;
-         }
-      }
-      assert(tt < tasksCreated_count);
+      struct list_element* next = todo->next;
+      todo->next = arrivals;
+      arrivals   = todo;
+      todo       = next;
    }
 
-   assert(TS_ABOUT_TO_SLEEP == sleepyTask->state);
-   sleepyTask->state = TS_SLEEPING;
-   assert(timeout_ms);
-
-   const uint32_t sleepDuration_ticks = bsp_getTicksForMS(timeout_ms);
-
-   if (sleepyTask->config->timeSlice_ticks)
+   while (arrivals)
    {
-      /*
-       * This task will sleep more than a full period of round-robin
-       * scheduling at this priority so replenish its full slice.
-       */
+      struct task_control_block* tcb = (struct task_control_block*) arrivals;
+      arrivals  = arrivals->next;
+      tcb->next = NULL;
 
-      if (sleepDuration_ticks >= sleepyTask->roundRobinCumulative_ticks)
-      {
-         sleepyTask->roundRobinSliceLeft_ticks = sleepyTask->config->timeSlice_ticks;
-      }
+      phq_insert(waitQueue, &tcb->waitLink, tcb->priority);
    }
+}
 
-   sleepyTask->effectivePriority = 0xffff;
+/* Take the highest priority task off the wait queue, without waking it up
+ *
+ * @return the task, or NULL if none is waiting
+ */
+static struct task_control_block* popWaiter(struct pairing_heap* waitQueue)
+{
+   return getWaitingTask(phq_pop(waitQueue));
+}
 
-   bool nextEpoch = bsp_computeWakeUp_ticks(sleepDuration_ticks, &sleepyTask->sleepUntil_ticks);
-   if (nextEpoch)
-   {
-      prq_push(fx3Timer.sleepingTasksNextEpoch, &sleepyTask->sleepUntil_ticks);
-   }
-   else
-   {
-      /*
-       * the sleep will complete this epoch
-       */
+/* Take this task off the wait queue, without waking it up
+ */
+static void removeWaiter(volatile struct list_element** antechamber, struct pairing_heap* waitQueue, struct task_control_block* tcb)
+{
+   collectWaiters(antechamber, waitQueue);
 
-      if (NULL == fx3Timer.firstSleepingTaskToAwake)
-      {
-         /*
-          * there is no other sleeping task
-          */
+   phq_remove(waitQueue, &tcb->waitLink);
+}
 
-         assert(prq_isEmpty(fx3Timer.sleepingTasks));
+/* Re-key this task on the wait queue, after its priority changed
+ */
+static void repositionWaiter(volatile struct list_element** antechamber, struct pairing_heap* waitQueue, struct task_control_block* tcb)
+{
+   collectWaiters(antechamber, waitQueue);
 
-         fx3Timer.firstSleepingTaskToAwake = sleepyTask;
-         bsp_wakeUpAt_ticks(sleepyTask->sleepUntil_ticks);
-      }
-      else
-      {
-         assert(TS_SLEEPING == fx3Timer.firstSleepingTaskToAwake->state);
-         if (fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks > sleepyTask->sleepUntil_ticks)
-         {
-            /*
-             * this new task is sleeping less than the previous task with the shortest sleep
-             */
+   tcb->readyEntry.priority = computeEffectivePriority(TS_READY, tcb);
 
-            prq_push(fx3Timer.sleepingTasks, &fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks);
+   phq_update(waitQueue, &tcb->waitLink, tcb->priority);
+}
 
-            fx3Timer.firstSleepingTaskToAwake = sleepyTask;
-            bsp_wakeUpAt_ticks(sleepyTask->sleepUntil_ticks);
-         }
-         else
-         {
-            prq_push(fx3Timer.sleepingTasks, &sleepyTask->sleepUntil_ticks);
-         }
-      }
-   }
+/*
+ * Mutexes
+ */
 
-   bsp_enableSystemTimer();
+/// Set in mutex::owner when tasks are waiting for the mutex
+#define MUTEX_CONTENDED    ((uintptr_t) 1)
 
-   return true;
+static inline struct task_control_block* getMutexOwner(const struct mutex* mtx)
+{
+   return (struct task_control_block*) (mtx->owner & ~MUTEX_CONTENDED);
 }
 
-static void cancelRoundRobin()
+/* Compute the nominal priority of this task: its configured priority,
+ * raised to the priority of the highest priority task waiting on a mutex
+ * it holds
+ */
+static uint32_t computeInheritedPriority(const struct task_control_block* tcb)
 {
-   if (runningTask->config->timeSlice_ticks)
+   uint32_t priority = tcb->config->priority;
+
+   for (const struct mutex* mtx = tcb->contendedMutexes; mtx; mtx = mtx->nextContended)
    {
-      uint32_t runTime = bsp_computeInterval_ticks(runningTask->startedRunningAt_ticks, bsp_getTimestamp_ticks());
-      assert(runningTask->roundRobinSliceLeft_ticks >= runTime);
-      runningTask->roundRobinSliceLeft_ticks -= runTime;
-      bsp_cancelRoundRobinSliceTimeout();
+      const struct task_control_block* highestPriorityWaitingTask = getWaitingTask(phq_peek(&mtx->waitQueue));
+      assert(highestPriorityWaitingTask);
+
+      if (highestPriorityWaitingTask->priority < priority)
+      {
+         priority = highestPriorityWaitingTask->priority;
+      }
    }
+
+   return priority;
 }
 
-void fx3_suspendTask(uint32_t timeout_ms)
+/* Change the nominal priority of this task, and re-key it on the ready
+ * queue or on the wait list it is on
+ */
+static void changeTaskPriority(struct task_control_block* tcb, uint32_t priority)
 {
-   assert(timeout_ms);
+   switch (tcb->state)
+   {
+      case TS_READY:
+      case TS_EXHAUSTED:
+#ifdef FX3_BITMAP_READY_QUEUE
+         {
+            bool isRemoved = bmq_remove(&runnableTasks, &tcb->readyLink, computeReadyLevel(tcb->state, tcb));
+            assert(isRemoved);
+            (void) isRemoved;
+         }
+#endif
 
-   runningTask->state = TS_ABOUT_TO_SLEEP;
-   cancelRoundRobin();
+         tcb->priority = priority;
 
-   struct fx3_command* cmd = allocateFX3Command();
+         if ((TS_EXHAUSTED == tcb->state) && (tcb->priority != tcb->config->priority))
+         {
+            // see markTaskReady
+            tcb->roundRobinSliceLeft_ticks = tcb->config->timeSlice_ticks;
+            tcb->state                     = TS_READY;
+         }
 
-   cmd->type   = FX3_TIMER_REQUEST_SUSPEND;
-   cmd->task   = runningTask;
-   cmd->object = (void*) timeout_ms;
+         tcb->readyEntry.priority = computeEffectivePriority(tcb->state, tcb);
 
-   postFX3Command(cmd);
-}
+#ifdef FX3_BITMAP_READY_QUEUE
+         pushReadyTask(tcb);
+#else
+         {
+            bool isQueued = ipq_update(&runnableTasks, &tcb->readyEntry);
+            assert(isQueued);
+            (void) isQueued;
+         }
+#endif
+         break;
 
-void task_block(enum task_state newState)
-{
-   assert(TS_WAITING_FOR_MUTEX <= newState);
-   assert(TS_STATE_COUNT > newState);
+      case TS_RUNNING:
+         tcb->priority            = priority;
+         tcb->readyEntry.priority = computeEffectivePriority(TS_READY, tcb);
+         break;
 
-   cancelRoundRobin();
+      case TS_WAITING_FOR_SEMAPHORE:
+         {
+            struct semaphore* sem = tcb->waitingOn;
 
-   runningTask->state = newState;
+            tcb->priority = priority;
+            repositionWaiter(&sem->antechamber, &sem->waitQueue, tcb);
+         }
+         break;
 
-   if (TS_WAITING_FOR_MESSAGE == newState)
-   {
-      struct fx3_command* cmd = allocateFX3Command();
+      case TS_WAITING_FOR_MUTEX:
+         {
+            struct mutex* mtx = tcb->waitingOn;
 
-      cmd->type   = FX3_CHECK_INBOX_FOR_LATE_ARRIVAL;
-      cmd->task   = runningTask;
-      cmd->object = 0;
+            tcb->priority = priority;
+            repositionWaiter(&mtx->antechamber, &mtx->waitQueue, tcb);
+         }
+         break;
 
-      postFX3Command(cmd);
-   }
-   else
-   {
-      bsp_scheduleContextSwitch();
+      case TS_WAITING_FOR_CONDITION:
+         {
+            // waiters are queued by the kernel, there is no antechamber
+            struct condition_variable* cond = tcb->waitingOn;
+
+            tcb->priority            = priority;
+            tcb->readyEntry.priority = computeEffectivePriority(TS_READY, tcb);
+            phq_update(&cond->waitQueue, &tcb->waitLink, tcb->priority);
+         }
+         break;
+
+      default:
+         // picks up the new priority when it becomes ready
+         tcb->priority = priority;
+         break;
    }
 }
 
-static bool handleWakeUpAlarm(struct fx3_command* cmd)
+/* Recompute the nominal priority of this task, and propagate the change
+ * along the chain of mutex owners it is waiting on
+ */
+static void updateInheritedPriority(struct task_control_block* tcb)
 {
-   assert(FX3_TIMER_EVENT_WAKEUP == cmd->type);
-   struct task_control_block* sleepingTaskToAwake = cmd->task;
-   freeFX3Command(cmd);
-
-   assert(fx3Timer.firstSleepingTaskToAwake == sleepingTaskToAwake);
-   fx3Timer.firstSleepingTaskToAwake = NULL;
-
-   bool runningTaskDethroned = markTaskReady(sleepingTaskToAwake);
-   /*
-    * done with the task that was waiting to be woken up
-    */
-
-   // who's next?
-   while ((NULL == fx3Timer.firstSleepingTaskToAwake) && (! prq_isEmpty(fx3Timer.sleepingTasks)))
+   while (tcb)
    {
-      uint32_t* nextWakeupDeadline = prq_pop(fx3Timer.sleepingTasks);
-      assert(nextWakeupDeadline);
-
-      fx3Timer.firstSleepingTaskToAwake = (struct task_control_block*) (((uint8_t*) nextWakeupDeadline) - (offsetof(struct task_control_block, sleepUntil_ticks)));
-      assert(TS_SLEEPING == fx3Timer.firstSleepingTaskToAwake->state);
-      if (*nextWakeupDeadline <= bsp_getTimestamp_ticks())
+      uint32_t priority = computeInheritedPriority(tcb);
+      if (priority == tcb->priority)
       {
-         if (markTaskReady(fx3Timer.firstSleepingTaskToAwake))
-         {
-            runningTaskDethroned = true;
-         }
-         fx3Timer.firstSleepingTaskToAwake = NULL;
+         break;
       }
-   }
 
-   if (fx3Timer.firstSleepingTaskToAwake)
-   {
-      bsp_wakeUpAt_ticks(fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks);
-   }
-   else
-   {
-      assert(prq_isEmpty(fx3Timer.sleepingTasks));
-   }
+      changeTaskPriority(tcb, priority);
 
-   if (runningTaskDethroned)
-   {
-      cancelRoundRobin();
-      markTaskReady(runningTask);
+      if (TS_WAITING_FOR_MUTEX == tcb->state)
+      {
+         tcb = getMutexOwner(tcb->waitingOn);
+      }
+      else
+      {
+         tcb = NULL;
+      }
    }
-
-   return runningTaskDethroned;
-}
-
-bool bsp_onWokenUp(void)
-{
-   fx3Timer.lastWokenUpAt = bsp_getTimestamp_ticks();
-
-   assert(fx3Timer.firstSleepingTaskToAwake);
-   assert(fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks <= fx3Timer.lastWokenUpAt);
-   assert(TS_SLEEPING == fx3Timer.firstSleepingTaskToAwake->state);
-
-   struct fx3_command* cmd = allocateFX3Command();
-
-   cmd->type = FX3_TIMER_EVENT_WAKEUP;
-   cmd->task = fx3Timer.firstSleepingTaskToAwake;
-
-   postFX3Command(cmd);
-
-   return true;
 }
 
-static bool handleEpochRollover(struct fx3_command* cmd)
+/* Give the mutex to its highest priority waiting task, if any
+ *
+ * @return true if the new owner should preempt the running task
+ */
+static bool handOverMutex(struct mutex* mtx)
 {
-   assert(FX3_TIMER_EVENT_EPOCH_ROLLOVER == cmd->type);
-   freeFX3Command(cmd);
+   struct task_control_block* newOwner = popWaiter(&mtx->waitQueue);
 
-   assert(prq_isEmpty(fx3Timer.sleepingTasks));
-
-   // swap queues
+   if (NULL == newOwner)
    {
-      struct priority_queue* temp     = fx3Timer.sleepingTasks;
-      fx3Timer.sleepingTasks          = fx3Timer.sleepingTasksNextEpoch;
-      fx3Timer.sleepingTasksNextEpoch = temp;
+      mtx->owner = 0;
+      return false;
    }
 
-   bool runningTaskDethroned = false;
-
-   while ((NULL == fx3Timer.firstSleepingTaskToAwake) && (! prq_isEmpty(fx3Timer.sleepingTasks)))
-   {
-      uint32_t* nextWakeupDeadline = prq_pop(fx3Timer.sleepingTasks);
-      assert(nextWakeupDeadline);
+   assert(TS_WAITING_FOR_MUTEX == newOwner->state);
+   assert(mtx == newOwner->waitingOn);
 
-      fx3Timer.firstSleepingTaskToAwake = (struct task_control_block*) (((uint8_t*) nextWakeupDeadline) - (offsetof(struct task_control_block, sleepUntil_ticks)));
-      assert(TS_SLEEPING == fx3Timer.firstSleepingTaskToAwake->state);
-      if (0 == fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks)
-      {
-         if (markTaskReady(fx3Timer.firstSleepingTaskToAwake))
-         {
-            runningTaskDethroned = true;
-         }
-         fx3Timer.firstSleepingTaskToAwake = NULL;
-      }
-   }
+   newOwner->waitingOn = NULL;
 
-   if (fx3Timer.firstSleepingTaskToAwake)
+   if (! phq_isEmpty(&mtx->waitQueue))
    {
-      bsp_wakeUpAt_ticks(fx3Timer.firstSleepingTaskToAwake->sleepUntil_ticks);
+      mtx->owner                 = ((uintptr_t) newOwner) | MUTEX_CONTENDED;
+      mtx->nextContended         = newOwner->contendedMutexes;
+      newOwner->contendedMutexes = mtx;
    }
    else
    {
-      assert(prq_isEmpty(fx3Timer.sleepingTasks));
+      mtx->owner = (uintptr_t) newOwner;
    }
 
-   if (runningTaskDethroned)
-   {
-      cancelRoundRobin();
-      markTaskReady(runningTask);
-   }
+   // off all lists, so no need to re-key
+   newOwner->priority = computeInheritedPriority(newOwner);
 
-   return runningTaskDethroned;
+   return markTaskReady(newOwner);
 }
 
-bool bsp_onEpochRollover(void)
+/* Move a task that was waiting on a condition variable to the mutex it
+ * has to lock again (wait morphing): it takes the mutex right away if it
+ * is unlocked, otherwise it waits for the mutex to be handed over
+ *
+ * @param tcb is a task taken off the wait queue of a condition variable
+ * @param mtx is the mutex of the condition variable
+ * @return true if the task, or the mutex owner, should preempt the running task
+ */
+static bool moveWaiterToMutex(struct task_control_block* tcb, struct mutex* mtx)
 {
-   assert(NULL == fx3Timer.firstSleepingTaskToAwake);
-
-   struct fx3_command* cmd = allocateFX3Command();
+   // the wait for the mutex has no timeout
+   twh_cancel(&fx3Timer.sleepingTasks, &tcb->sleepLink);
 
-   cmd->type = FX3_TIMER_EVENT_EPOCH_ROLLOVER;
+   struct task_control_block* owner = getMutexOwner(mtx);
+   assert(owner != tcb);
 
-   postFX3Command(cmd);
+   if (NULL == owner)
+   {
+      /*
+       * A task about to wait for the mutex finds it owned when the kernel
+       * gets to its command, as after handOverMutex.
+       */
+      tcb->waitingOn = NULL;
+      mtx->owner     = (uintptr_t) tcb;
 
-   return true;
-}
+      return markTaskReady(tcb);
+   }
 
-bool bsp_onRoundRobinSliceTimeout(void)
-{
-   assert(TS_RUNNING == runningTask->state);
-   assert(roundRobinTimeoutFor == runningTask);
-   assert(runningTask->config->timeSlice_ticks);
+   // see handleMutexLock
+   if (phq_isEmpty(&mtx->waitQueue))
+   {
+      mtx->nextContended      = owner->contendedMutexes;
+      owner->contendedMutexes = mtx;
+   }
 
-   roundRobinTimeoutFor = NULL;
-   runningTask->roundRobinSliceLeft_ticks = 0;
+   tcb->state     = TS_WAITING_FOR_MUTEX;
+   tcb->waitingOn = mtx;
+   phq_insert(&mtx->waitQueue, &tcb->waitLink, tcb->priority);
 
-   scheduleReadyTask(runningTask);
+   mtx->owner = ((uintptr_t) owner) | MUTEX_CONTENDED;
 
-   bsp_scheduleContextSwitch();
+   updateInheritedPriority(owner);
 
    return true;
 }
 
-struct task_control_block* fx3_getRunningTask(void)
-{
-   return runningTask;
-}
-
-void fx3_sendMessage(struct task_control_block* tcb, struct list_element* msg)
+/* The flags of a wait on an event group that are set, if the wait is
+ * satisfied
+ *
+ * @return the matching flags, or 0 if the wait is not satisfied
+ */
+static inline uint32_t matchEvents(uint32_t setFlags, uint32_t flags, uint32_t options)
 {
-   /*
-    * There is an efficient lock-free stack push algorithm for
-    * multiple producers. This leaves us with a list of messages
-    * in the reverse order of insertion.
-    *
-    * The lock-free stack pop is quite involved for the multiple
-    * consumer case, but it is trivial for the single consumer case:
-    * just swap the 'full' incoming queue with the 'empty' todo list.
-    *
-    * Then, we just have to reverse the order of the todo list which
-    * can be done efficiently in linear time.
-    */
-
-   // lock-free push msg into the stack pointed to by tcb->inbox
-   lst_pushElement(&tcb->inbox, msg);
+   const uint32_t matched = setFlags & flags;
 
-   // make tcb runnable if blocked on its queue
-   if (TS_WAITING_FOR_MESSAGE == tcb->state)
+   if ((FX3_EVENTS_WAIT_ALL & options) && (matched != flags))
    {
-      scheduleReadyTask(tcb);
+      return 0;
    }
+
+   return matched;
 }
 
-struct list_element* fx3_waitForMessage(void)
+/* Take the flags of a wait on an event group, if it is satisfied;
+ * interrupt handlers may change the flags in the mean time
+ *
+ * @return the matching flags, or 0 if the wait is not satisfied
+ */
+static uint32_t takeEvents(struct event_group* grp, uint32_t flags, uint32_t options)
 {
-   struct task_control_block* thisTask = runningTask;
-
-   /*
-    * There is no need to protect messageQueue, this is the only function
-    * that operates on it.
-    */
+   uint32_t setFlags = __atomic_load_n(&grp->flags, __ATOMIC_ACQUIRE);
 
-   while (! thisTask->messageQueue)
+   while (true)
    {
-      // lock-free fetch the inbox variable and simultaneously reset it
-      struct list_element* todo = lst_fetchAll(&thisTask->inbox);
+      const uint32_t matched = matchEvents(setFlags, flags, options);
 
-      if (todo)
+      if ((0 == matched) || (0 == (FX3_EVENTS_CLEAR_ON_EXIT & options)))
       {
-         /*
-          * Elements in the todo list are in the reverse order (most
-          * recent element is first). We need to process messages
-          * in FIFO order.
-          *
-          * So, treat both todo and message queue as stacks again,
-          * unstacking from todo and stacking into message queue.
-          *
-          * This will reverse the order, and the first message in the
-          * message queue is the oldest.
-          */
-         while (todo)
-         {
-            struct list_element* next = todo->next;
-            todo->next                = thisTask->messageQueue;
-            thisTask->messageQueue    = todo;
-            todo                      = next;
-         }
+         return matched;
       }
-      else
+
+      if (__atomic_compare_exchange_n(&grp->flags, &setFlags, setFlags & ~flags, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
       {
-         task_block(TS_WAITING_FOR_MESSAGE);
+         return matched;
       }
    }
-
-   struct list_element* msg  = thisTask->messageQueue;
-   thisTask->messageQueue    = msg->next;
-   msg->next                 = NULL;
-
-   return msg;
 }
 
-static inline int __attribute__((pure)) compareTaskPriorities(const struct list_element* left, const struct list_element* right) 
+/* Take this task off the waiting list of the event group
+ */
+static void removeEventWaiter(struct event_group* grp, struct task_control_block* tcb)
 {
-   const struct task_control_block* leftTask  = (const struct task_control_block*) left;
-   const struct task_control_block* rightTask = (const struct task_control_block*) right;
+   struct task_control_block* volatile* link = &grp->waiters;
 
-   if (leftTask->effectivePriority < rightTask->effectivePriority)
-   {
-      return -1;
-   }
-   else
+   while (*link != tcb)
    {
-      return 1;
+      assert(*link);
+      link = &(*link)->next;
    }
+
+   *link     = tcb->next;
+   tcb->next = NULL;
 }
 
-static bool handleSemaphoreSignal(struct fx3_command* cmd)
+/* The sleep, or the wait with a timeout, of this task has expired
+ *
+ * @return true if the task should preempt the running task
+ */
+static bool expireTaskTimeout(struct task_control_block* tcb)
 {
-   assert(FX3_SIGNAL_SEMAPHORE == cmd->type);
-   struct semaphore* sem = cmd->object;
-   freeFX3Command(cmd);
+   switch (tcb->state)
+   {
+      case TS_SLEEPING:
+         break;
 
-   bool runningTaskDethroned = false;
+      case TS_WAITING_FOR_SEMAPHORE:
+         // the signal did not fire first; cancel the wait
+         {
+            struct semaphore* sem = tcb->waitingOn;
+            removeWaiter(&sem->antechamber, &sem->waitQueue, tcb);
+         }
+         tcb->waitTimedOut = true;
+         break;
 
-   // fetch late arrivals
-   struct list_element* todo = lst_fetchAll(&sem->antechamber);
+      case TS_WAITING_FOR_CONDITION:
+         // not signaled in time; still has to lock the mutex again
+         {
+            struct condition_variable* cond = tcb->waitingOn;
+            phq_remove(&cond->waitQueue, &tcb->waitLink);
+            tcb->waitTimedOut = true;
 
-   assert(lst_isSortedAscending(&sem->waitList->element, compareTaskPriorities));
+            return moveWaiterToMutex(tcb, cond->mutex);
+         }
 
-   /*
-    * merge tasks from antechamber into wait list
-    */
-   if ((NULL == sem->waitList) && (todo) && (NULL == todo->next))
+      case TS_WAITING_FOR_EVENT:
+         removeEventWaiter(tcb->waitingOn, tcb);
+         tcb->waitTimedOut = true;
+         break;
+
+      case TS_WAITING_FOR_MESSAGE:
+      case TS_WAITING_FOR_NOTIFICATION:
+      case TS_WAITING_FOR_SELECT:
+         tcb->waitTimedOut = true;
+         break;
+
+      default:
+         assert(false);
+         break;
+   }
+
+   return markTaskReady(tcb);
+}
+
+#ifdef FX3_SOFTWARE_TIMERS
+/* Hand this expired timer to the timer task, and re-arm it if periodic
+ *
+ * @return true if the timer task should preempt the running task
+ */
+static bool fireTimer(struct timer* tmr, uint64_t now_ticks)
+{
+   if (TT_PERIODIC == tmr->config->type)
    {
-      // shortcut; target empty, source has only one element
-      sem->waitList = (struct task_control_block*) todo;
+      assert(tmr->config->interval_tick);
+
+      /*
+       * Re-arm relative to the deadline, not to now, so the period does
+       * not drift; skip the periods that were missed entirely.
+       */
+      uint64_t deadline_ticks = tmr->wheelLink.deadline_ticks + tmr->config->interval_tick;
+      while (deadline_ticks <= now_ticks)
+      {
+         deadline_ticks += tmr->config->interval_tick;
+         tmr->overrun_count ++;
+      }
+
+      bool isQueued = twh_insert(&fx3Timer.softwareTimers, &tmr->wheelLink, deadline_ticks);
+      assert(isQueued);
+      (void) isQueued;
    }
    else
    {
-      lst_mergeListIntoSortedList((struct list_element**) &sem->waitList, todo, compareTaskPriorities);
+      tmr->status = TMR_FIRED;
    }
 
-   // select the highest priority waiting task and mark ready
-   struct task_control_block* highestPriorityWaitingTask = sem->waitList;
-   if (highestPriorityWaitingTask)
+   if (tmr->isPending)
    {
-      assert(TS_WAITING_FOR_SEMAPHORE == highestPriorityWaitingTask->state);
+      // the previous expiration did not get its callback yet
+      tmr->overrun_count ++;
+      return false;
+   }
 
-      sem->waitList                    = highestPriorityWaitingTask->next;
-      highestPriorityWaitingTask->next = NULL;
+   tmr->isPending = true;
+   lst_pushElement(&timerTask.inbox, &tmr->firedLink);
 
-      if (markTaskReady(highestPriorityWaitingTask))
-      {
-         runningTaskDethroned = true;
-      }
+   if (TS_WAITING_FOR_MESSAGE == timerTask.state)
+   {
+      return markTaskReady(&timerTask);
    }
-
-   if (runningTaskDethroned)
+   else
    {
-      cancelRoundRobin();
-      markTaskReady(runningTask);
+      return false;
    }
-
-   return runningTaskDethroned;
 }
+#endif
 
-bool fx3_processPendingCommands(void)
+/* Wake up all the tasks whose sleep or wait deadline has passed, and fire
+ * the expired timers, then arm the alarm for the earliest remaining deadline
+ *
+ * @return true if a task that was woken up should preempt the running task
+ */
+static bool wakeUpSleepingTasks(void)
 {
-   bool contextSwitchNeeded = (TS_RUNNING != runningTask->state);
-
-   verifyTaskControlBlocks(false);
+   bool runningTaskDethroned = false;
 
    while (true)
    {
-      // lock-free fetch the inbox variable and simultaneously reset it
-      struct fx3_command* todo = (struct fx3_command*) lst_fetchAll(&fx3MessageCenter.inbox);
+      const uint64_t now_ticks = bsp_getTimestamp64_ticks();
 
-      if (! todo)
-      {
-         break;
-      }
-      else
+      /*
+       * all tasks due at the same tick come out of the wheel together
+       */
+      struct timer_wheel_entry* expired = twh_advance(&fx3Timer.sleepingTasks, now_ticks);
+
+      while (expired)
       {
-         struct fx3_command* messageQueue = NULL;
+         struct task_control_block* sleepingTask = (struct task_control_block*) (((uint8_t*) expired) - (offsetof(struct task_control_block, sleepLink)));
+         expired = expired->next;
 
-         /*
-          * Elements in the todo list are in the reverse order (most
-          * recent element is first). We need to process messages
-          * in FIFO order.
-          *
-          * So, treat both todo and message queue as stacks again,
-          * unstacking from todo and stacking into message queue.
-          *
-          * This will reverse the order, and the first message in the
-          * message queue is the oldest.
-          */
-         while (todo)
+         if (expireTaskTimeout(sleepingTask))
          {
-            struct fx3_command* next = todo->next;
-            todo->next               = messageQueue;
-            messageQueue             = todo;
-            todo                     = next;
+            runningTaskDethroned = true;
          }
+      }
 
-         while (messageQueue)
+      bool hasDeadline = twh_getNextDeadline(&fx3Timer.sleepingTasks, &fx3Timer.wakeUpAlarmAt_ticks);
+
+#ifdef FX3_SOFTWARE_TIMERS
+      expired = twh_advance(&fx3Timer.softwareTimers, now_ticks);
+
+      while (expired)
+      {
+         struct timer* tmr = (struct timer*) (((uint8_t*) expired) - (offsetof(struct timer, wheelLink)));
+         expired = expired->next;
+
+         if (fireTimer(tmr, now_ticks))
+         {
+            runningTaskDethroned = true;
+         }
+      }
+
+      uint64_t timerDeadline_ticks = 0;
+      if (twh_getNextDeadline(&fx3Timer.softwareTimers, &timerDeadline_ticks))
+      {
+         if ((! hasDeadline) || (timerDeadline_ticks < fx3Timer.wakeUpAlarmAt_ticks))
+         {
+            fx3Timer.wakeUpAlarmAt_ticks = timerDeadline_ticks;
+         }
+         hasDeadline = true;
+      }
+#endif
+
+      if (! hasDeadline)
+      {
+         fx3Timer.wakeUpAlarmAt_ticks = UINT64_MAX;
+         break;
+      }
+
+      /*
+       * The hardware timer matches on the low bits only; a deadline
+       * beyond its range just causes an early alarm.
+       */
+      bsp_wakeUpAt_ticks((uint32_t) fx3Timer.wakeUpAlarmAt_ticks);
+
+      // the deadline could have passed while the alarm was armed
+      if (bsp_getTimestamp64_ticks() < fx3Timer.wakeUpAlarmAt_ticks)
+      {
+         break;
+      }
+   }
+
+   return runningTaskDethroned;
+}
+
+/* File this entry on a wheel, to expire duration_ticks from now, and
+ * re-arm the wake-up alarm if its deadline is the earliest
+ *
+ * @note the system timer must be disabled
+ *
+ * @return true if a task that was woken up should preempt the running task
+ */
+static bool startWheelTimeout(struct timer_wheel* tw, struct timer_wheel_entry* entry, uint32_t duration_ticks)
+{
+   const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + duration_ticks;
+
+   bool isQueued = twh_insert(tw, entry, deadline_ticks);
+   assert(isQueued);
+   (void) isQueued;
+
+   if (deadline_ticks < fx3Timer.wakeUpAlarmAt_ticks)
+   {
+      /*
+       * this new deadline is earlier than the previous shortest one
+       */
+      return wakeUpSleepingTasks();
+   }
+   else
+   {
+      return false;
+   }
+}
+
+/* File this task on the sleeping wheel
+ *
+ * @note the system timer must be disabled
+ */
+static void startTaskTimeout(struct task_control_block* tcb, uint32_t duration_ticks)
+{
+   // the task is not running, so the caller switches context anyway
+   startWheelTimeout(&fx3Timer.sleepingTasks, &tcb->sleepLink, duration_ticks);
+}
+
+/** Transition this task from running to asleep
+ *
+ */
+bool handleSleepRequest(struct fx3_command* cmd)
+{
+   assert(FX3_TIMER_REQUEST_SUSPEND == cmd->type);
+
+   struct task_control_block* sleepyTask = cmd->task;
+   uint32_t timeout_ms = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   bsp_disableSystemTimer();
+
+   assert(isValidTaskControlBlock(sleepyTask));
+
+   assert(TS_ABOUT_TO_SLEEP == sleepyTask->state);
+   sleepyTask->state = TS_SLEEPING;
+   assert(timeout_ms);
+
+   const uint32_t sleepDuration_ticks = bsp_getTicksForMS(timeout_ms);
+
+   if (sleepyTask->config->timeSlice_ticks)
+   {
+      /*
+       * This task will sleep more than a full period of round-robin
+       * scheduling at this priority so replenish its full slice.
+       */
+
+      if (sleepDuration_ticks >= sleepyTask->roundRobinCumulative_ticks)
+      {
+         sleepyTask->roundRobinSliceLeft_ticks = sleepyTask->config->timeSlice_ticks;
+      }
+   }
+
+   sleepyTask->readyEntry.priority = 0xffff;
+
+   startTaskTimeout(sleepyTask, sleepDuration_ticks);
+
+   bsp_enableSystemTimer();
+
+   return true;
+}
+
+static void cancelRoundRobin()
+{
+   /*
+    * Only while the slice timeout is armed for the running task; once it
+    * fired, nothing is left of the slice, even if the kernel did not get
+    * to preempt the task yet. Masked, as the timeout may fire in between.
+    */
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+
+   if (runningTask->config->timeSlice_ticks && (roundRobinTimeoutFor == runningTask))
+   {
+      uint32_t runTime = bsp_computeInterval_ticks(runningTask->startedRunningAt_ticks, bsp_getTimestamp_ticks());
+      assert(runningTask->roundRobinSliceLeft_ticks >= runTime);
+      runningTask->roundRobinSliceLeft_ticks -= runTime;
+      roundRobinTimeoutFor = NULL;
+      bsp_cancelRoundRobinSliceTimeout();
+   }
+
+   __set_PRIMASK(primask);
+}
+
+void fx3_suspendTask(uint32_t timeout_ms)
+{
+   assert(timeout_ms);
+
+   // before the state changes; the task may be preempted while waiting for it
+   struct fx3_command* cmd = allocateTaskCommand();
+
+   runningTask->state = TS_ABOUT_TO_SLEEP;
+   cancelRoundRobin();
+
+   cmd->type   = FX3_TIMER_REQUEST_SUSPEND;
+   cmd->task   = runningTask;
+   cmd->object = (void*) (uintptr_t) timeout_ms;
+
+   postFX3Command(cmd);
+}
+
+/* Block the running task
+ *
+ * @param newState is the waiting state
+ * @param timeout_ticks limits the wait, if not 0
+ */
+static void blockRunningTask(enum task_state newState, uint32_t timeout_ticks)
+{
+   assert(TS_WAITING_FOR_MUTEX <= newState);
+   assert(TS_STATE_COUNT > newState);
+
+   // the waits that can be satisfied without the kernel are checked again by it
+   enum command_type lateCheck = FX3_INVALID_COMMAND;
+
+   switch (newState)
+   {
+      case TS_WAITING_FOR_MESSAGE:
+         lateCheck = FX3_CHECK_INBOX_FOR_LATE_ARRIVAL;
+         break;
+
+      case TS_WAITING_FOR_NOTIFICATION:
+         lateCheck = FX3_CHECK_NOTIFICATION_FOR_LATE_ARRIVAL;
+         break;
+
+      case TS_WAITING_FOR_SELECT:
+         lateCheck = FX3_CHECK_SELECT_FOR_LATE_SIGNAL;
+         break;
+
+      default:
+         break;
+   }
+
+   // see fx3_suspendTask
+   struct fx3_command* cmd = (FX3_INVALID_COMMAND != lateCheck) ? allocateTaskCommand() : NULL;
+
+   cancelRoundRobin();
+
+   runningTask->state = newState;
+
+   if (cmd)
+   {
+      cmd->type   = lateCheck;
+      cmd->task   = runningTask;
+      cmd->object = (void*) (uintptr_t) timeout_ticks;
+
+      postFX3Command(cmd);
+   }
+   else
+   {
+      assert(0 == timeout_ticks);
+      bsp_scheduleContextSwitch();
+   }
+}
+
+void task_block(enum task_state newState)
+{
+   blockRunningTask(newState, 0);
+}
+
+static bool handleWakeUpAlarm(struct fx3_command* cmd)
+{
+   assert(FX3_TIMER_EVENT_WAKEUP == cmd->type);
+   freeFX3Command(cmd);
+
+   /*
+    * The alarm might be early (the deadline is further than the hardware
+    * timer range) or stale (its task was woken up by other means); the
+    * wheel only hands over the tasks that are due.
+    */
+   fx3Timer.wakeUpAlarmAt_ticks = UINT64_MAX;
+
+   bool runningTaskDethroned = wakeUpSleepingTasks();
+
+   if (runningTaskDethroned)
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+bool bsp_onWokenUp(void)
+{
+   struct fx3_command* cmd = allocateFX3Command();
+
+   if (NULL == cmd)
+   {
+      deferFX3Work(FX3_DEFERRED_WAKEUP);
+      return true;
+   }
+
+   cmd->type = FX3_TIMER_EVENT_WAKEUP;
+
+   postFX3Command(cmd);
+
+   return true;
+}
+
+bool bsp_onRoundRobinSliceTimeout(void)
+{
+   assert(TS_RUNNING == runningTask->state);
+   assert(roundRobinTimeoutFor == runningTask);
+   assert(runningTask->config->timeSlice_ticks);
+
+   roundRobinTimeoutFor = NULL;
+   runningTask->roundRobinSliceLeft_ticks = 0;
+
+   scheduleReadyTask(runningTask);
+
+   bsp_scheduleContextSwitch();
+
+   return true;
+}
+
+struct task_control_block* fx3_getRunningTask(void)
+{
+   return runningTask;
+}
+
+uint32_t fx3_getUnusedStack(const struct task_control_block* tcb)
+{
+   assert(isValidTaskControlBlock(tcb));
+
+   const uint32_t* word = tcb->stackLimit;
+
+   // the stack grows down, towards the limit; it can't be all unused
+   while (FX3_STACK_PAINT == *word)
+   {
+      word ++;
+   }
+
+   return (uint32_t) ((const uint8_t*) word - (const uint8_t*) tcb->stackLimit);
+}
+
+void fx3_getCommandStatistics(struct fx3_command_statistics* stats)
+{
+   stats->capacity           = FX3_COMMAND_QUEUE_SIZE;
+   stats->highWaterMark      = bma_getHighWaterMark(&fx3MessageCenter.allocator);
+   stats->allocationFailures = bma_getFailureCount(&fx3MessageCenter.allocator);
+   stats->deferredRequests   = fx3MessageCenter.deferredRequestCount;
+}
+
+void fx3_sendMessage(struct task_control_block* tcb, struct list_element* msg)
+{
+   /*
+    * There is an efficient lock-free stack push algorithm for
+    * multiple producers. This leaves us with a list of messages
+    * in the reverse order of insertion.
+    *
+    * The lock-free stack pop is quite involved for the multiple
+    * consumer case, but it is trivial for the single consumer case:
+    * just swap the 'full' incoming queue with the 'empty' todo list.
+    *
+    * Then, we just have to reverse the order of the todo list which
+    * can be done efficiently in linear time.
+    */
+
+   assert(isValidTaskControlBlock(tcb));
+
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_MESSAGE_SENT, tcb->id);
+#endif
+
+   // lock-free push msg into the stack pointed to by tcb->inbox
+   lst_pushElement(&tcb->inbox, msg);
+
+   // make tcb runnable if blocked on its queue, or selecting on it
+   if ((TS_WAITING_FOR_MESSAGE == tcb->state) || ((TS_WAITING_FOR_SELECT == tcb->state) && tcb->selectsInbox))
+   {
+      scheduleReadyTask(tcb);
+   }
+}
+
+/* Move the messages that arrived in my inbox to the end of my message
+ * queue, in arrival order
+ *
+ * @return true if any message arrived
+ */
+static bool collectInbox(struct task_control_block* thisTask)
+{
+   // lock-free fetch the inbox variable and simultaneously reset it
+   struct list_element* todo = lst_fetchAll(&thisTask->inbox);
+
+   if (NULL == todo)
+   {
+      return false;
+   }
+
+   /*
+    * Elements in the todo list are in the reverse order (most
+    * recent element is first). We need to process messages
+    * in FIFO order.
+    *
+    * So, treat todo as a stack again, unstacking from todo and
+    * stacking into arrivals. This will reverse the order, and the
+    * first message in arrivals is the oldest.
+    */
+   struct list_element* arrivals = NULL;
+
+   while (todo)
+   {
+      struct list_element* next = todo->next;
+      todo->next                = arrivals;
+      arrivals                  = todo;
+      todo                      = next;
+   }
+
+   /*
+    * There is no need to protect messageQueue, only the task itself
+    * operates on it.
+    */
+   struct list_element** tail = &thisTask->messageQueue;
+   while (*tail)
+   {
+      tail = &(*tail)->next;
+   }
+
+   *tail = arrivals;
+
+   return true;
+}
+
+/* Wait until there is a message in my task queue
+ *
+ * @param deadline_ticks limits the wait, if not NULL
+ * @return false on timeout
+ */
+static bool waitForMessageQueue(const uint64_t* deadline_ticks)
+{
+   struct task_control_block* thisTask = runningTask;
+
+   thisTask->waitTimedOut = false;
+
+   while (! thisTask->messageQueue)
+   {
+      if (collectInbox(thisTask))
+      {
+         break;
+      }
+
+      if (NULL == deadline_ticks)
+      {
+         task_block(TS_WAITING_FOR_MESSAGE);
+      }
+      else
+      {
+         const uint64_t now_ticks = bsp_getTimestamp64_ticks();
+         if (thisTask->waitTimedOut || (now_ticks >= *deadline_ticks))
+         {
+            return false;
+         }
+
+         blockRunningTask(TS_WAITING_FOR_MESSAGE, (uint32_t) (*deadline_ticks - now_ticks));
+      }
+   }
+
+   return true;
+}
+
+/* Wait until there is a message in my task queue
+ *
+ * @param deadline_ticks limits the wait, if not NULL
+ * @return the buffer containing the message, or NULL on timeout
+ */
+static struct list_element* waitForMessage(const uint64_t* deadline_ticks)
+{
+   if (! waitForMessageQueue(deadline_ticks))
+   {
+      return NULL;
+   }
+
+   struct task_control_block* thisTask = runningTask;
+
+   struct list_element* msg  = thisTask->messageQueue;
+   thisTask->messageQueue    = msg->next;
+   msg->next                 = NULL;
+
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_MESSAGE_RECEIVED, thisTask->id);
+#endif
+
+   return msg;
+}
+
+struct list_element* fx3_waitForMessage(void)
+{
+   return waitForMessage(NULL);
+}
+
+struct list_element* fx3_waitForMessageWithTimeout(uint32_t timeout_ms)
+{
+   const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + bsp_getTicksForMS(timeout_ms);
+
+   return waitForMessage(&deadline_ticks);
+}
+
+void fx3_notifyTask(struct task_control_block* tcb, enum fx3_notification_action action, uint32_t value)
+{
+   assert(isValidTaskControlBlock(tcb));
+
+   switch (action)
+   {
+      case FX3_NOTIFY_SET_BITS:
+         __atomic_fetch_or(&tcb->notificationValue, value, __ATOMIC_RELEASE);
+         break;
+
+      case FX3_NOTIFY_INCREMENT:
+         __atomic_fetch_add(&tcb->notificationValue, value, __ATOMIC_RELEASE);
+         break;
+
+      case FX3_NOTIFY_OVERWRITE:
+      default:
+         __atomic_store_n(&tcb->notificationValue, value, __ATOMIC_RELEASE);
+         break;
+   }
+
+   /*
+    * As for the inbox: a task that is not blocked yet finds the bits
+    * itself, or when the kernel processes its late arrival check.
+    *
+    * The word is read again rather than taken from the atomic operation:
+    * the waiter may have consumed the bits already, and GCC 12 folds
+    * "add and fetch, then mask" into a bit test that drops the addend.
+    */
+   if ((TS_WAITING_FOR_NOTIFICATION == tcb->state) && (tcb->notificationValue & tcb->notificationMask))
+   {
+      scheduleReadyTask(tcb);
+   }
+}
+
+/* Wait until any of the bits in the mask is set in my notification word
+ *
+ * @param deadline_ticks limits the wait, if not NULL
+ * @return the bits taken, or 0 on timeout
+ */
+static uint32_t waitForNotification(uint32_t mask, const uint64_t* deadline_ticks)
+{
+   assert(mask);
+
+   struct task_control_block* thisTask = runningTask;
+
+   thisTask->waitTimedOut     = false;
+   thisTask->notificationMask = mask;
+
+   while (true)
+   {
+      // take the bits, leaving the others for later waits
+      const uint32_t notification = __atomic_fetch_and(&thisTask->notificationValue, ~mask, __ATOMIC_ACQUIRE) & mask;
+
+      if (notification)
+      {
+         return notification;
+      }
+
+      if (NULL == deadline_ticks)
+      {
+         task_block(TS_WAITING_FOR_NOTIFICATION);
+      }
+      else
+      {
+         const uint64_t now_ticks = bsp_getTimestamp64_ticks();
+         if (thisTask->waitTimedOut || (now_ticks >= *deadline_ticks))
+         {
+            return 0;
+         }
+
+         blockRunningTask(TS_WAITING_FOR_NOTIFICATION, (uint32_t) (*deadline_ticks - now_ticks));
+      }
+   }
+}
+
+uint32_t fx3_waitForNotification(uint32_t mask)
+{
+   return waitForNotification(mask, NULL);
+}
+
+uint32_t fx3_waitForNotificationWithTimeout(uint32_t mask, uint32_t timeout_ms)
+{
+   const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + bsp_getTicksForMS(timeout_ms);
+
+   return waitForNotification(mask, &deadline_ticks);
+}
+
+/* Count the messages in my task queue, up to a limit
+ */
+static uint32_t countQueuedMessages(const struct task_control_block* thisTask, uint32_t limit)
+{
+   uint32_t count = 0;
+
+   for (const struct list_element* msg = thisTask->messageQueue; msg && (count < limit); msg = msg->next)
+   {
+      count ++;
+   }
+
+   return count;
+}
+
+uint32_t fx3_waitForMessages(uint32_t maxCount, struct list_element** messages)
+{
+   return fx3_waitForMessageBatch(1, maxCount, 0, messages);
+}
+
+uint32_t fx3_waitForMessageBatch(uint32_t minCount, uint32_t maxCount, uint32_t linger_ms, struct list_element** messages)
+{
+   assert(maxCount);
+   assert(minCount <= maxCount);
+
+   struct task_control_block* thisTask = runningTask;
+
+   waitForMessageQueue(NULL);
+
+   // pick up everything that is already there, not just the first message
+   collectInbox(thisTask);
+
+   if ((minCount > 1) && linger_ms)
+   {
+      // the linger starts with the first message, not with the call
+      const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + bsp_getTicksForMS(linger_ms);
+
+      thisTask->waitTimedOut = false;
+
+      while (countQueuedMessages(thisTask, minCount) < minCount)
+      {
+         if (collectInbox(thisTask))
+         {
+            continue;
+         }
+
+         const uint64_t now_ticks = bsp_getTimestamp64_ticks();
+         if (thisTask->waitTimedOut || (now_ticks >= deadline_ticks))
+         {
+            break;
+         }
+
+         // woken up by each new message, to count it
+         blockRunningTask(TS_WAITING_FOR_MESSAGE, (uint32_t) (deadline_ticks - now_ticks));
+      }
+   }
+
+   // detach the first maxCount messages, in one pass
+   struct list_element*  batch = thisTask->messageQueue;
+   struct list_element** tail  = &batch;
+   uint32_t              count = 0;
+
+   while (*tail && (count < maxCount))
+   {
+      tail = &(*tail)->next;
+      count ++;
+   }
+
+   thisTask->messageQueue = *tail;
+   *tail                  = NULL;
+
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_MESSAGE_RECEIVED, thisTask->id);
+#endif
+
+   *messages = batch;
+
+   return count;
+}
+
+/** A task started waiting for a message; wake it up if a message arrived
+ * in the mean time, otherwise start its timeout, if any
+ */
+static bool handleInboxCheck(struct fx3_command* cmd)
+{
+   assert(FX3_CHECK_INBOX_FOR_LATE_ARRIVAL == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   // see handleNotificationCheck
+   if (TS_WAITING_FOR_MESSAGE != waitingTask->state)
+   {
+      return false;
+   }
+
+   if (waitingTask->inbox)
+   {
+      markTaskReady(waitingTask);
+   }
+   else if (timeout_ticks)
+   {
+      bsp_disableSystemTimer();
+      startTaskTimeout(waitingTask, timeout_ticks);
+      bsp_enableSystemTimer();
+   }
+
+   return true;
+}
+
+/** A task started waiting for a notification; wake it up if one of its
+ * bits was set in the mean time, otherwise start its timeout, if any
+ */
+static bool handleNotificationCheck(struct fx3_command* cmd)
+{
+   assert(FX3_CHECK_NOTIFICATION_FOR_LATE_ARRIVAL == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   /*
+    * A task preempted before posting this command could have been
+    * readied by a notification, and be running again; it checks the
+    * bits itself.
+    */
+   if (TS_WAITING_FOR_NOTIFICATION != waitingTask->state)
+   {
+      return false;
+   }
+
+   if (waitingTask->notificationValue & waitingTask->notificationMask)
+   {
+      markTaskReady(waitingTask);
+   }
+   else if (timeout_ticks)
+   {
+      bsp_disableSystemTimer();
+      startTaskTimeout(waitingTask, timeout_ticks);
+      bsp_enableSystemTimer();
+   }
+
+   return true;
+}
+
+/** An object a task selects on fired; ready the task, if blocked
+ *
+ * The task checks its objects again when it runs, so a spurious wake-up
+ * only costs it a check; an object that fires before the task blocks is
+ * caught by the late signal check.
+ *
+ * @return true if the task should preempt the running task
+ */
+static bool signalSelector(struct fx3_select_entry* entry)
+{
+   struct task_control_block* selectingTask = entry->task;
+
+   selectingTask->selectSignaled = true;
+
+   if (TS_WAITING_FOR_SELECT == selectingTask->state)
+   {
+      return markTaskReady(selectingTask);
+   }
+
+   return false;
+}
+
+/** A task started waiting on several objects; wake it up if one of them
+ * fired, or a message arrived, otherwise start its timeout, if any
+ */
+static bool handleSelectCheck(struct fx3_command* cmd)
+{
+   assert(FX3_CHECK_SELECT_FOR_LATE_SIGNAL == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   // see handleNotificationCheck
+   if (TS_WAITING_FOR_SELECT != waitingTask->state)
+   {
+      return false;
+   }
+
+   if (waitingTask->selectSignaled || (waitingTask->selectsInbox && waitingTask->inbox))
+   {
+      markTaskReady(waitingTask);
+   }
+   else if (timeout_ticks)
+   {
+      bsp_disableSystemTimer();
+      startTaskTimeout(waitingTask, timeout_ticks);
+      bsp_enableSystemTimer();
+   }
+
+   return true;
+}
+
+/** A task started waiting for a semaphore, with a timeout; wake it up if
+ * the semaphore was signaled before the task got on the wait list,
+ * otherwise start its timeout
+ */
+static bool handleSemaphoreCheck(struct fx3_command* cmd)
+{
+   assert(FX3_CHECK_SEMAPHORE_FOR_LATE_SIGNAL == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   /*
+    * A signal processed before this command might have readied the task already.
+    */
+   if (TS_WAITING_FOR_SEMAPHORE == waitingTask->state)
+   {
+      struct semaphore* sem = waitingTask->waitingOn;
+
+      if (sem->counter)
+      {
+         removeWaiter(&sem->antechamber, &sem->waitQueue, waitingTask);
+         markTaskReady(waitingTask);
+      }
+      else
+      {
+         assert(timeout_ticks);
+
+         bsp_disableSystemTimer();
+         startTaskTimeout(waitingTask, timeout_ticks);
+         bsp_enableSystemTimer();
+      }
+   }
+
+   return true;
+}
+
+/* Wake up the highest priority tasks waiting on a semaphore, one per signal
+ *
+ * @return true if the running task should be preempted
+ */
+static bool releaseSemaphoreWaiters(struct semaphore* sem, uint32_t signalCount)
+{
+   bool runningTaskDethroned = false;
+
+   collectWaiters(&sem->antechamber, &sem->waitQueue);
+
+   // select the highest priority waiting tasks, one per signal, and mark ready
+   for (; signalCount && (! phq_isEmpty(&sem->waitQueue)); signalCount --)
+   {
+      struct task_control_block* highestPriorityWaitingTask = popWaiter(&sem->waitQueue);
+
+      assert(TS_WAITING_FOR_SEMAPHORE == highestPriorityWaitingTask->state);
+
+      if (markTaskReady(highestPriorityWaitingTask))
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   // a signal left over goes to the task selecting on the semaphore
+   struct fx3_select_entry* selector = sem->selector;
+   if (signalCount && selector && signalSelector(selector))
+   {
+      runningTaskDethroned = true;
+   }
+
+   return runningTaskDethroned;
+}
+
+static bool handleSemaphoreSignal(struct fx3_command* cmd)
+{
+   assert(FX3_SIGNAL_SEMAPHORE == cmd->type);
+   struct semaphore* sem = cmd->object;
+   uint32_t signalCount  = cmd->coalescedCount + 1;
+   freeFX3Command(cmd);
+
+   bool runningTaskDethroned = releaseSemaphoreWaiters(sem, signalCount);
+
+   if (runningTaskDethroned)
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+/** A task blocked on a mutex; raise the priority of the owner, or hand
+ * the mutex over if it was unlocked in the mean time
+ */
+static bool handleMutexLock(struct fx3_command* cmd)
+{
+   assert(FX3_LOCK_MUTEX == cmd->type);
+   struct mutex* mtx = cmd->object;
+   freeFX3Command(cmd);
+
+   // contended mutexes are on their owner's list
+   bool isContended = ! phq_isEmpty(&mtx->waitQueue);
+
+   collectWaiters(&mtx->antechamber, &mtx->waitQueue);
+
+   if (phq_isEmpty(&mtx->waitQueue))
+   {
+      // already collected, and handed over, by an earlier command
+      return false;
+   }
+
+   struct task_control_block* owner = getMutexOwner(mtx);
+
+   if (NULL == owner)
+   {
+      // unlocked before the waiting task got on the wait list
+      return handOverMutex(mtx);
+   }
+
+   if (! isContended)
+   {
+      mtx->nextContended      = owner->contendedMutexes;
+      owner->contendedMutexes = mtx;
+   }
+
+   /*
+    * A task could lock the mutex, without waiting, since it was unlocked;
+    * route its unlock through the kernel as well.
+    */
+   mtx->owner = ((uintptr_t) owner) | MUTEX_CONTENDED;
+
+   updateInheritedPriority(owner);
+
+   return true;
+}
+
+/* Unlock a mutex on behalf of its owner: hand it over to the highest
+ * priority waiting task, and drop the priority the owner inherited from it
+ *
+ * @return true if the running task should be preempted
+ */
+static bool releaseMutex(struct task_control_block* owner, struct mutex* mtx)
+{
+   assert(owner == getMutexOwner(mtx));
+
+   if (! phq_isEmpty(&mtx->waitQueue))
+   {
+      struct mutex** contended = &owner->contendedMutexes;
+      while (*contended != mtx)
+      {
+         assert(*contended);
+         contended = &(*contended)->nextContended;
+      }
+
+      *contended         = mtx->nextContended;
+      mtx->nextContended = NULL;
+   }
+
+   const uint32_t previousPriority = owner->priority;
+
+   bool runningTaskDethroned = handOverMutex(mtx);
+
+   updateInheritedPriority(owner);
+
+   if (owner->priority != previousPriority)
+   {
+      // a ready task could have a higher priority than the owner, now
+      runningTaskDethroned = true;
+   }
+
+   if (runningTaskDethroned && (TS_RUNNING == runningTask->state))
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+/** The owner unlocked a contended mutex
+ */
+static bool handleMutexUnlock(struct fx3_command* cmd)
+{
+   assert(FX3_UNLOCK_MUTEX == cmd->type);
+   struct task_control_block* owner = cmd->task;
+   struct mutex* mtx = cmd->object;
+   freeFX3Command(cmd);
+
+   return releaseMutex(owner, mtx);
+}
+
+/** A task waits on a condition variable; queue it, unlock the mutex for
+ * it, then start its timeout, if any
+ *
+ * All happen in the same command, so a signal sent after the mutex is
+ * unlocked finds the task on the wait queue.
+ */
+static bool handleConditionWait(struct fx3_command* cmd)
+{
+   assert(FX3_WAIT_ON_CONDITION == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   assert(runningTask == waitingTask);
+   assert(TS_RUNNING == waitingTask->state);
+
+   struct condition_variable* cond = waitingTask->waitingOn;
+   struct mutex* mtx = cond->mutex;
+
+   /*
+    * Only blocked here: a task preempted before posting this command
+    * is put back on the ready queue, as it is still running.
+    */
+   waitingTask->state = TS_WAITING_FOR_CONDITION;
+
+   phq_insert(&cond->waitQueue, &waitingTask->waitLink, waitingTask->priority);
+
+   // drops the priority inherited through the mutex, re-keying the task
+   releaseMutex(waitingTask, mtx);
+
+   if (timeout_ticks)
+   {
+      bsp_disableSystemTimer();
+      startTaskTimeout(waitingTask, timeout_ticks);
+      bsp_enableSystemTimer();
+   }
+
+   return true;
+}
+
+/* Move the highest priority tasks waiting on a condition variable to the
+ * wait queue of its mutex, one per signal
+ *
+ * @param signalCount is the number of signals, UINT32_MAX for a broadcast
+ * @return true if the running task should be preempted
+ */
+static bool releaseConditionWaiters(struct condition_variable* cond, uint32_t signalCount)
+{
+   bool runningTaskDethroned = false;
+
+   for (; signalCount; signalCount --)
+   {
+      struct task_control_block* waitingTask = popWaiter(&cond->waitQueue);
+
+      if (NULL == waitingTask)
+      {
+         break;
+      }
+
+      assert(TS_WAITING_FOR_CONDITION == waitingTask->state);
+      assert(cond == waitingTask->waitingOn);
+
+      if (moveWaiterToMutex(waitingTask, cond->mutex))
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   return runningTaskDethroned;
+}
+
+/** Move the highest priority waiting task, or all of them, to the mutex
+ * of the condition variable
+ */
+static bool handleConditionSignal(struct fx3_command* cmd)
+{
+   assert((FX3_SIGNAL_CONDITION == cmd->type) || (FX3_BROADCAST_CONDITION == cmd->type));
+
+   struct condition_variable* cond = cmd->object;
+   const bool isBroadcast = (FX3_BROADCAST_CONDITION == cmd->type);
+   freeFX3Command(cmd);
+
+   bool runningTaskDethroned = releaseConditionWaiters(cond, isBroadcast ? UINT32_MAX : 1);
+
+   if (runningTaskDethroned && (TS_RUNNING == runningTask->state))
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+/** A task waits for events; take them if the wait is satisfied already,
+ * otherwise block the task on the group and start its timeout, if any
+ *
+ * The task is put on the waiting list before the flags are checked
+ * again: a set that happens in between, from an interrupt handler, sees
+ * the waiter and posts a command for it.
+ */
+static bool handleEventWait(struct fx3_command* cmd)
+{
+   assert(FX3_WAIT_FOR_EVENTS == cmd->type);
+
+   struct task_control_block* waitingTask = cmd->task;
+   uint32_t timeout_ticks = (uint32_t) (uintptr_t) cmd->object;
+   freeFX3Command(cmd);
+
+   assert(runningTask == waitingTask);
+   assert(TS_RUNNING == waitingTask->state);
+
+   struct event_group* grp = waitingTask->waitingOn;
+
+   waitingTask->next = grp->waiters;
+   grp->waiters      = waitingTask;
+
+   const uint32_t matched = takeEvents(grp, waitingTask->eventFlags, waitingTask->eventOptions);
+   if (matched)
+   {
+      removeEventWaiter(grp, waitingTask);
+      waitingTask->eventFlags = matched;
+
+      return false;
+   }
+
+   cancelRoundRobin();
+
+   waitingTask->state = TS_WAITING_FOR_EVENT;
+
+   if (timeout_ticks)
+   {
+      bsp_disableSystemTimer();
+      startTaskTimeout(waitingTask, timeout_ticks);
+      bsp_enableSystemTimer();
+   }
+
+   return true;
+}
+
+/* Wake up the tasks whose wait on the event group is satisfied by its
+ * flags, in one pass over the waiting list
+ *
+ * All the waiters see the same flags; those cleared on exit are cleared
+ * at the end of the pass, so one waiter does not take them from another.
+ *
+ * @return true if the running task should be preempted
+ */
+static bool releaseEventWaiters(struct event_group* grp)
+{
+   const uint32_t setFlags = grp->flags;
+   uint32_t       clearFlags = 0;
+
+   bool runningTaskDethroned = false;
+
+   struct task_control_block* volatile* link = &grp->waiters;
+
+   while (*link)
+   {
+      struct task_control_block* waitingTask = *link;
+
+      assert(TS_WAITING_FOR_EVENT == waitingTask->state);
+      assert(grp == waitingTask->waitingOn);
+
+      const uint32_t matched = matchEvents(setFlags, waitingTask->eventFlags, waitingTask->eventOptions);
+      if (0 == matched)
+      {
+         link = &waitingTask->next;
+         continue;
+      }
+
+      *link             = waitingTask->next;
+      waitingTask->next = NULL;
+
+      if (FX3_EVENTS_CLEAR_ON_EXIT & waitingTask->eventOptions)
+      {
+         clearFlags |= waitingTask->eventFlags;
+      }
+      waitingTask->eventFlags = matched;
+
+      if (markTaskReady(waitingTask))
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   if (clearFlags)
+   {
+      __atomic_fetch_and(&grp->flags, ~clearFlags, __ATOMIC_RELEASE);
+   }
+
+   struct fx3_select_entry* selector = grp->selector;
+   if (selector && matchEvents(setFlags & ~clearFlags, selector->eventFlags, selector->eventOptions) && signalSelector(selector))
+   {
+      runningTaskDethroned = true;
+   }
+
+   return runningTaskDethroned;
+}
+
+/** Flags were set on an event group; wake up all the tasks whose wait
+ * is now satisfied
+ */
+static bool handleEventSet(struct fx3_command* cmd)
+{
+   assert(FX3_SET_EVENTS == cmd->type);
+
+   struct event_group* grp = cmd->object;
+   freeFX3Command(cmd);
+
+   bool runningTaskDethroned = releaseEventWaiters(grp);
+
+   if (runningTaskDethroned && (TS_RUNNING == runningTask->state))
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+#ifdef FX3_SOFTWARE_TIMERS
+/* Arm or disarm a software timer
+ *
+ * @return true if the new alarm dethrones the running task
+ */
+static bool applyTimerRequest(struct timer* tmr, bool isStart)
+{
+   bool runningTaskDethroned = false;
+
+   bsp_disableSystemTimer();
+
+   twh_cancel(&fx3Timer.softwareTimers, &tmr->wheelLink);
+
+   if (isStart)
+   {
+      assert(tmr->config->interval_tick);
+
+      tmr->status = TMR_ARMED;
+      runningTaskDethroned = startWheelTimeout(&fx3Timer.softwareTimers, &tmr->wheelLink, tmr->config->interval_tick);
+   }
+   else
+   {
+      tmr->status = TMR_STOPPED;
+   }
+
+   bsp_enableSystemTimer();
+
+   return runningTaskDethroned;
+}
+
+static bool handleTimerRequest(struct fx3_command* cmd)
+{
+   assert((FX3_START_TIMER == cmd->type) || (FX3_STOP_TIMER == cmd->type));
+
+   struct timer* tmr = cmd->object;
+   const bool isStart = (FX3_START_TIMER == cmd->type);
+   freeFX3Command(cmd);
+
+   bool runningTaskDethroned = applyTimerRequest(tmr, isStart);
+
+   if (runningTaskDethroned && (TS_RUNNING == runningTask->state))
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+/* Apply the timer requests deferred by interrupt handlers
+ *
+ * @return true if the running task should be preempted
+ */
+static bool applyDeferredTimerRequests(void)
+{
+   bool runningTaskDethroned = false;
+
+   struct list_element* todo = lst_fetchAll(&fx3MessageCenter.deferredTimers);
+
+   while (todo)
+   {
+      struct timer* tmr = (struct timer*) (((uint8_t*) todo) - (offsetof(struct timer, deferredLink)));
+      todo = todo->next;
+
+      // a request from here on links the timer again, and is applied by the next pass
+      __atomic_store_n(&tmr->isRequestDeferred, false, __ATOMIC_RELEASE);
+
+      if (applyTimerRequest(tmr, tmr->isStartDeferred))
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   return runningTaskDethroned;
+}
+#endif
+
+/* Apply the condition variable signals deferred by interrupt handlers
+ *
+ * @return true if the running task should be preempted
+ */
+static bool applyDeferredConditionSignals(void)
+{
+   bool runningTaskDethroned = false;
+
+   struct list_element* todo = lst_fetchAll(&fx3MessageCenter.deferredConditions);
+
+   while (todo)
+   {
+      struct condition_variable* cond = (struct condition_variable*) (((uint8_t*) todo) - (offsetof(struct condition_variable, deferredLink)));
+      todo = todo->next;
+
+      // a signal from here on links the condition variable again, and is applied by the next pass
+      __atomic_store_n(&cond->isSignalDeferred, false, __ATOMIC_RELEASE);
+
+      uint32_t signalCount = __atomic_exchange_n(&cond->deferredSignalCount, 0, __ATOMIC_ACQUIRE);
+      if (__atomic_exchange_n(&cond->isBroadcastDeferred, false, __ATOMIC_ACQUIRE))
+      {
+         signalCount = UINT32_MAX;
+      }
+
+      if (releaseConditionWaiters(cond, signalCount))
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   return runningTaskDethroned;
+}
+
+/* Wake up the tasks whose wait is satisfied, for the requests that
+ * interrupt handlers could not post
+ *
+ * @return true if the running task should be preempted
+ */
+static bool sweepWaitingTasks(void)
+{
+   bool runningTaskDethroned = false;
+
+   for (uint32_t ii = 0; ii < tasksCreated_count; ii ++)
+   {
+      struct task_control_block* tcb = allValidTaskControlBlocks[ii];
+
+      switch (tcb->state)
+      {
+         case TS_RUNNING:
+            // its time slice ran out
+            if (tcb->config->timeSlice_ticks && (0 == tcb->roundRobinSliceLeft_ticks) && markTaskReady(tcb))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+
+         case TS_WAITING_FOR_MESSAGE:
+            if (tcb->inbox && markTaskReady(tcb))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+
+         case TS_WAITING_FOR_NOTIFICATION:
+            if ((tcb->notificationValue & tcb->notificationMask) && markTaskReady(tcb))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+
+         case TS_WAITING_FOR_SELECT:
+            // the task checks its objects again, and blocks if none fired
+            if (markTaskReady(tcb))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+
+         case TS_WAITING_FOR_SEMAPHORE:
+         {
+            struct semaphore* sem = tcb->waitingOn;
+            if (sem->counter && releaseSemaphoreWaiters(sem, sem->counter))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+         }
+
+         case TS_WAITING_FOR_EVENT:
+            if (releaseEventWaiters(tcb->waitingOn))
+            {
+               runningTaskDethroned = true;
+            }
+            break;
+
+         default:
+            break;
+      }
+   }
+
+   return runningTaskDethroned;
+}
+
+static bool handleDeferredWork(struct fx3_command* cmd)
+{
+   assert(&fx3MessageCenter.deferredWorkCommand == cmd);
+   (void) cmd;
+
+   // not freed; from here on, a request that is deferred posts it again
+   const uint32_t work = __atomic_exchange_n(&fx3MessageCenter.deferredWork, 0, __ATOMIC_ACQUIRE);
+
+   bool runningTaskDethroned = false;
+
+   if (FX3_DEFERRED_WAKEUP & work)
+   {
+      // see handleWakeUpAlarm
+      fx3Timer.wakeUpAlarmAt_ticks = UINT64_MAX;
+
+      if (wakeUpSleepingTasks())
+      {
+         runningTaskDethroned = true;
+      }
+   }
+
+   if ((FX3_DEFERRED_CONDITIONS & work) && applyDeferredConditionSignals())
+   {
+      runningTaskDethroned = true;
+   }
+
+#ifdef FX3_SOFTWARE_TIMERS
+   if ((FX3_DEFERRED_TIMERS & work) && applyDeferredTimerRequests())
+   {
+      runningTaskDethroned = true;
+   }
+#endif
+
+   if ((FX3_DEFERRED_TASK_SWEEP & work) && sweepWaitingTasks())
+   {
+      runningTaskDethroned = true;
+   }
+
+   if (runningTaskDethroned && (TS_RUNNING == runningTask->state))
+   {
+      cancelRoundRobin();
+      markTaskReady(runningTask);
+   }
+
+   return runningTaskDethroned;
+}
+
+bool fx3_processPendingCommands(void)
+{
+#ifdef FX3_CPU_ACCOUNTING
+   // PendSV has the lowest priority, so it always preempts the running task
+   __disable_irq();
+   switchCycleAccount(&kernelCycles);
+   __enable_irq();
+#endif
+
+   bool contextSwitchNeeded = (TS_RUNNING != runningTask->state);
+
+   auditKernelState(false);
+
+   while (true)
+   {
+      // lock-free fetch the inbox variable and simultaneously reset it
+      struct fx3_command* todo = (struct fx3_command*) lst_fetchAll(&fx3MessageCenter.inbox);
+
+      if (! todo)
+      {
+         break;
+      }
+      else
+      {
+         struct fx3_command* messageQueue = NULL;
+
+         /*
+          * Elements in the todo list are in the reverse order (most
+          * recent element is first). We need to process messages
+          * in FIFO order.
+          *
+          * So, treat both todo and message queue as stacks again,
+          * unstacking from todo and stacking into message queue.
+          *
+          * This will reverse the order, and the first message in the
+          * message queue is the oldest.
+          */
+#ifdef FX3_COALESCE_COMMANDS
+         struct fx3_command* laterCommands[FX3_COALESCING_SLOT_COUNT] = { NULL };
+#endif
+
+         while (todo)
+         {
+            struct fx3_command* next = todo->next;
+
+#ifdef FX3_COALESCE_COMMANDS
+            if (! coalesceFX3Command(laterCommands, todo))
+#endif
+            {
+               todo->next            = messageQueue;
+               messageQueue          = todo;
+            }
+
+            todo                     = next;
+         }
+
+         while (messageQueue)
+         {
+            struct fx3_command* cmd = (struct fx3_command*) messageQueue;
+            messageQueue = messageQueue->next;
+
+            assert((NULL == cmd->task) || isValidTaskControlBlock(cmd->task));
+
+#ifdef FX3_TRACE
+            traceEvent(FX3_TRACE_COMMAND_PROCESSED, cmd->type);
+#endif
+
+            switch (cmd->type)
+            {
+               case FX3_READY_TASK:
+                  if (markTaskReady(cmd->task))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  freeFX3Command(cmd);
+                  break;
+
+               case FX3_TIMER_REQUEST_SUSPEND:
+                  handleSleepRequest(cmd);
+                  contextSwitchNeeded = true;
+                  break;
+
+               case FX3_TIMER_EVENT_WAKEUP:
+                  if (handleWakeUpAlarm(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_SIGNAL_SEMAPHORE:
+                  if (handleSemaphoreSignal(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_CHECK_INBOX_FOR_LATE_ARRIVAL:
+                  if (handleInboxCheck(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_CHECK_NOTIFICATION_FOR_LATE_ARRIVAL:
+                  if (handleNotificationCheck(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_CHECK_SELECT_FOR_LATE_SIGNAL:
+                  if (handleSelectCheck(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_CHECK_SEMAPHORE_FOR_LATE_SIGNAL:
+                  if (handleSemaphoreCheck(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_LOCK_MUTEX:
+                  if (handleMutexLock(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_UNLOCK_MUTEX:
+                  if (handleMutexUnlock(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_WAIT_ON_CONDITION:
+                  handleConditionWait(cmd);
+                  contextSwitchNeeded = true;
+                  break;
+
+               case FX3_SIGNAL_CONDITION:
+               case FX3_BROADCAST_CONDITION:
+                  if (handleConditionSignal(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_WAIT_FOR_EVENTS:
+                  if (handleEventWait(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               case FX3_SET_EVENTS:
+                  if (handleEventSet(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+#ifdef FX3_SOFTWARE_TIMERS
+               case FX3_START_TIMER:
+               case FX3_STOP_TIMER:
+                  if (handleTimerRequest(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+#endif
+
+               case FX3_RUN_DEFERRED_WORK:
+                  if (handleDeferredWork(cmd))
+                  {
+                     contextSwitchNeeded = true;
+                  }
+                  break;
+
+               default:
+                  assert(false);
+                  break;
+            }
+         }
+      }
+   }
+
+   auditKernelState(false);
+
+   if (contextSwitchNeeded)
+   {
+      if (TS_RUNNING == runningTask->state)
+      {
+         // preempted by a task readied by a command; its slice stops here
+         cancelRoundRobin();
+         markTaskReady(runningTask);
+      }
+      selectNextRunningTask();
+   }
+
+#ifdef FX3_CPU_ACCOUNTING
+   // the context switch itself is charged to the task switched to
+   __disable_irq();
+   switchCycleAccount(contextSwitchNeeded ? &nextRunningTask->totalRunTime_cycles : &runningTask->totalRunTime_cycles);
+   __enable_irq();
+#endif
+
+   return contextSwitchNeeded;
+}
+
+void fx3impl_wakeupTasksWaitingOnSemaphore(struct semaphore* sem)
+{
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_SEMAPHORE_SIGNAL, (uint32_t) (uintptr_t) sem);
+#endif
+
+   struct fx3_command* cmd = allocateRequestCommand();
+
+   if (NULL == cmd)
+   {
+      // a selecting task about to block finds the flag in its late check
+      struct fx3_select_entry* selector = sem->selector;
+      if (selector)
+      {
+         selector->task->selectSignaled = true;
+      }
+
+      deferFX3Work(FX3_DEFERRED_TASK_SWEEP);
+      return;
+   }
+
+   cmd->type   = FX3_SIGNAL_SEMAPHORE;
+   cmd->object = sem;
+
+   postFX3Command(cmd);
+}
+
+static void enqueueTaskOnSemaphore(struct semaphore* sem)
+{
+#ifdef FX3_TRACE
+   traceEvent(FX3_TRACE_SEMAPHORE_WAIT, (uint32_t) (uintptr_t) sem);
+#endif
+
+   cancelRoundRobin();
+
+   runningTask->waitingOn = sem;
+   runningTask->state     = TS_WAITING_FOR_SEMAPHORE;
+
+   lst_pushElement(&sem->antechamber, &runningTask->element);
+}
+
+void fx3impl_enqueueTaskOnSemaphore(struct semaphore* sem)
+{
+   enqueueTaskOnSemaphore(sem);
+
+   bsp_scheduleContextSwitch();
+}
+
+bool fx3_waitOnSemaphoreWithTimeout(struct semaphore* sem, uint32_t timeout_ms)
+{
+   if (fx3_tryWaitOnSemaphore(sem))
+   {
+      return true;
+   }
+
+   const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + bsp_getTicksForMS(timeout_ms);
+
+   while (true)
+   {
+      const uint64_t now_ticks = bsp_getTimestamp64_ticks();
+      if (now_ticks >= deadline_ticks)
+      {
+         return false;
+      }
+
+      runningTask->waitTimedOut = false;
+
+      // see fx3_suspendTask
+      struct fx3_command* cmd = allocateTaskCommand();
+
+      enqueueTaskOnSemaphore(sem);
+
+      /*
+       * The kernel starts the timeout, unless the semaphore was signaled
+       * in the mean time; whichever of the signal and the timeout comes
+       * second finds the task off the wait list and off the wheel.
+       */
+      cmd->type   = FX3_CHECK_SEMAPHORE_FOR_LATE_SIGNAL;
+      cmd->task   = runningTask;
+      cmd->object = (void*) (uintptr_t) (uint32_t) (deadline_ticks - now_ticks);
+
+      postFX3Command(cmd);
+
+      if (fx3_tryWaitOnSemaphore(sem))
+      {
+         return true;
+      }
+
+      if (runningTask->waitTimedOut)
+      {
+         return false;
+      }
+   }
+}
+
+void fx3_initializeMutex(struct mutex* mtx)
+{
+   memset(mtx, 0, sizeof(*mtx));
+}
+
+void fx3impl_enqueueTaskOnMutex(struct mutex* mtx)
+{
+   // see fx3_suspendTask
+   struct fx3_command* cmd = allocateTaskCommand();
+
+   cancelRoundRobin();
+
+   runningTask->waitingOn = mtx;
+   runningTask->state     = TS_WAITING_FOR_MUTEX;
+
+   lst_pushElement(&mtx->antechamber, &runningTask->element);
+
+   cmd->type   = FX3_LOCK_MUTEX;
+   cmd->task   = runningTask;
+   cmd->object = mtx;
+
+   postFX3Command(cmd);
+
+   // the mutex is handed over before the task is woken up
+   assert(getMutexOwner(mtx) == runningTask);
+}
+
+void fx3impl_releaseMutex(struct mutex* mtx)
+{
+   assert(getMutexOwner(mtx) == runningTask);
+
+   struct fx3_command* cmd = allocateTaskCommand();
+
+   cmd->type   = FX3_UNLOCK_MUTEX;
+   cmd->task   = runningTask;
+   cmd->object = mtx;
+
+   postFX3Command(cmd);
+}
+
+void fx3_initializeConditionVariable(struct condition_variable* cond)
+{
+   memset(cond, 0, sizeof(*cond));
+}
+
+/* Unlock the mutex and wait on the condition variable
+ *
+ * @param timeout_ticks limits the wait, if not 0
+ * @return true if signaled, false on timeout
+ */
+static bool waitOnConditionVariable(struct condition_variable* cond, struct mutex* mtx, uint32_t timeout_ticks)
+{
+   assert(getMutexOwner(mtx) == runningTask);
+   assert((NULL == cond->mutex) || (mtx == cond->mutex) || phq_isEmpty(&cond->waitQueue));
+
+   cond->mutex = mtx;
+
+   // see fx3_suspendTask
+   struct fx3_command* cmd = allocateTaskCommand();
+
+   cancelRoundRobin();
+
+   runningTask->waitTimedOut = false;
+   runningTask->waitingOn    = cond;
+
+   cmd->type   = FX3_WAIT_ON_CONDITION;
+   cmd->task   = runningTask;
+   cmd->object = (void*) (uintptr_t) timeout_ticks;
+
+   postFX3Command(cmd);
+
+   // the mutex is handed back before the task is woken up
+   assert(getMutexOwner(mtx) == runningTask);
+
+   return ! runningTask->waitTimedOut;
+}
+
+void fx3_waitOnConditionVariable(struct condition_variable* cond, struct mutex* mtx)
+{
+   waitOnConditionVariable(cond, mtx, 0);
+}
+
+bool fx3_waitOnConditionVariableWithTimeout(struct condition_variable* cond, struct mutex* mtx, uint32_t timeout_ms)
+{
+   const uint32_t timeout_ticks = bsp_getTicksForMS(timeout_ms);
+
+   if (0 == timeout_ticks)
+   {
+      return false;
+   }
+
+   return waitOnConditionVariable(cond, mtx, timeout_ticks);
+}
+
+static void signalConditionVariable(struct condition_variable* cond, enum command_type type)
+{
+   struct fx3_command* cmd = allocateRequestCommand();
+
+   if (NULL == cmd)
+   {
+      // folded with the other deferred signals; the condition variable is linked once
+      if (FX3_BROADCAST_CONDITION == type)
+      {
+         cond->isBroadcastDeferred = true;
+      }
+      else
+      {
+         __atomic_fetch_add(&cond->deferredSignalCount, 1, __ATOMIC_RELAXED);
+      }
+
+      if (! __atomic_exchange_n(&cond->isSignalDeferred, true, __ATOMIC_ACQUIRE))
+      {
+         lst_pushElement(&fx3MessageCenter.deferredConditions, &cond->deferredLink);
+      }
+
+      deferFX3Work(FX3_DEFERRED_CONDITIONS);
+      return;
+   }
+
+   cmd->type   = type;
+   cmd->object = cond;
+
+   postFX3Command(cmd);
+}
+
+void fx3_signalConditionVariable(struct condition_variable* cond)
+{
+   signalConditionVariable(cond, FX3_SIGNAL_CONDITION);
+}
+
+void fx3_broadcastConditionVariable(struct condition_variable* cond)
+{
+   signalConditionVariable(cond, FX3_BROADCAST_CONDITION);
+}
+
+/*
+ * Message queues: the semaphores count the free slots and the queued
+ * messages, so the ring itself is never full when written, nor empty when
+ * read. Storing the pointer and advancing the index are one step, masked,
+ * so the slot a receiver reads was always written by the time the
+ * semaphore let it through, whatever order the senders completed in.
+ */
+
+void fx3_initializeMessageQueue(struct message_queue* mq, void** slots, uint32_t capacity)
+{
+   assert(capacity);
+
+   memset(mq, 0, sizeof(*mq));
+
+   fx3_initializeSemaphore(&mq->freeSlots, capacity);
+   fx3_initializeSemaphore(&mq->queuedMessages, 0);
+
+   mq->slots    = slots;
+   mq->capacity = capacity;
+}
+
+/* Store the message in a slot reserved on freeSlots, and signal it
+ */
+static void pushMessage(struct message_queue* mq, void* msg)
+{
+   assert(msg);
+
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+
+   mq->slots[mq->tail] = msg;
+
+   mq->tail ++;
+   if (mq->capacity == mq->tail)
+   {
+      mq->tail = 0;
+   }
+
+   __set_PRIMASK(primask);
+
+   fx3_signalSemaphore(&mq->queuedMessages);
+}
+
+/* Take the message out of a slot reserved on queuedMessages, and free it
+ */
+static void* popMessage(struct message_queue* mq)
+{
+   const uint32_t primask = __get_PRIMASK();
+   __disable_irq();
+
+   void* msg = mq->slots[mq->head];
+
+   mq->head ++;
+   if (mq->capacity == mq->head)
+   {
+      mq->head = 0;
+   }
+
+   __set_PRIMASK(primask);
+
+   fx3_signalSemaphore(&mq->freeSlots);
+
+   assert(msg);
+   return msg;
+}
+
+void fx3_sendToMessageQueue(struct message_queue* mq, void* msg)
+{
+   fx3_waitOnSemaphore(&mq->freeSlots);
+
+   pushMessage(mq, msg);
+}
+
+bool fx3_sendToMessageQueueWithTimeout(struct message_queue* mq, void* msg, uint32_t timeout_ms)
+{
+   if (! fx3_waitOnSemaphoreWithTimeout(&mq->freeSlots, timeout_ms))
+   {
+      return false;
+   }
+
+   pushMessage(mq, msg);
+
+   return true;
+}
+
+bool fx3_trySendToMessageQueue(struct message_queue* mq, void* msg)
+{
+   if (! fx3_tryWaitOnSemaphore(&mq->freeSlots))
+   {
+      return false;
+   }
+
+   pushMessage(mq, msg);
+
+   return true;
+}
+
+void* fx3_receiveFromMessageQueue(struct message_queue* mq)
+{
+   fx3_waitOnSemaphore(&mq->queuedMessages);
+
+   return popMessage(mq);
+}
+
+void* fx3_receiveFromMessageQueueWithTimeout(struct message_queue* mq, uint32_t timeout_ms)
+{
+   if (! fx3_waitOnSemaphoreWithTimeout(&mq->queuedMessages, timeout_ms))
+   {
+      return NULL;
+   }
+
+   return popMessage(mq);
+}
+
+void* fx3_tryReceiveFromMessageQueue(struct message_queue* mq)
+{
+   if (! fx3_tryWaitOnSemaphore(&mq->queuedMessages))
+   {
+      return NULL;
+   }
+
+   return popMessage(mq);
+}
+
+/*
+ * Event groups: the flags are changed with atomic operations, by tasks
+ * and interrupt handlers alike; the kernel is involved only when tasks
+ * wait, to block them or to wake them up.
+ */
+
+void fx3_initializeEventGroup(struct event_group* grp, uint32_t flags)
+{
+   memset(grp, 0, sizeof(*grp));
+
+   grp->flags = flags;
+}
+
+void fx3_setEvents(struct event_group* grp, uint32_t flags)
+{
+   __atomic_fetch_or(&grp->flags, flags, __ATOMIC_RELEASE);
+
+   // a waiter that is not on the list yet checks the flags itself
+   if (grp->waiters || grp->selector)
+   {
+      struct fx3_command* cmd = allocateRequestCommand();
+
+      if (NULL == cmd)
+      {
+         // see fx3impl_wakeupTasksWaitingOnSemaphore
+         struct fx3_select_entry* selector = grp->selector;
+         if (selector)
          {
-            struct fx3_command* cmd = (struct fx3_command*) messageQueue;
-            messageQueue = messageQueue->next;
+            selector->task->selectSignaled = true;
+         }
 
-            switch (cmd->type)
+         deferFX3Work(FX3_DEFERRED_TASK_SWEEP);
+         return;
+      }
+
+      cmd->type   = FX3_SET_EVENTS;
+      cmd->object = grp;
+
+      postFX3Command(cmd);
+   }
+}
+
+uint32_t fx3_clearEvents(struct event_group* grp, uint32_t flags)
+{
+   return __atomic_fetch_and(&grp->flags, ~flags, __ATOMIC_RELEASE);
+}
+
+uint32_t fx3_getEvents(const struct event_group* grp)
+{
+   return grp->flags;
+}
+
+uint32_t fx3_tryWaitForEvents(struct event_group* grp, uint32_t flags, uint32_t options)
+{
+   assert(flags);
+
+   return takeEvents(grp, flags, options);
+}
+
+/* Wait for flags of the event group
+ *
+ * @param timeout_ticks limits the wait, if not 0
+ * @return the flags that satisfied the wait, or 0 on timeout
+ */
+static uint32_t waitForEvents(struct event_group* grp, uint32_t flags, uint32_t options, uint32_t timeout_ticks)
+{
+   assert(flags);
+
+   const uint32_t matched = takeEvents(grp, flags, options);
+   if (matched)
+   {
+      return matched;
+   }
+
+   runningTask->waitTimedOut = false;
+   runningTask->waitingOn    = grp;
+   runningTask->eventFlags   = flags;
+   runningTask->eventOptions = (uint8_t) options;
+
+   struct fx3_command* cmd = allocateTaskCommand();
+
+   cmd->type   = FX3_WAIT_FOR_EVENTS;
+   cmd->task   = runningTask;
+   cmd->object = (void*) (uintptr_t) timeout_ticks;
+
+   postFX3Command(cmd);
+
+   return runningTask->waitTimedOut ? 0 : runningTask->eventFlags;
+}
+
+uint32_t fx3_waitForEvents(struct event_group* grp, uint32_t flags, uint32_t options)
+{
+   return waitForEvents(grp, flags, options, 0);
+}
+
+uint32_t fx3_waitForEventsWithTimeout(struct event_group* grp, uint32_t flags, uint32_t options, uint32_t timeout_ms)
+{
+   const uint32_t timeout_ticks = bsp_getTicksForMS(timeout_ms);
+
+   if (0 == timeout_ticks)
+   {
+      return fx3_tryWaitForEvents(grp, flags, options);
+   }
+
+   return waitForEvents(grp, flags, options, timeout_ticks);
+}
+
+/*
+ * Select: each object points to the entry of the task selecting on it,
+ * so the kernel readies the task when the object fires, without a list
+ * to walk. The task takes the object itself, checking its entries in
+ * order, and only registers and unregisters them once per call.
+ */
+
+/* Point the objects at their entries, or detach them
+ */
+static void registerSelector(struct fx3_select_entry* entries, uint32_t count, bool isRegistering)
+{
+   for (uint32_t ii = 0; ii < count; ii ++)
+   {
+      struct fx3_select_entry* entry    = &entries[ii];
+      struct fx3_select_entry* selector = isRegistering ? entry : NULL;
+
+      entry->task = runningTask;
+
+      switch (entry->type)
+      {
+         case FX3_SELECT_SEMAPHORE:
             {
-               case FX3_READY_TASK:
-                  if (markTaskReady(cmd->task))
-                  {
-                     contextSwitchNeeded = true;
-                  }
-                  freeFX3Command(cmd);
-                  break;
+               struct semaphore* sem = entry->object;
+               assert(isRegistering ? (NULL == sem->selector) : (entry == sem->selector));
+               sem->selector = selector;
+            }
+            break;
 
-               case FX3_TIMER_REQUEST_SUSPEND:
-                  handleSleepRequest(cmd);
-                  contextSwitchNeeded = true;
-                  break;
+         case FX3_SELECT_EVENTS:
+            {
+               struct event_group* grp = entry->object;
+               assert(entry->eventFlags);
+               assert(isRegistering ? (NULL == grp->selector) : (entry == grp->selector));
+               grp->selector = selector;
+            }
+            break;
 
-               case FX3_TIMER_EVENT_WAKEUP:
-                  if (handleWakeUpAlarm(cmd))
-                  {
-                     contextSwitchNeeded = true;
-                  }
-                  break;
+         case FX3_SELECT_INBOX:
+            runningTask->selectsInbox = isRegistering;
+            break;
 
-               case FX3_TIMER_EVENT_EPOCH_ROLLOVER:
-                  if (handleEpochRollover(cmd))
-                  {
-                     contextSwitchNeeded = true;
-                  }
-                  break;
+         default:
+            assert(false);
+            break;
+      }
+   }
+}
 
-               case FX3_SIGNAL_SEMAPHORE:
-                  if (handleSemaphoreSignal(cmd))
-                  {
-                     contextSwitchNeeded = true;
-                  }
-                  break;
+/* Take the first object that fired
+ *
+ * @return the index of its entry, or count if none fired
+ */
+static uint32_t takeSelectedObject(struct fx3_select_entry* entries, uint32_t count)
+{
+   const struct task_control_block* thisTask = runningTask;
 
-               case FX3_CHECK_INBOX_FOR_LATE_ARRIVAL:
-                  if (cmd->task->inbox)
-                  {
-                     markTaskReady(cmd->task);
-                     contextSwitchNeeded = true;
-                  }
-                  freeFX3Command(cmd);
-                  break;
+   for (uint32_t ii = 0; ii < count; ii ++)
+   {
+      struct fx3_select_entry* entry = &entries[ii];
 
-               default:
-                  assert(false);
-                  break;
+      switch (entry->type)
+      {
+         case FX3_SELECT_SEMAPHORE:
+            if (fx3_tryWaitOnSemaphore(entry->object))
+            {
+               return ii;
             }
-         }
+            break;
+
+         case FX3_SELECT_EVENTS:
+            entry->eventsTaken = takeEvents(entry->object, entry->eventFlags, entry->eventOptions);
+            if (entry->eventsTaken)
+            {
+               return ii;
+            }
+            break;
+
+         case FX3_SELECT_INBOX:
+            if (thisTask->messageQueue || thisTask->inbox)
+            {
+               return ii;
+            }
+            break;
+
+         default:
+            assert(false);
+            break;
       }
    }
 
-   verifyTaskControlBlocks(false);
+   return count;
+}
 
-   if (contextSwitchNeeded)
+/* Wait until one of the objects fires
+ *
+ * @param deadline_ticks limits the wait, if not NULL
+ * @return the index of the entry that fired, or FX3_SELECT_TIMEOUT
+ */
+static uint32_t selectObjects(struct fx3_select_entry* entries, uint32_t count, const uint64_t* deadline_ticks)
+{
+   assert(count);
+
+   struct task_control_block* thisTask = runningTask;
+
+   thisTask->waitTimedOut = false;
+
+   registerSelector(entries, count, true);
+
+   uint32_t fired = count;
+
+   while (true)
    {
-      if (TS_RUNNING == runningTask->state)
+      // cleared before the checks; an object that fires from here on sets it again
+      thisTask->selectSignaled = false;
+
+      fired = takeSelectedObject(entries, count);
+      if (fired < count)
       {
-         markTaskReady(runningTask);
+         break;
+      }
+
+      if (NULL == deadline_ticks)
+      {
+         task_block(TS_WAITING_FOR_SELECT);
+      }
+      else
+      {
+         const uint64_t now_ticks = bsp_getTimestamp64_ticks();
+         if (thisTask->waitTimedOut || (now_ticks >= *deadline_ticks))
+         {
+            fired = FX3_SELECT_TIMEOUT;
+            break;
+         }
+
+         blockRunningTask(TS_WAITING_FOR_SELECT, (uint32_t) (*deadline_ticks - now_ticks));
       }
-      selectNextRunningTask();
    }
 
-   return contextSwitchNeeded;
+   registerSelector(entries, count, false);
+
+   return fired;
 }
 
-void fx3impl_wakeupTasksWaitingOnSemaphore(struct semaphore* sem)
+uint32_t fx3_select(struct fx3_select_entry* entries, uint32_t count)
 {
-   struct fx3_command* cmd = allocateFX3Command();
+   return selectObjects(entries, count, NULL);
+}
 
-   cmd->type   = FX3_SIGNAL_SEMAPHORE;
-   cmd->object = sem;
+uint32_t fx3_selectWithTimeout(struct fx3_select_entry* entries, uint32_t count, uint32_t timeout_ms)
+{
+   const uint64_t deadline_ticks = bsp_getTimestamp64_ticks() + bsp_getTicksForMS(timeout_ms);
+
+   return selectObjects(entries, count, &deadline_ticks);
+}
+
+#ifdef FX3_SOFTWARE_TIMERS
+
+void tmr_initialize(struct timer* tmr, const struct timer_config* config)
+{
+   assert(config->handler);
+
+   memset(tmr, 0, sizeof(*tmr));
+
+   tmr->config = config;
+   tmr->status = TMR_STOPPED;
+   twh_initializeEntry(&tmr->wheelLink);
+}
+
+static void postTimerRequest(struct timer* tmr, enum command_type type)
+{
+   struct fx3_command* cmd = allocateRequestCommand();
+
+   if (NULL == cmd)
+   {
+      // the latest request wins; the timer is linked once
+      tmr->isStartDeferred = (FX3_START_TIMER == type);
+      if (! __atomic_exchange_n(&tmr->isRequestDeferred, true, __ATOMIC_ACQUIRE))
+      {
+         lst_pushElement(&fx3MessageCenter.deferredTimers, &tmr->deferredLink);
+      }
+
+      deferFX3Work(FX3_DEFERRED_TIMERS);
+      return;
+   }
+
+   cmd->type   = type;
+   cmd->object = tmr;
 
    postFX3Command(cmd);
 }
 
-void fx3impl_enqueueTaskOnSemaphore(struct semaphore* sem)
+void tmr_start(struct timer* tmr)
 {
-   runningTask->waitingOn = sem;
-   runningTask->state     = TS_WAITING_FOR_SEMAPHORE;
+   if (NULL == runningTask)
+   {
+      /*
+       * The kernel is not running yet; arm the timer directly, the alarm
+       * is set when multitasking starts.
+       */
+      assert(tmr->config->interval_tick);
 
-   lst_pushElement(&sem->antechamber, &runningTask->element);
+      twh_cancel(&fx3Timer.softwareTimers, &tmr->wheelLink);
+      tmr->status = TMR_ARMED;
 
-   bsp_scheduleContextSwitch();
+      bool isQueued = twh_insert(&fx3Timer.softwareTimers, &tmr->wheelLink, bsp_getTimestamp64_ticks() + tmr->config->interval_tick);
+      assert(isQueued);
+      (void) isQueued;
+   }
+   else
+   {
+      postTimerRequest(tmr, FX3_START_TIMER);
+   }
+}
+
+void tmr_stop(struct timer* tmr)
+{
+   if (NULL == runningTask)
+   {
+      twh_cancel(&fx3Timer.softwareTimers, &tmr->wheelLink);
+      tmr->status = TMR_STOPPED;
+   }
+   else
+   {
+      postTimerRequest(tmr, FX3_STOP_TIMER);
+   }
 }
+
+#endif
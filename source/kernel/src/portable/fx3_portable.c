@@ -0,0 +1,47 @@
+/**
+ * @file fx3_portable.c
+ * @brief Portable C implementation of the FX3 functionality in fx3_cortex.S
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+/*
+ * Built by the ports without LDREX/STREX, such as the POSIX host port;
+ * the GCC atomic builtins do the same job.
+ */
+
+#include <stddef.h>
+
+#include <list_utils.h>
+
+void lst_pushElement(volatile struct list_element** head, struct list_element* newElement)
+{
+   struct list_element* oldHead = (struct list_element*) __atomic_load_n(head, __ATOMIC_RELAXED);
+
+   do
+   {
+      newElement->next = oldHead;
+   }
+   while (! __atomic_compare_exchange_n(head, &oldHead, newElement, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+struct list_element* lst_fetchAll(volatile struct list_element** head)
+{
+   return (struct list_element*) __atomic_exchange_n(head, NULL, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,136 @@
+/**
+ * @file synchronization.c
+ * @brief Portable C implementation of the synchronization primitives
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+/*
+ * Mirrors synchronization.S, with the GCC atomic builtins in place of
+ * LDREX/STREX, for the ports without them, such as the POSIX host port.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <synchronization.h>
+
+#include <task.h>
+
+extern struct task_control_block* runningTask;
+
+void fx3impl_enqueueTaskOnSemaphore(struct semaphore* sem);
+void fx3impl_wakeupTasksWaitingOnSemaphore(struct semaphore* sem);
+
+void fx3impl_enqueueTaskOnMutex(struct mutex* mtx);
+void fx3impl_releaseMutex(struct mutex* mtx);
+
+void fx3_initializeSemaphore(struct semaphore* sem, uint32_t count)
+{
+   sem->counter = count;
+}
+
+uint32_t fx3_waitOnSemaphore(struct semaphore* sem)
+{
+   while (true)
+   {
+      uint32_t count = __atomic_load_n(&sem->counter, __ATOMIC_RELAXED);
+
+      if (0 == count)
+      {
+         // WAIT_FOR_UPDATE
+         fx3impl_enqueueTaskOnSemaphore(sem);
+      }
+      else if (__atomic_compare_exchange_n(&sem->counter, &count, count - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      {
+         return count - 1;
+      }
+   }
+}
+
+bool fx3_tryWaitOnSemaphore(struct semaphore* sem)
+{
+   uint32_t count = __atomic_load_n(&sem->counter, __ATOMIC_RELAXED);
+
+   while (count)
+   {
+      if (__atomic_compare_exchange_n(&sem->counter, &count, count - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+uint32_t fx3_signalSemaphore(struct semaphore* sem)
+{
+   const uint32_t count = __atomic_add_fetch(&sem->counter, 1, __ATOMIC_RELEASE);
+
+   /*
+    * SIGNAL_UPDATE: as synchronization.S does, every signal goes to the
+    * kernel, which wakes up one waiter per signal
+    */
+   fx3impl_wakeupTasksWaitingOnSemaphore(sem);
+
+   return count;
+}
+
+void fx3_lockMutex(struct mutex* mtx)
+{
+   const uintptr_t self  = (uintptr_t) runningTask;
+   uintptr_t       owner = __atomic_load_n(&mtx->owner, __ATOMIC_RELAXED);
+
+   while (true)
+   {
+      if (0 == owner)
+      {
+         if (__atomic_compare_exchange_n(&mtx->owner, &owner, self, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+         {
+            return;
+         }
+      }
+      else if (__atomic_compare_exchange_n(&mtx->owner, &owner, owner | 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      {
+         // flagged the owner to unlock through the kernel; WAIT_FOR_HANDOVER
+         fx3impl_enqueueTaskOnMutex(mtx);
+         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+         return;
+      }
+   }
+}
+
+bool fx3_tryLockMutex(struct mutex* mtx)
+{
+   uintptr_t unlocked = 0;
+
+   return __atomic_compare_exchange_n(&mtx->owner, &unlocked, (uintptr_t) runningTask, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void fx3_unlockMutex(struct mutex* mtx)
+{
+   uintptr_t owner = (uintptr_t) runningTask;
+
+   // owned, and not contended
+   if (! __atomic_compare_exchange_n(&mtx->owner, &owner, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+   {
+      // SIGNAL_HANDOVER
+      fx3impl_releaseMutex(mtx);
+   }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bitmap_allocator.h
+ * @brief Lock-free hierarchical bitmap allocator declarations
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __BITMAP_ALLOCATOR_H__
+#define __BITMAP_ALLOCATOR_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+/** Lock-free allocator of slot indices, safe to use concurrently from
+ * tasks and interrupt handlers.
+ *
+ * Free slots are tracked by a bitmap; a summary word hints which bitmap
+ * words have free slots, so an allocation costs two count-leading-zeros
+ * instructions and one exclusive store in the common case.
+ *
+ * Each allocation states how many free slots it must leave for more
+ * urgent callers; the free count is reserved before a bit is claimed,
+ * so an allocation that was admitted always finds a free slot.
+ *
+ * Slot S is tracked by bit (31 - S % 32) of word (S / 32), so that CLZ
+ * directly yields the lowest free slot of a word.
+ */
+
+/// Maximum number of slots supported by one summary word
+#define BMA_MAX_SLOT_COUNT       (32 * 32)
+
+/// Number of bitmap words required for the given number of slots
+#define BMA_BITMAP_WORD_COUNT(slotCount) (((slotCount) + 31) / 32)
+
+struct bitmap_allocator
+{
+   uint32_t                      slotCount;
+
+   /// bit (31 - w) is set when bitmap[w] might have free slots
+   volatile uint32_t             summary;
+
+   volatile uint32_t             freeCount;
+
+   /// Lowest value of freeCount since initialization
+   volatile uint32_t             lowestFreeCount;
+
+   /// Number of allocations refused
+   volatile uint32_t             failureCount;
+
+   /// A bit is set when its slot is free
+   volatile uint32_t*            bitmap;
+};
+
+/** Initialize an allocator, with all slots free
+ *
+ * @param ba points to allocator
+ * @param bitmap represents memory for the bitmap, BMA_BITMAP_WORD_COUNT(slotCount) entries
+ * @param slotCount is the number of slots
+ */
+void bma_initialize(struct bitmap_allocator* ba, volatile uint32_t* bitmap, uint32_t slotCount);
+
+/** Allocates a slot, if more than 'reserved' slots are free
+ *
+ * @param ba points to allocator
+ * @param reserved is the number of slots to be left for other callers
+ * @return the slot, or slotCount if the allocation is refused
+ */
+uint32_t bma_alloc(struct bitmap_allocator* ba, uint32_t reserved);
+
+/** Frees a slot
+ *
+ * @param ba points to allocator
+ * @param slot is an allocated slot
+ */
+void bma_free(struct bitmap_allocator* ba, uint32_t slot);
+
+/**
+ * @return the number of free slots
+ */
+uint32_t bma_getFreeCount(const struct bitmap_allocator* ba);
+
+/**
+ * @return the highest number of slots allocated at the same time
+ */
+uint32_t bma_getHighWaterMark(const struct bitmap_allocator* ba);
+
+/**
+ * @return the number of allocations refused
+ */
+uint32_t bma_getFailureCount(const struct bitmap_allocator* ba);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BITMAP_ALLOCATOR_H__
@@ -0,0 +1,140 @@
+/**
+ * @file bitmap_queue.h
+ * @brief Bitmap-indexed multi-level FIFO queue declarations
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __BITMAP_QUEUE_H__
+#define __BITMAP_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+#include <list_utils.h>
+
+/** Multi-level queue of intrusive list elements. Each level is a FIFO;
+ * a bitmap records which levels are not empty, and a summary word
+ * records which bitmap words are not empty. Finding the highest priority
+ * level costs two count-leading-zeros instructions, independent of the
+ * number of queued elements.
+ *
+ * The lower the numerical value of the level, the higher actual priority.
+ * Level 0 represents the highest priority.
+ *
+ * Level L is tracked by bit (31 - L % 32) of word (L / 32) so that CLZ
+ * directly yields the lowest populated level.
+ */
+
+/// Maximum number of levels supported by one summary word
+#define BMQ_MAX_LEVEL_COUNT      (32 * 32)
+
+/// Number of bitmap words required for the given number of levels
+#define BMQ_BITMAP_WORD_COUNT(levelCount) (((levelCount) + 31) / 32)
+
+struct bitmap_queue_level
+{
+   struct list_element*          head;
+   struct list_element*          tail;
+};
+
+struct bitmap_queue
+{
+   uint32_t                      levelCount;
+   uint32_t                      size;
+
+   /// bit (31 - w) is set when bitmap[w] is not zero
+   uint32_t                      summary;
+
+   uint32_t*                     bitmap;
+   struct bitmap_queue_level*    levels;
+};
+
+/** Initialize a bitmap queue
+ *
+ * @param bq points to bitmap queue
+ * @param levels represents memory for the level FIFOs, levelCount entries
+ * @param bitmap represents memory for the bitmap, BMQ_BITMAP_WORD_COUNT(levelCount) entries
+ * @param levelCount is the number of distinct levels
+ */
+void bmq_initialize(struct bitmap_queue* bq, struct bitmap_queue_level* levels, uint32_t* bitmap, uint32_t levelCount);
+
+/**
+ * @return true if the queue is empty
+ */
+bool bmq_isEmpty(const struct bitmap_queue* bq);
+
+/**
+ * @return true if the given level has no elements
+ */
+bool bmq_isLevelEmpty(const struct bitmap_queue* bq, uint32_t level);
+
+/** Appends an element at the tail of its level FIFO
+ *
+ * @param bq points to bitmap queue
+ * @param[in] element is the element
+ * @param level is the level
+ */
+void bmq_push(struct bitmap_queue* bq, struct list_element* element, uint32_t level);
+
+/** Returns the highest priority level that has elements
+ *
+ * @param bq points to bitmap queue
+ * @return the level, or levelCount if the queue is empty
+ */
+uint32_t bmq_getHighestLevel(const struct bitmap_queue* bq);
+
+/** Pops the oldest element from the highest priority level
+ *
+ * @param bq points to bitmap queue
+ * @param[out] level receives the level of the popped element; can be NULL
+ * @return the element, or NULL if queue is empty
+ */
+struct list_element* bmq_pop(struct bitmap_queue* bq, uint32_t* level);
+
+/** Removes an arbitrary element from its level FIFO
+ *
+ * @note cost is linear in the number of elements on that level only
+ *
+ * @param bq points to bitmap queue
+ * @param[in] element is the element
+ * @param level is the level the element was pushed on
+ * @return true if the element was found and removed
+ */
+bool bmq_remove(struct bitmap_queue* bq, struct list_element* element, uint32_t level);
+
+/** Moves all elements from one level to the tail of another level
+ *
+ * @param bq points to bitmap queue
+ * @param fromLevel is the source level; it will be empty afterwards
+ * @param toLevel is the destination level
+ */
+void bmq_appendLevel(struct bitmap_queue* bq, uint32_t fromLevel, uint32_t toLevel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BITMAP_QUEUE_H__
@@ -0,0 +1,119 @@
+/**
+ * @file pairing_heap.h
+ * @brief Intrusive pairing heap declarations
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __PAIRING_HEAP_H__
+#define __PAIRING_HEAP_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+/** Intrusive min-heap, with constant-time insert and logarithmic
+ * (amortized) removal of the minimum or of an arbitrary node.
+ *
+ * Nodes with equal keys come out in insertion order: each insertion is
+ * stamped with a sequence number that breaks ties.
+ *
+ * A zero-initialized heap is valid and empty.
+ */
+
+struct pairing_heap_node
+{
+   /// Leftmost child
+   struct pairing_heap_node*  child;
+
+   /// Next sibling to the right
+   struct pairing_heap_node*  sibling;
+
+   /// Previous sibling, or the parent for the leftmost child; NULL for the root
+   struct pairing_heap_node*  previous;
+
+   uint32_t                   key;
+
+   uint32_t                   sequence;
+};
+
+struct pairing_heap
+{
+   struct pairing_heap_node*  root;
+
+   /// Stamp for the next inserted node
+   uint32_t                   nextSequence;
+};
+
+/** Initialize a heap, empty
+ *
+ * @param ph points to heap
+ */
+void phq_initialize(struct pairing_heap* ph);
+
+/**
+ * @return true if the heap is empty
+ */
+bool phq_isEmpty(const struct pairing_heap* ph);
+
+/** Inserts a node
+ *
+ * @param ph points to heap
+ * @param node is a node not in any heap
+ * @param key orders the node; lowest first
+ */
+void phq_insert(struct pairing_heap* ph, struct pairing_heap_node* node, uint32_t key);
+
+/**
+ * @return the node with the lowest key, or NULL if the heap is empty
+ */
+struct pairing_heap_node* phq_peek(const struct pairing_heap* ph);
+
+/** Removes the node with the lowest key
+ *
+ * @param ph points to heap
+ * @return the node, or NULL if the heap is empty
+ */
+struct pairing_heap_node* phq_pop(struct pairing_heap* ph);
+
+/** Removes a node
+ *
+ * @param ph points to heap
+ * @param node is a node in the heap
+ */
+void phq_remove(struct pairing_heap* ph, struct pairing_heap_node* node);
+
+/** Changes the key of a node, which goes behind the nodes with the same key
+ *
+ * @param ph points to heap
+ * @param node is a node in the heap
+ * @param key is the new key
+ */
+void phq_update(struct pairing_heap* ph, struct pairing_heap_node* node, uint32_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PAIRING_HEAP_H__
@@ -90,6 +90,188 @@ bool prq_push(struct priority_queue* pq, uint32_t* obj);
  */
 uint32_t* prq_pop(struct priority_queue* pq);
 
+/** Restores the queue order after the priority of an object already in
+ * the queue has changed
+ *
+ * @note cost is linear in the size of the queue, to find the object; the
+ *       indexed priority queue does this in logarithmic time
+ *
+ * @param pq points to priority queue
+ * @param[in] obj is the object
+ * @return true if the object was in the queue
+ */
+bool prq_update(struct priority_queue* pq, uint32_t* obj);
+
+/** Indexed priority queue: a variant where each entry records its
+ * position in the heap, so an entry can be repositioned or removed in
+ * logarithmic time, without searching for it.
+ *
+ * The entries are embedded in the client objects; the priority is the
+ * first word of the entry, so an entry can also be kept on a plain
+ * priority queue (by the address of its priority) while it is not on
+ * an indexed one.
+ */
+
+struct priority_queue_entry
+{
+   /// Lower value is higher priority
+   uint32_t    priority;
+
+   /// Position in the heap, starting at 1; 0 while not queued
+   uint32_t    slot;
+};
+
+struct indexed_priority_queue
+{
+   uint32_t    capacity;
+   uint32_t    size;
+
+   struct priority_queue_entry**  memPool;
+};
+
+/** Initialize an indexed priority queue
+ *
+ * @param pq points to priority queue
+ * @param memPool represents memory for the queue, its size has to be 1 greater than queueSize
+ * @param queueSize represents the maximum number of elements in the queue
+ */
+void ipq_initialize(struct indexed_priority_queue* pq, struct priority_queue_entry** memPool, uint32_t queueSize);
+
+/**
+ * @return true if the queue is empty
+ */
+bool ipq_isEmpty(const struct indexed_priority_queue* pq);
+
+/**
+ * @return true if the queue is full
+ */
+bool ipq_isFull(const struct indexed_priority_queue* pq);
+
+/**
+ * @return true if the entry is on an indexed priority queue
+ */
+static inline bool ipq_isQueued(const struct priority_queue_entry* entry)
+{
+   return (0 != entry->slot);
+}
+
+/** Pushes an entry into the queue
+ *
+ * @param pq points to priority queue
+ * @param[in] entry is an entry not on any indexed queue (slot is 0)
+ * @return true if successful, false if queue is full
+ */
+bool ipq_push(struct indexed_priority_queue* pq, struct priority_queue_entry* entry);
+
+/**
+ * @return the highest priority entry, left in the queue, or NULL if the queue is empty
+ */
+struct priority_queue_entry* ipq_peek(const struct indexed_priority_queue* pq);
+
+/** Pops the highest priority entry from the queue
+ *
+ * @param pq points to priority queue
+ * @return the entry, or NULL if queue is empty
+ */
+struct priority_queue_entry* ipq_pop(struct indexed_priority_queue* pq);
+
+/** Removes an entry from anywhere in the queue
+ *
+ * @param pq points to priority queue
+ * @param[in] entry is the entry
+ * @return true if the entry was in the queue
+ */
+bool ipq_remove(struct indexed_priority_queue* pq, struct priority_queue_entry* entry);
+
+/** Restores the queue order after the priority of an entry already in
+ * the queue has changed, either way
+ *
+ * @param pq points to priority queue
+ * @param[in] entry is the entry
+ * @return true if the entry was in the queue
+ */
+bool ipq_update(struct indexed_priority_queue* pq, struct priority_queue_entry* entry);
+
+/** Keyed priority queue: a variant that copies the key next to the object
+ * pointer in the heap array, so sifting compares keys that are already in
+ * the cache line being moved, instead of dereferencing every object.
+ *
+ * The heap can be binary or 4-ary; a 4-ary heap is half as deep, and the
+ * four children of a node are adjacent in memory.
+ *
+ * Since the key is a copy, changing the priority of a queued object has
+ * no effect until the object is popped and pushed again.
+ */
+
+/// Children per node, as a power of two
+enum kpq_arity
+{
+   KPQ_BINARY     = 1,
+   KPQ_QUATERNARY = 2,
+};
+
+struct keyed_priority_queue_slot
+{
+   /// Lower value is higher priority
+   uint32_t    key;
+
+   void*       object;
+};
+
+struct keyed_priority_queue
+{
+   uint32_t    capacity;
+   uint32_t    size;
+
+   /// log2 of the number of children per node
+   uint32_t    arityShift;
+
+   struct keyed_priority_queue_slot*   slots;
+};
+
+/** Initialize a keyed priority queue
+ *
+ * @param pq points to priority queue
+ * @param slots represents memory for the queue, with queueSize elements (no header)
+ * @param queueSize represents the maximum number of elements in the queue
+ * @param arity selects a binary or a 4-ary heap
+ */
+void kpq_initialize(struct keyed_priority_queue* pq, struct keyed_priority_queue_slot* slots, uint32_t queueSize, enum kpq_arity arity);
+
+/**
+ * @return true if the queue is empty
+ */
+bool kpq_isEmpty(const struct keyed_priority_queue* pq);
+
+/**
+ * @return true if the queue is full
+ */
+bool kpq_isFull(const struct keyed_priority_queue* pq);
+
+/** Pushes an object into the queue
+ *
+ * @param pq points to priority queue
+ * @param[in] object is the object, not NULL
+ * @param key is the priority of the object
+ * @return true if successful, false if queue is full
+ */
+bool kpq_push(struct keyed_priority_queue* pq, void* object, uint32_t key);
+
+/**
+ * @param pq points to priority queue
+ * @param[out] key receives the priority of the object, unless NULL
+ * @return the highest priority object, left in the queue, or NULL if the queue is empty
+ */
+void* kpq_peek(const struct keyed_priority_queue* pq, uint32_t* key);
+
+/** Pops the highest priority object from the queue
+ *
+ * @param pq points to priority queue
+ * @param[out] key receives the priority of the object, unless NULL
+ * @return the object, or NULL if queue is empty
+ */
+void* kpq_pop(struct keyed_priority_queue* pq, uint32_t* key);
+
 #ifdef __cplusplus
 }
 #endif
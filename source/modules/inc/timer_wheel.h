@@ -0,0 +1,156 @@
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timing wheel declarations
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+/** Hierarchical timing wheel of intrusive entries, keyed on 64-bit
+ * absolute deadlines.
+ *
+ * Level L has TWH_SLOT_COUNT slots, each covering TWH_SLOT_COUNT^L ticks.
+ * An entry is filed on the level of the most significant slot-index
+ * digit where its deadline differs from the wheel's current time, so
+ * inserting and cancelling are constant-time list operations. As time
+ * advances, the slots of the higher levels are cascaded into the lower
+ * ones; all the entries of a level 0 slot share the same deadline and
+ * expire together.
+ *
+ * Deadlines further than the top level horizon wait on an overflow list,
+ * which is re-filed when the wheel reaches the top level rotation of the
+ * earliest of them.
+ */
+
+/// Number of bits of the deadline indexing the slots of one level
+#define TWH_SLOT_BITS            5
+
+/// Number of slots on each level
+#define TWH_SLOT_COUNT           (1U << TWH_SLOT_BITS)
+
+#ifndef TWH_LEVEL_COUNT
+/// Number of levels; the horizon is TWH_SLOT_COUNT ^ TWH_LEVEL_COUNT ticks
+#define TWH_LEVEL_COUNT          4
+#endif
+
+struct timer_wheel_entry
+{
+   /// @note must be the first element (the expired list is linked through it)
+   struct timer_wheel_entry*  next;
+   struct timer_wheel_entry*  previous;
+
+   uint64_t                   deadline_ticks;
+
+   /// Level the entry is filed on, TWH_LEVEL_COUNT for overflow, 0xff when not on the wheel
+   uint8_t                    level;
+   uint8_t                    slot;
+};
+
+struct timer_wheel
+{
+   /// All the slots before this timestamp have been processed
+   uint64_t                   now_ticks;
+
+   uint32_t                   size;
+
+   /// bit S of occupied[L] is set when slots[L][S] is not empty
+   uint32_t                   occupied[TWH_LEVEL_COUNT];
+
+   struct timer_wheel_entry*  slots[TWH_LEVEL_COUNT][TWH_SLOT_COUNT];
+
+   struct timer_wheel_entry*  overflow;
+};
+
+/** Initialize a timing wheel
+ *
+ * @param tw points to timing wheel
+ * @param now_ticks is the current time
+ */
+void twh_initialize(struct timer_wheel* tw, uint64_t now_ticks);
+
+/**
+ * @return true if the wheel has no entries
+ */
+bool twh_isEmpty(const struct timer_wheel* tw);
+
+/**
+ * @return true if the entry is on a wheel
+ */
+bool twh_isQueued(const struct timer_wheel_entry* entry);
+
+/** Prepares an entry to be used with a wheel
+ *
+ * @param[out] entry is the entry
+ */
+void twh_initializeEntry(struct timer_wheel_entry* entry);
+
+/** Files an entry to expire at the given deadline
+ *
+ * @param tw points to timing wheel
+ * @param[in] entry is the entry; must not be on a wheel
+ * @param deadline_ticks is the absolute deadline
+ * @return false if the deadline is not after the wheel's current time;
+ *    in that case the entry is not queued
+ */
+bool twh_insert(struct timer_wheel* tw, struct timer_wheel_entry* entry, uint64_t deadline_ticks);
+
+/** Removes an entry before it expires
+ *
+ * @param tw points to timing wheel
+ * @param[in] entry is the entry
+ * @return true if the entry was on the wheel
+ */
+bool twh_cancel(struct timer_wheel* tw, struct timer_wheel_entry* entry);
+
+/** Returns the earliest deadline on the wheel
+ *
+ * @note cost is linear in the number of entries sharing the first
+ * occupied slot only
+ *
+ * @param tw points to timing wheel
+ * @param[out] deadline_ticks receives the deadline
+ * @return false if the wheel is empty
+ */
+bool twh_getNextDeadline(const struct timer_wheel* tw, uint64_t* deadline_ticks);
+
+/** Moves the wheel's current time forward, collecting all the entries
+ * whose deadline is at or before the new time
+ *
+ * @param tw points to timing wheel
+ * @param now_ticks is the current time
+ * @return the expired entries, linked through their next field, or NULL
+ */
+struct timer_wheel_entry* twh_advance(struct timer_wheel* tw, uint64_t now_ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TIMER_WHEEL_H__
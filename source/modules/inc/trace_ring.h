@@ -0,0 +1,128 @@
+/**
+ * @file trace_ring.h
+ * @brief Lock-free binary trace ring declarations
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#ifndef __TRACE_RING_H__
+#define __TRACE_RING_H__
+
+#ifdef __cplusplus
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+/** Ring of fixed-size trace records, written concurrently by tasks and
+ * interrupt handlers and read by a single consumer.
+ *
+ * A writer claims a record with one atomic increment of the head, then
+ * fills it in; the oldest records are overwritten when the ring is full.
+ * A record read while it is being written may be torn; the trace is a
+ * diagnostic, so no writer ever waits for the reader.
+ *
+ * The header is followed, in memory, by the records when the ring is
+ * declared with TRC_DECLARE_RING, so a raw memory dump can be decoded
+ * by looking for TRC_MAGIC.
+ */
+
+/// "FX3T", in little-endian byte order
+#define TRC_MAGIC                0x54335846U
+
+/// Bits of the event word available for the event payload
+#define TRC_PAYLOAD_BITS         24
+#define TRC_PAYLOAD_MASK         ((1U << TRC_PAYLOAD_BITS) - 1)
+
+/// Packs an event type and its payload (truncated to 24 bits) in one word
+#define TRC_EVENT(type, payload) ((((uint32_t) (type)) << TRC_PAYLOAD_BITS) | (((uint32_t) (payload)) & TRC_PAYLOAD_MASK))
+
+struct trace_record
+{
+   uint32_t                      timestamp;
+
+   /// Event type in the top 8 bits, payload in the low 24
+   uint32_t                      event;
+};
+
+struct trace_ring
+{
+   uint32_t                      magic;
+
+   /// Number of records; a power of 2
+   uint32_t                      capacity;
+
+   /// Number of records written since initialization
+   volatile uint32_t             head;
+
+   struct trace_record*          records;
+};
+
+/// Declares a ring header immediately followed by its records
+#define TRC_DECLARE_RING(name, capacity)     \
+   struct                                    \
+   {                                         \
+      struct trace_ring    ring;             \
+      struct trace_record  records[capacity];\
+   } name
+
+/** Initialize a ring
+ *
+ * @param tr points to the ring
+ * @param records represents memory for the records
+ * @param capacity is the number of records, a power of 2
+ */
+void trc_initialize(struct trace_ring* tr, struct trace_record* records, uint32_t capacity);
+
+/** Append a record
+ *
+ * @param tr points to the ring
+ * @param timestamp is the time of the event
+ * @param event is the event word, see TRC_EVENT
+ */
+static inline void trc_record(struct trace_ring* tr, uint32_t timestamp, uint32_t event)
+{
+   const uint32_t index = __atomic_fetch_add(&tr->head, 1, __ATOMIC_RELAXED) & (tr->capacity - 1);
+
+   tr->records[index].timestamp = timestamp;
+   tr->records[index].event     = event;
+}
+
+/** Copy the records written since the cursor
+ *
+ * If the writers lapped the reader, before or while the records are
+ * copied, the overwritten records are skipped and counted as lost.
+ *
+ * @param tr points to the ring
+ * @param cursor is the number of records already read; it is advanced
+ * @param records receives the records, oldest first
+ * @param count is the capacity of records
+ * @param lost is incremented by the number of records skipped
+ * @return the number of records copied
+ */
+uint32_t trc_fetch(const struct trace_ring* tr, uint32_t* cursor, struct trace_record* records, uint32_t count, uint32_t* lost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TRACE_RING_H__
@@ -0,0 +1,201 @@
+/**
+ * @file bitmap_allocator.c
+ * @brief Lock-free hierarchical bitmap allocator
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <bitmap_allocator.h>
+
+static inline uint32_t wordMask(uint32_t index)
+{
+   return (0x80000000U >> (index % 32));
+}
+
+/** Clears the summary hint of a word found empty
+ *
+ * A concurrent bma_free may have refilled the word after it was found
+ * empty; the hint is restored in that case, so a word with free slots
+ * is never left out of the summary for longer than this function runs.
+ */
+static void retireWord(struct bitmap_allocator* ba, uint32_t word)
+{
+   __atomic_and_fetch(&ba->summary, ~wordMask(word), __ATOMIC_SEQ_CST);
+
+   if (0 != __atomic_load_n(&ba->bitmap[word], __ATOMIC_SEQ_CST))
+   {
+      __atomic_or_fetch(&ba->summary, wordMask(word), __ATOMIC_SEQ_CST);
+   }
+}
+
+static bool claimSlotInWord(struct bitmap_allocator* ba, uint32_t word, uint32_t* slot)
+{
+   uint32_t currentValue = __atomic_load_n(&ba->bitmap[word], __ATOMIC_SEQ_CST);
+
+   while (0 != currentValue)
+   {
+      const uint32_t bit          = (uint32_t) __builtin_clz(currentValue);
+      const uint32_t desiredValue = currentValue & ~(0x80000000U >> bit);
+
+      if (__atomic_compare_exchange_n(&ba->bitmap[word], &currentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+      {
+         if (0 == desiredValue)
+         {
+            retireWord(ba, word);
+         }
+
+         *slot = word * 32 + bit;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static bool reserveFreeSlot(struct bitmap_allocator* ba, uint32_t reserved)
+{
+   uint32_t currentValue = __atomic_load_n(&ba->freeCount, __ATOMIC_SEQ_CST);
+
+   do
+   {
+      if (currentValue <= reserved)
+      {
+         return false;
+      }
+   }
+   while (! __atomic_compare_exchange_n(&ba->freeCount, &currentValue, currentValue - 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+   const uint32_t newFreeCount = currentValue - 1;
+   uint32_t lowestFreeCount    = __atomic_load_n(&ba->lowestFreeCount, __ATOMIC_SEQ_CST);
+
+   while ((newFreeCount < lowestFreeCount) &&
+          (! __atomic_compare_exchange_n(&ba->lowestFreeCount, &lowestFreeCount, newFreeCount, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)))
+   {
+   }
+
+   return true;
+}
+
+void bma_initialize(struct bitmap_allocator* ba, volatile uint32_t* bitmap, uint32_t slotCount)
+{
+   assert(slotCount);
+   assert(BMA_MAX_SLOT_COUNT >= slotCount);
+
+   const uint32_t wordCount = BMA_BITMAP_WORD_COUNT(slotCount);
+
+   ba->slotCount       = slotCount;
+   ba->summary         = 0;
+   ba->freeCount       = slotCount;
+   ba->lowestFreeCount = slotCount;
+   ba->failureCount    = 0;
+   ba->bitmap          = bitmap;
+
+   for (uint32_t word = 0; word < wordCount; ++ word)
+   {
+      const uint32_t slotsInWord = ((word + 1) * 32 <= slotCount) ? 32 : (slotCount % 32);
+
+      bitmap[word]  = (32 == slotsInWord) ? 0xffffffffU : ~(0xffffffffU >> slotsInWord);
+      ba->summary  |= wordMask(word);
+   }
+}
+
+uint32_t bma_alloc(struct bitmap_allocator* ba, uint32_t reserved)
+{
+   if (! reserveFreeSlot(ba, reserved))
+   {
+      __atomic_add_fetch(&ba->failureCount, 1, __ATOMIC_SEQ_CST);
+      return ba->slotCount;
+   }
+
+   /*
+    * A slot is now owed to this caller: bma_free sets the bitmap bit
+    * before incrementing freeCount, so there are at least as many set
+    * bits as admitted callers which have not claimed theirs yet. The
+    * summary is only a hint; when it is empty, fall back to scanning.
+    */
+   uint32_t slot = ba->slotCount;
+
+   for (;;)
+   {
+      const uint32_t summary = __atomic_load_n(&ba->summary, __ATOMIC_SEQ_CST);
+
+      if (0 != summary)
+      {
+         const uint32_t word = (uint32_t) __builtin_clz(summary);
+
+         if (claimSlotInWord(ba, word, &slot))
+         {
+            break;
+         }
+
+         retireWord(ba, word);
+      }
+      else
+      {
+         const uint32_t wordCount = BMA_BITMAP_WORD_COUNT(ba->slotCount);
+         bool claimed = false;
+
+         for (uint32_t word = 0; (! claimed) && (word < wordCount); ++ word)
+         {
+            claimed = claimSlotInWord(ba, word, &slot);
+         }
+
+         if (claimed)
+         {
+            break;
+         }
+      }
+   }
+
+   assert(slot < ba->slotCount);
+
+   return slot;
+}
+
+void bma_free(struct bitmap_allocator* ba, uint32_t slot)
+{
+   assert(slot < ba->slotCount);
+
+   const uint32_t word = slot / 32;
+   const uint32_t previousValue = __atomic_fetch_or(&ba->bitmap[word], wordMask(slot), __ATOMIC_SEQ_CST);
+
+   assert(0 == (previousValue & wordMask(slot)));
+   (void) previousValue;
+
+   __atomic_or_fetch(&ba->summary, wordMask(word), __ATOMIC_SEQ_CST);
+   __atomic_add_fetch(&ba->freeCount, 1, __ATOMIC_SEQ_CST);
+}
+
+uint32_t bma_getFreeCount(const struct bitmap_allocator* ba)
+{
+   return ba->freeCount;
+}
+
+uint32_t bma_getHighWaterMark(const struct bitmap_allocator* ba)
+{
+   return ba->slotCount - ba->lowestFreeCount;
+}
+
+uint32_t bma_getFailureCount(const struct bitmap_allocator* ba)
+{
+   return ba->failureCount;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file bitmap_queue.c
+ * @brief Bitmap-indexed multi-level FIFO queue implementation
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <bitmap_queue.h>
+
+static inline void markLevelPopulated(struct bitmap_queue* bq, uint32_t level)
+{
+   const uint32_t word = level / 32;
+
+   bq->bitmap[word] |= (0x80000000U >> (level % 32));
+   bq->summary      |= (0x80000000U >> word);
+}
+
+static inline void markLevelEmpty(struct bitmap_queue* bq, uint32_t level)
+{
+   const uint32_t word = level / 32;
+
+   bq->bitmap[word] &= ~(0x80000000U >> (level % 32));
+   if (0 == bq->bitmap[word])
+   {
+      bq->summary &= ~(0x80000000U >> word);
+   }
+}
+
+void bmq_initialize(struct bitmap_queue* bq, struct bitmap_queue_level* levels, uint32_t* bitmap, uint32_t levelCount)
+{
+   assert(levelCount);
+   assert(BMQ_MAX_LEVEL_COUNT >= levelCount);
+
+   bq->levelCount = levelCount;
+   bq->size       = 0;
+   bq->summary    = 0;
+   bq->bitmap     = bitmap;
+   bq->levels     = levels;
+
+   memset(bitmap, 0, BMQ_BITMAP_WORD_COUNT(levelCount) * sizeof(uint32_t));
+   memset(levels, 0, levelCount * sizeof(struct bitmap_queue_level));
+}
+
+bool bmq_isEmpty(const struct bitmap_queue* bq)
+{
+   return (0 == bq->summary);
+}
+
+bool bmq_isLevelEmpty(const struct bitmap_queue* bq, uint32_t level)
+{
+   assert(level < bq->levelCount);
+
+   return (NULL == bq->levels[level].head);
+}
+
+void bmq_push(struct bitmap_queue* bq, struct list_element* element, uint32_t level)
+{
+   assert(level < bq->levelCount);
+
+   struct bitmap_queue_level* fifo = &bq->levels[level];
+
+   element->next = NULL;
+
+   if (fifo->head)
+   {
+      fifo->tail->next = element;
+   }
+   else
+   {
+      fifo->head = element;
+      markLevelPopulated(bq, level);
+   }
+   fifo->tail = element;
+
+   bq->size ++;
+}
+
+uint32_t bmq_getHighestLevel(const struct bitmap_queue* bq)
+{
+   if (0 == bq->summary)
+   {
+      return bq->levelCount;
+   }
+
+   const uint32_t word = (uint32_t) __builtin_clz(bq->summary);
+   return word * 32 + (uint32_t) __builtin_clz(bq->bitmap[word]);
+}
+
+struct list_element* bmq_pop(struct bitmap_queue* bq, uint32_t* level)
+{
+   struct list_element* element = NULL;
+
+   if (bq->summary)
+   {
+      const uint32_t highestLevel = bmq_getHighestLevel(bq);
+
+      struct bitmap_queue_level* fifo = &bq->levels[highestLevel];
+
+      element    = fifo->head;
+      fifo->head = element->next;
+      if (NULL == fifo->head)
+      {
+         fifo->tail = NULL;
+         markLevelEmpty(bq, highestLevel);
+      }
+
+      element->next = NULL;
+      bq->size --;
+
+      if (level)
+      {
+         *level = highestLevel;
+      }
+   }
+
+   return element;
+}
+
+bool bmq_remove(struct bitmap_queue* bq, struct list_element* element, uint32_t level)
+{
+   assert(level < bq->levelCount);
+
+   struct bitmap_queue_level* fifo = &bq->levels[level];
+
+   struct list_element* previous = NULL;
+   struct list_element* current  = fifo->head;
+
+   while (current && (current != element))
+   {
+      previous = current;
+      current  = current->next;
+   }
+
+   if (NULL == current)
+   {
+      return false;
+   }
+
+   if (previous)
+   {
+      previous->next = element->next;
+   }
+   else
+   {
+      fifo->head = element->next;
+   }
+
+   if (fifo->tail == element)
+   {
+      fifo->tail = previous;
+   }
+
+   if (NULL == fifo->head)
+   {
+      markLevelEmpty(bq, level);
+   }
+
+   element->next = NULL;
+   bq->size --;
+
+   return true;
+}
+
+void bmq_appendLevel(struct bitmap_queue* bq, uint32_t fromLevel, uint32_t toLevel)
+{
+   assert(fromLevel < bq->levelCount);
+   assert(toLevel < bq->levelCount);
+
+   struct bitmap_queue_level* source      = &bq->levels[fromLevel];
+   struct bitmap_queue_level* destination = &bq->levels[toLevel];
+
+   if ((fromLevel == toLevel) || (NULL == source->head))
+   {
+      return;
+   }
+
+   if (destination->head)
+   {
+      destination->tail->next = source->head;
+   }
+   else
+   {
+      destination->head = source->head;
+      markLevelPopulated(bq, toLevel);
+   }
+   destination->tail = source->tail;
+
+   source->head = NULL;
+   source->tail = NULL;
+   markLevelEmpty(bq, fromLevel);
+}
@@ -0,0 +1,204 @@
+/**
+ * @file pairing_heap.c
+ * @brief Intrusive pairing heap
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <pairing_heap.h>
+
+static inline bool isBefore(const struct pairing_heap_node* left, const struct pairing_heap_node* right)
+{
+   if (left->key != right->key)
+   {
+      return left->key < right->key;
+   }
+
+   // insertion order; the difference is immune to the sequence wrapping around
+   return ((int32_t) (left->sequence - right->sequence)) < 0;
+}
+
+/* Links two trees; the root with the lower key becomes the parent
+ */
+static struct pairing_heap_node* meld(struct pairing_heap_node* left, struct pairing_heap_node* right)
+{
+   if (NULL == left)
+   {
+      return right;
+   }
+
+   if (NULL == right)
+   {
+      return left;
+   }
+
+   if (isBefore(right, left))
+   {
+      struct pairing_heap_node* temp = left;
+      left  = right;
+      right = temp;
+   }
+
+   right->previous = left;
+   right->sibling  = left->child;
+   if (left->child)
+   {
+      left->child->previous = right;
+   }
+   left->child = right;
+
+   return left;
+}
+
+/* Melds a list of siblings into one tree: pairs left to right, then
+ * accumulates the pairs right to left
+ */
+static struct pairing_heap_node* mergeSiblings(struct pairing_heap_node* first)
+{
+   struct pairing_heap_node* pairs = NULL;
+
+   while (first)
+   {
+      struct pairing_heap_node* second = first->sibling;
+      struct pairing_heap_node* next   = second ? second->sibling : NULL;
+
+      first->sibling = NULL;
+      if (second)
+      {
+         second->sibling = NULL;
+      }
+
+      struct pairing_heap_node* pair = meld(first, second);
+
+      // stack the pairs, so the second pass goes right to left
+      pair->sibling = pairs;
+      pairs         = pair;
+
+      first = next;
+   }
+
+   struct pairing_heap_node* tree = NULL;
+
+   while (pairs)
+   {
+      struct pairing_heap_node* next = pairs->sibling;
+      pairs->sibling = NULL;
+
+      tree  = meld(pairs, tree);
+      pairs = next;
+   }
+
+   return tree;
+}
+
+static inline void setRoot(struct pairing_heap* ph, struct pairing_heap_node* root)
+{
+   if (root)
+   {
+      root->previous = NULL;
+      root->sibling  = NULL;
+   }
+
+   ph->root = root;
+}
+
+void phq_initialize(struct pairing_heap* ph)
+{
+   memset(ph, 0, sizeof(*ph));
+}
+
+bool phq_isEmpty(const struct pairing_heap* ph)
+{
+   return (NULL == ph->root);
+}
+
+void phq_insert(struct pairing_heap* ph, struct pairing_heap_node* node, uint32_t key)
+{
+   node->child    = NULL;
+   node->sibling  = NULL;
+   node->previous = NULL;
+   node->key      = key;
+   node->sequence = ph->nextSequence;
+
+   ph->nextSequence ++;
+
+   setRoot(ph, meld(ph->root, node));
+}
+
+struct pairing_heap_node* phq_peek(const struct pairing_heap* ph)
+{
+   return ph->root;
+}
+
+struct pairing_heap_node* phq_pop(struct pairing_heap* ph)
+{
+   struct pairing_heap_node* root = ph->root;
+
+   if (root)
+   {
+      setRoot(ph, mergeSiblings(root->child));
+      root->child = NULL;
+   }
+
+   return root;
+}
+
+void phq_remove(struct pairing_heap* ph, struct pairing_heap_node* node)
+{
+   if (ph->root == node)
+   {
+      phq_pop(ph);
+      return;
+   }
+
+   assert(node->previous);
+
+   // unlink the subtree; only the leftmost child has its parent as previous
+   if (node->previous->child == node)
+   {
+      node->previous->child = node->sibling;
+   }
+   else
+   {
+      node->previous->sibling = node->sibling;
+   }
+
+   if (node->sibling)
+   {
+      node->sibling->previous = node->previous;
+   }
+
+   node->sibling  = NULL;
+   node->previous = NULL;
+
+   struct pairing_heap_node* children = mergeSiblings(node->child);
+   node->child = NULL;
+
+   setRoot(ph, meld(ph->root, children));
+}
+
+void phq_update(struct pairing_heap* ph, struct pairing_heap_node* node, uint32_t key)
+{
+   phq_remove(ph, node);
+   phq_insert(ph, node, key);
+}
@@ -42,10 +42,8 @@ bool prq_isFull(struct priority_queue* pq)
    return (pq->size == pq->capacity);
 }
 
-static void siftdown(uint32_t** A, uint32_t count)
+static void siftdown(uint32_t** A, uint32_t count, uint32_t parent)
 {
-   unsigned parent = 1;
-
    while (true)
    {
       unsigned child = parent * 2;
@@ -75,10 +73,8 @@ static void siftdown(uint32_t** A, uint32_t count)
    }
 }
 
-static void siftup(uint32_t** A, uint32_t count)
+static void siftup(uint32_t** A, uint32_t child)
 {
-   uint32_t child = count;
-
    while (child > 1)
    {
       uint32_t parent = child / 2;
@@ -118,9 +114,321 @@ uint32_t* prq_pop(struct priority_queue* pq)
    {
       val = pq->memPool[1];
       pq->memPool[1] = pq->memPool[pq->size --];
-      siftdown(pq->memPool, pq->size);
+      siftdown(pq->memPool, pq->size, 1);
    }
 
    return val;
 }
 
+bool prq_update(struct priority_queue* pq, uint32_t* obj)
+{
+   for (uint32_t ii = 1; ii <= pq->size; ii ++)
+   {
+      if (pq->memPool[ii] == obj)
+      {
+         /*
+          * only one of them moves the object
+          */
+         siftup(pq->memPool, ii);
+         siftdown(pq->memPool, pq->size, ii);
+
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void ipq_initialize(struct indexed_priority_queue* pq, struct priority_queue_entry** memPool, uint32_t queueSize)
+{
+   pq->capacity = queueSize;
+   pq->size     = 0;
+   pq->memPool  = memPool;
+}
+
+bool ipq_isEmpty(const struct indexed_priority_queue* pq)
+{
+   return (0 == pq->size);
+}
+
+bool ipq_isFull(const struct indexed_priority_queue* pq)
+{
+   return (pq->size == pq->capacity);
+}
+
+/*
+ * Same algorithms as above, but the moving entry is held aside and only
+ * stored once it reaches its final slot; every entry that is passed over
+ * records its new slot.
+ */
+
+static inline void placeEntry(struct priority_queue_entry** A, uint32_t slot, struct priority_queue_entry* entry)
+{
+   A[slot]     = entry;
+   entry->slot = slot;
+}
+
+static void siftdownIndexed(struct priority_queue_entry** A, uint32_t count, uint32_t parent)
+{
+   struct priority_queue_entry* entry = A[parent];
+
+   while (true)
+   {
+      uint32_t child = parent * 2;
+
+      if (child > count)
+      {
+         break;
+      }
+
+      if ((child + 1) <= count)
+      {
+         if (A[child + 1]->priority < A[child]->priority)
+         {
+            child ++;
+         }
+      }
+
+      if (entry->priority <= A[child]->priority)
+      {
+         break;
+      }
+
+      placeEntry(A, parent, A[child]);
+      parent = child;
+   }
+
+   placeEntry(A, parent, entry);
+}
+
+static void siftupIndexed(struct priority_queue_entry** A, uint32_t child)
+{
+   struct priority_queue_entry* entry = A[child];
+
+   while (child > 1)
+   {
+      uint32_t parent = child / 2;
+      if (A[parent]->priority > entry->priority)
+      {
+         placeEntry(A, child, A[parent]);
+         child = parent;
+      }
+      else
+      {
+         break;
+      }
+   }
+
+   placeEntry(A, child, entry);
+}
+
+bool ipq_push(struct indexed_priority_queue* pq, struct priority_queue_entry* entry)
+{
+   if (ipq_isFull(pq))
+   {
+      return false;
+   }
+
+   pq->size ++;
+   pq->memPool[pq->size] = entry;
+
+   siftupIndexed(pq->memPool, pq->size);
+
+   return true;
+}
+
+struct priority_queue_entry* ipq_peek(const struct indexed_priority_queue* pq)
+{
+   return ipq_isEmpty(pq) ? NULL : pq->memPool[1];
+}
+
+struct priority_queue_entry* ipq_pop(struct indexed_priority_queue* pq)
+{
+   struct priority_queue_entry* entry = ipq_peek(pq);
+
+   if (entry)
+   {
+      ipq_remove(pq, entry);
+   }
+
+   return entry;
+}
+
+/* Checks the entry is on this queue, and not just on some indexed queue
+ */
+static inline bool isQueuedOn(const struct indexed_priority_queue* pq, const struct priority_queue_entry* entry)
+{
+   return (entry->slot) && (entry->slot <= pq->size) && (pq->memPool[entry->slot] == entry);
+}
+
+bool ipq_remove(struct indexed_priority_queue* pq, struct priority_queue_entry* entry)
+{
+   if (! isQueuedOn(pq, entry))
+   {
+      return false;
+   }
+
+   const uint32_t slot = entry->slot;
+   struct priority_queue_entry* last = pq->memPool[pq->size --];
+
+   entry->slot = 0;
+
+   if (last != entry)
+   {
+      /*
+       * the last entry fills the hole; it can belong either above or
+       * below it, and only one of the sifts moves it
+       */
+      placeEntry(pq->memPool, slot, last);
+      siftupIndexed(pq->memPool, slot);
+      siftdownIndexed(pq->memPool, pq->size, last->slot);
+   }
+
+   return true;
+}
+
+bool ipq_update(struct indexed_priority_queue* pq, struct priority_queue_entry* entry)
+{
+   if (! isQueuedOn(pq, entry))
+   {
+      return false;
+   }
+
+   /*
+    * only one of them moves the entry
+    */
+   siftupIndexed(pq->memPool, entry->slot);
+   siftdownIndexed(pq->memPool, pq->size, entry->slot);
+
+   return true;
+}
+
+void kpq_initialize(struct keyed_priority_queue* pq, struct keyed_priority_queue_slot* slots, uint32_t queueSize, enum kpq_arity arity)
+{
+   pq->capacity   = queueSize;
+   pq->size       = 0;
+   pq->arityShift = arity;
+   pq->slots      = slots;
+}
+
+bool kpq_isEmpty(const struct keyed_priority_queue* pq)
+{
+   return (0 == pq->size);
+}
+
+bool kpq_isFull(const struct keyed_priority_queue* pq)
+{
+   return (pq->size == pq->capacity);
+}
+
+/*
+ * The keyed heap starts at index 0, so the children of node N are
+ * (N << shift) + 1 .. (N << shift) + arity, for any power of two arity.
+ */
+
+static void siftupKeyed(struct keyed_priority_queue_slot* A, uint32_t shift, uint32_t child, struct keyed_priority_queue_slot item)
+{
+   while (child > 0)
+   {
+      uint32_t parent = (child - 1) >> shift;
+      if (A[parent].key > item.key)
+      {
+         A[child] = A[parent];
+         child    = parent;
+      }
+      else
+      {
+         break;
+      }
+   }
+
+   A[child] = item;
+}
+
+static void siftdownKeyed(struct keyed_priority_queue_slot* A, uint32_t shift, uint32_t count, uint32_t parent, struct keyed_priority_queue_slot item)
+{
+   while (true)
+   {
+      uint32_t firstChild = (parent << shift) + 1;
+
+      if (firstChild >= count)
+      {
+         break;
+      }
+
+      uint32_t lastChild = firstChild + (1U << shift);
+      if (lastChild > count)
+      {
+         lastChild = count;
+      }
+
+      uint32_t child = firstChild;
+      for (uint32_t sibling = firstChild + 1; sibling < lastChild; sibling ++)
+      {
+         if (A[sibling].key < A[child].key)
+         {
+            child = sibling;
+         }
+      }
+
+      if (item.key <= A[child].key)
+      {
+         break;
+      }
+
+      A[parent] = A[child];
+      parent    = child;
+   }
+
+   A[parent] = item;
+}
+
+bool kpq_push(struct keyed_priority_queue* pq, void* object, uint32_t key)
+{
+   if (kpq_isFull(pq))
+   {
+      return false;
+   }
+
+   const struct keyed_priority_queue_slot item = { key, object };
+
+   siftupKeyed(pq->slots, pq->arityShift, pq->size, item);
+   pq->size ++;
+
+   return true;
+}
+
+void* kpq_peek(const struct keyed_priority_queue* pq, uint32_t* key)
+{
+   if (kpq_isEmpty(pq))
+   {
+      return NULL;
+   }
+
+   if (key)
+   {
+      *key = pq->slots[0].key;
+   }
+
+   return pq->slots[0].object;
+}
+
+void* kpq_pop(struct keyed_priority_queue* pq, uint32_t* key)
+{
+   void* object = kpq_peek(pq, key);
+
+   if (object)
+   {
+      pq->size --;
+
+      /*
+       * the last element fills the hole at the root
+       */
+      if (pq->size)
+      {
+         siftdownKeyed(pq->slots, pq->arityShift, pq->size, 0, pq->slots[pq->size]);
+      }
+   }
+
+   return object;
+}
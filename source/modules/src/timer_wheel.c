@@ -0,0 +1,297 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hierarchical timing wheel implementation
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <timer_wheel.h>
+
+#define TWH_NOT_QUEUED           0xff
+
+/// Mask of the deadline bits indexing the slots of levels 0 .. (levelCount - 1)
+static inline uint64_t getLevelsMask(uint32_t levelCount)
+{
+   return (((uint64_t) 1) << (levelCount * TWH_SLOT_BITS)) - 1;
+}
+
+static inline struct timer_wheel_entry** getSlotHead(struct timer_wheel* tw, uint32_t level, uint32_t slot)
+{
+   if (TWH_LEVEL_COUNT == level)
+   {
+      return &tw->overflow;
+   }
+   else
+   {
+      return &tw->slots[level][slot];
+   }
+}
+
+/* File an entry on the level of the most significant slot index digit
+ * where its deadline differs from the current time.
+ */
+static void fileEntry(struct timer_wheel* tw, struct timer_wheel_entry* entry)
+{
+   const uint64_t difference = entry->deadline_ticks ^ tw->now_ticks;
+   assert(difference);
+
+   uint32_t level = (63 - (uint32_t) __builtin_clzll(difference)) / TWH_SLOT_BITS;
+   uint32_t slot  = 0;
+
+   if (TWH_LEVEL_COUNT <= level)
+   {
+      level = TWH_LEVEL_COUNT;
+   }
+   else
+   {
+      slot = (uint32_t) (entry->deadline_ticks >> (level * TWH_SLOT_BITS)) & (TWH_SLOT_COUNT - 1);
+      tw->occupied[level] |= (1U << slot);
+   }
+
+   struct timer_wheel_entry** head = getSlotHead(tw, level, slot);
+
+   entry->level    = (uint8_t) level;
+   entry->slot     = (uint8_t) slot;
+   entry->previous = NULL;
+   entry->next     = *head;
+   if (*head)
+   {
+      (*head)->previous = entry;
+   }
+   *head = entry;
+}
+
+/* Find the earliest slot boundary where processing is required: the
+ * first slot on the lowest occupied level or, for the overflow list, the
+ * top level rotation holding its earliest deadline.
+ *
+ * Entries on level L share all the higher digits with the current time,
+ * so any slot on level L starts before any slot on a level above L.
+ *
+ * @return the level, TWH_LEVEL_COUNT for overflow
+ */
+static uint32_t findFirstBoundary(const struct timer_wheel* tw, uint64_t* boundary_ticks, uint32_t* slot)
+{
+   for (uint32_t level = 0; level < TWH_LEVEL_COUNT; level ++)
+   {
+      if (tw->occupied[level])
+      {
+         *slot = (uint32_t) __builtin_ctz(tw->occupied[level]);
+
+         *boundary_ticks = (tw->now_ticks & ~getLevelsMask(level + 1)) | (((uint64_t) *slot) << (level * TWH_SLOT_BITS));
+
+         return level;
+      }
+   }
+
+   *slot           = 0;
+   *boundary_ticks = UINT64_MAX;
+
+   for (const struct timer_wheel_entry* entry = tw->overflow; entry; entry = entry->next)
+   {
+      const uint64_t rotation_ticks = entry->deadline_ticks & ~getLevelsMask(TWH_LEVEL_COUNT);
+      if (*boundary_ticks > rotation_ticks)
+      {
+         *boundary_ticks = rotation_ticks;
+      }
+   }
+
+   return TWH_LEVEL_COUNT;
+}
+
+void twh_initialize(struct timer_wheel* tw, uint64_t now_ticks)
+{
+   memset(tw, 0, sizeof(*tw));
+
+   tw->now_ticks = now_ticks;
+}
+
+bool twh_isEmpty(const struct timer_wheel* tw)
+{
+   return (0 == tw->size);
+}
+
+bool twh_isQueued(const struct timer_wheel_entry* entry)
+{
+   return (TWH_NOT_QUEUED != entry->level);
+}
+
+void twh_initializeEntry(struct timer_wheel_entry* entry)
+{
+   entry->next           = NULL;
+   entry->previous       = NULL;
+   entry->deadline_ticks = 0;
+   entry->level          = TWH_NOT_QUEUED;
+   entry->slot           = 0;
+}
+
+bool twh_insert(struct timer_wheel* tw, struct timer_wheel_entry* entry, uint64_t deadline_ticks)
+{
+   assert(! twh_isQueued(entry));
+
+   entry->deadline_ticks = deadline_ticks;
+
+   if (deadline_ticks <= tw->now_ticks)
+   {
+      return false;
+   }
+
+   fileEntry(tw, entry);
+   tw->size ++;
+
+   return true;
+}
+
+bool twh_cancel(struct timer_wheel* tw, struct timer_wheel_entry* entry)
+{
+   if (! twh_isQueued(entry))
+   {
+      return false;
+   }
+
+   assert(tw->size);
+
+   struct timer_wheel_entry** head = getSlotHead(tw, entry->level, entry->slot);
+
+   if (entry->previous)
+   {
+      entry->previous->next = entry->next;
+   }
+   else
+   {
+      assert(*head == entry);
+      *head = entry->next;
+   }
+
+   if (entry->next)
+   {
+      entry->next->previous = entry->previous;
+   }
+
+   if ((NULL == *head) && (TWH_LEVEL_COUNT != entry->level))
+   {
+      tw->occupied[entry->level] &= ~(1U << entry->slot);
+   }
+
+   entry->next     = NULL;
+   entry->previous = NULL;
+   entry->level    = TWH_NOT_QUEUED;
+   entry->slot     = 0;
+
+   tw->size --;
+
+   return true;
+}
+
+bool twh_getNextDeadline(const struct timer_wheel* tw, uint64_t* deadline_ticks)
+{
+   if (0 == tw->size)
+   {
+      return false;
+   }
+
+   uint64_t boundary_ticks = 0;
+   uint32_t slot           = 0;
+   const uint32_t level    = findFirstBoundary(tw, &boundary_ticks, &slot);
+
+   if (0 == level)
+   {
+      // all entries on a level 0 slot expire exactly at its boundary
+      *deadline_ticks = boundary_ticks;
+   }
+   else
+   {
+      // the slot spans many ticks; its earliest entry is the next deadline
+      const struct timer_wheel_entry* entry = (TWH_LEVEL_COUNT == level) ? tw->overflow : tw->slots[level][slot];
+      assert(entry);
+
+      *deadline_ticks = entry->deadline_ticks;
+      for (entry = entry->next; entry; entry = entry->next)
+      {
+         if (*deadline_ticks > entry->deadline_ticks)
+         {
+            *deadline_ticks = entry->deadline_ticks;
+         }
+      }
+   }
+
+   return true;
+}
+
+struct timer_wheel_entry* twh_advance(struct timer_wheel* tw, uint64_t now_ticks)
+{
+   struct timer_wheel_entry* expired = NULL;
+
+   while (tw->now_ticks < now_ticks)
+   {
+      uint64_t boundary_ticks = 0;
+      uint32_t slot           = 0;
+      const uint32_t level    = findFirstBoundary(tw, &boundary_ticks, &slot);
+
+      if ((0 == tw->size) || (boundary_ticks > now_ticks))
+      {
+         tw->now_ticks = now_ticks;
+         break;
+      }
+
+      tw->now_ticks = boundary_ticks;
+
+      /*
+       * Detach the slot, then either expire its entries or cascade them
+       * to the lower levels.
+       */
+      struct timer_wheel_entry** head  = getSlotHead(tw, level, slot);
+      struct timer_wheel_entry*  entry = *head;
+
+      *head = NULL;
+      if (TWH_LEVEL_COUNT != level)
+      {
+         tw->occupied[level] &= ~(1U << slot);
+      }
+
+      while (entry)
+      {
+         struct timer_wheel_entry* next = entry->next;
+
+         if (entry->deadline_ticks <= tw->now_ticks)
+         {
+            entry->previous = NULL;
+            entry->level    = TWH_NOT_QUEUED;
+            entry->slot     = 0;
+
+            entry->next = expired;
+            expired     = entry;
+
+            tw->size --;
+         }
+         else
+         {
+            fileEntry(tw, entry);
+         }
+
+         entry = next;
+      }
+   }
+
+   return expired;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file trace_ring.c
+ * @brief Lock-free binary trace ring
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <trace_ring.h>
+
+void trc_initialize(struct trace_ring* tr, struct trace_record* records, uint32_t capacity)
+{
+   assert(capacity);
+   assert(0 == (capacity & (capacity - 1)));
+
+   tr->capacity = capacity;
+   tr->head     = 0;
+   tr->records  = records;
+
+   for (uint32_t ii = 0; ii < capacity; ii ++)
+   {
+      records[ii].timestamp = 0;
+      records[ii].event     = 0;
+   }
+
+   // last, so a dump never shows a half-initialized ring
+   __atomic_store_n(&tr->magic, TRC_MAGIC, __ATOMIC_SEQ_CST);
+}
+
+uint32_t trc_fetch(const struct trace_ring* tr, uint32_t* cursor, struct trace_record* records, uint32_t count, uint32_t* lost)
+{
+   const uint32_t head = __atomic_load_n(&tr->head, __ATOMIC_SEQ_CST);
+
+   uint32_t available = head - *cursor;
+   if (available > tr->capacity)
+   {
+      *lost   += available - tr->capacity;
+      *cursor  = head - tr->capacity;
+      available = tr->capacity;
+   }
+
+   if (count > available)
+   {
+      count = available;
+   }
+
+   for (uint32_t ii = 0; ii < count; ii ++)
+   {
+      records[ii] = tr->records[(*cursor + ii) & (tr->capacity - 1)];
+   }
+
+   /*
+    * Writers that lapped the reader during the copy claimed the slots of
+    * the oldest records copied; drop those, they may hold newer events.
+    */
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   const int32_t overwritten = (int32_t) (__atomic_load_n(&tr->head, __ATOMIC_SEQ_CST) - tr->capacity - *cursor);
+
+   *cursor += count;
+
+   if (overwritten > 0)
+   {
+      const uint32_t dropped = ((uint32_t) overwritten < count) ? (uint32_t) overwritten : count;
+
+      *lost += dropped;
+      count -= dropped;
+      memmove(records, records + dropped, count * sizeof(records[0]));
+   }
+
+   return count;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <priority_queue.h>
+
+#include <CppUTest/TestHarness.h>
+
+/*
+ * Host benchmark of the priority queue layouts, on the "hold" model: the
+ * queue is filled, then each round pops the first object and pushes it
+ * back with a later key, as the kernel does with ready tasks and timers.
+ *
+ * The objects are as far apart as task control blocks, in shuffled order,
+ * so the pointer heap misses the cache the way it does on a loaded system.
+ * All layouts pop the same sequence of keys, which is checked.
+ */
+
+namespace
+{
+
+const uint32_t objectStride_words = 32;
+const uint32_t holdRounds         = 100000;
+
+struct bench_result
+{
+   double   nsPerRound;
+   uint64_t checksum;
+};
+
+class HoldModel
+{
+public:
+   explicit HoldModel(uint32_t elementCount) :
+      elementCount(elementCount),
+      memory(elementCount * objectStride_words),
+      objects(elementCount),
+      increments(holdRounds)
+   {
+      uint32_t seed = 2016;
+
+      for (uint32_t ii = 0; ii < elementCount; ii ++)
+      {
+         objects[ii] = &memory[ii * objectStride_words];
+      }
+
+      for (uint32_t ii = elementCount - 1; ii > 0; ii --)
+      {
+         std::swap(objects[ii], objects[nextRandom(seed) % (ii + 1)]);
+      }
+
+      initialKeys.resize(elementCount);
+      for (uint32_t ii = 0; ii < elementCount; ii ++)
+      {
+         initialKeys[ii] = nextRandom(seed) % (1U << 16);
+      }
+
+      for (uint32_t ii = 0; ii < holdRounds; ii ++)
+      {
+         increments[ii] = 1 + nextRandom(seed) % (1U << 10);
+      }
+   }
+
+   bench_result runPointerHeap()
+   {
+      std::vector<uint32_t*> memPool(elementCount + 1);
+      struct priority_queue pq;
+      prq_initialize(&pq, memPool.data(), elementCount);
+
+      for (uint32_t ii = 0; ii < elementCount; ii ++)
+      {
+         *objects[ii] = initialKeys[ii];
+         prq_push(&pq, objects[ii]);
+      }
+
+      bench_result result = { 0, 0 };
+      const auto start = std::chrono::steady_clock::now();
+
+      for (uint32_t round = 0; round < holdRounds; round ++)
+      {
+         uint32_t* object = prq_pop(&pq);
+         result.checksum += *object;
+         *object += increments[round];
+         prq_push(&pq, object);
+      }
+
+      result.nsPerRound = elapsedPerRound(start);
+      return result;
+   }
+
+   bench_result runKeyedHeap(enum kpq_arity arity)
+   {
+      std::vector<struct keyed_priority_queue_slot> slots(elementCount);
+      struct keyed_priority_queue pq;
+      kpq_initialize(&pq, slots.data(), elementCount, arity);
+
+      for (uint32_t ii = 0; ii < elementCount; ii ++)
+      {
+         kpq_push(&pq, objects[ii], initialKeys[ii]);
+      }
+
+      bench_result result = { 0, 0 };
+      const auto start = std::chrono::steady_clock::now();
+
+      for (uint32_t round = 0; round < holdRounds; round ++)
+      {
+         uint32_t key = 0;
+         void* object = kpq_pop(&pq, &key);
+         result.checksum += key;
+         kpq_push(&pq, object, key + increments[round]);
+      }
+
+      result.nsPerRound = elapsedPerRound(start);
+      return result;
+   }
+
+private:
+   static uint32_t nextRandom(uint32_t& seed)
+   {
+      seed = seed * 1103515245 + 12345;
+      return seed >> 8;
+   }
+
+   static double elapsedPerRound(std::chrono::steady_clock::time_point start)
+   {
+      const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      return elapsed.count() / holdRounds;
+   }
+
+   const uint32_t          elementCount;
+
+   std::vector<uint32_t>   memory;
+   std::vector<uint32_t*>  objects;
+   std::vector<uint32_t>   initialKeys;
+   std::vector<uint32_t>   increments;
+};
+
+}
+
+TEST_GROUP(PriorityQueueBenchmark)
+{
+   void setup()
+   {
+   }
+
+   void tearDown()
+   {
+   }
+
+   void compareLayouts(uint32_t elementCount)
+   {
+      HoldModel model(elementCount);
+
+      const bench_result pointerHeap     = model.runPointerHeap();
+      const bench_result keyedBinary     = model.runKeyedHeap(KPQ_BINARY);
+      const bench_result keyedQuaternary = model.runKeyedHeap(KPQ_QUATERNARY);
+
+      CHECK(pointerHeap.checksum == keyedBinary.checksum);
+      CHECK(pointerHeap.checksum == keyedQuaternary.checksum);
+
+      printf("\npriority queue, %4u elements: pointer heap %6.1f ns, keyed binary %6.1f ns, keyed 4-ary %6.1f ns per pop + push\n",
+             elementCount, pointerHeap.nsPerRound, keyedBinary.nsPerRound, keyedQuaternary.nsPerRound);
+   }
+};
+
+TEST(PriorityQueueBenchmark, Hold16)
+{
+   compareLayouts(16);
+}
+
+TEST(PriorityQueueBenchmark, Hold256)
+{
+   compareLayouts(256);
+}
+
+TEST(PriorityQueueBenchmark, Hold4096)
+{
+   compareLayouts(4096);
+}
@@ -0,0 +1,135 @@
+/**
+ * @file test_bitmap_allocator.cpp
+ * @brief Tests for the hierarchical bitmap allocator
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <bitmap_allocator.h>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(BitmapAllocator)
+{
+   static const uint32_t slotCount = 100;
+
+   struct bitmap_allocator    ba;
+   volatile uint32_t          bitmap[BMA_BITMAP_WORD_COUNT(slotCount)];
+
+   void setup()
+   {
+      bma_initialize(&ba, bitmap, slotCount);
+   }
+
+   void tearDown()
+   {
+   }
+};
+
+TEST(BitmapAllocator, NewAllocatorHasAllSlotsFree)
+{
+   UNSIGNED_LONGS_EQUAL(slotCount, bma_getFreeCount(&ba));
+   UNSIGNED_LONGS_EQUAL(0, bma_getHighWaterMark(&ba));
+   UNSIGNED_LONGS_EQUAL(0, bma_getFailureCount(&ba));
+}
+
+TEST(BitmapAllocator, AllocatesLowestFreeSlot)
+{
+   UNSIGNED_LONGS_EQUAL(0, bma_alloc(&ba, 0));
+   UNSIGNED_LONGS_EQUAL(1, bma_alloc(&ba, 0));
+   UNSIGNED_LONGS_EQUAL(2, bma_alloc(&ba, 0));
+
+   bma_free(&ba, 1);
+
+   UNSIGNED_LONGS_EQUAL(1, bma_alloc(&ba, 0));
+   UNSIGNED_LONGS_EQUAL(slotCount - 3, bma_getFreeCount(&ba));
+}
+
+TEST(BitmapAllocator, AllocatesEverySlotExactlyOnce)
+{
+   bool seen[slotCount] = {};
+
+   for (uint32_t ii = 0; ii < slotCount; ++ ii)
+   {
+      const uint32_t slot = bma_alloc(&ba, 0);
+
+      CHECK(slot < slotCount);
+      CHECK(! seen[slot]);
+      seen[slot] = true;
+   }
+
+   UNSIGNED_LONGS_EQUAL(0, bma_getFreeCount(&ba));
+   UNSIGNED_LONGS_EQUAL(slotCount, bma_alloc(&ba, 0));
+   UNSIGNED_LONGS_EQUAL(1, bma_getFailureCount(&ba));
+}
+
+TEST(BitmapAllocator, FreedSlotInLaterWordIsFound)
+{
+   for (uint32_t ii = 0; ii < slotCount; ++ ii)
+   {
+      bma_alloc(&ba, 0);
+   }
+
+   bma_free(&ba, 97);
+
+   UNSIGNED_LONGS_EQUAL(97, bma_alloc(&ba, 0));
+
+   bma_free(&ba, 40);
+   bma_free(&ba, 5);
+
+   UNSIGNED_LONGS_EQUAL(5, bma_alloc(&ba, 0));
+   UNSIGNED_LONGS_EQUAL(40, bma_alloc(&ba, 0));
+}
+
+TEST(BitmapAllocator, ReservedSlotsAreLeftForOtherCallers)
+{
+   const uint32_t reserved = 4;
+
+   for (uint32_t ii = 0; ii < slotCount - reserved; ++ ii)
+   {
+      CHECK(bma_alloc(&ba, reserved) < slotCount);
+   }
+
+   UNSIGNED_LONGS_EQUAL(slotCount, bma_alloc(&ba, reserved));
+   UNSIGNED_LONGS_EQUAL(1, bma_getFailureCount(&ba));
+
+   CHECK(bma_alloc(&ba, reserved - 1) < slotCount);
+   CHECK(bma_alloc(&ba, 0) < slotCount);
+   UNSIGNED_LONGS_EQUAL(reserved - 2, bma_getFreeCount(&ba));
+}
+
+TEST(BitmapAllocator, HighWaterMarkTracksPeakUsage)
+{
+   uint32_t slots[10];
+
+   for (uint32_t ii = 0; ii < 10; ++ ii)
+   {
+      slots[ii] = bma_alloc(&ba, 0);
+   }
+
+   for (uint32_t ii = 0; ii < 10; ++ ii)
+   {
+      bma_free(&ba, slots[ii]);
+   }
+
+   bma_alloc(&ba, 0);
+
+   UNSIGNED_LONGS_EQUAL(10, bma_getHighWaterMark(&ba));
+   UNSIGNED_LONGS_EQUAL(slotCount - 1, bma_getFreeCount(&ba));
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_bitmap_queue.cpp
+ * @brief Tests for the bitmap-indexed multi-level queue
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <bitmap_queue.h>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(BitmapQueue)
+{
+   static const uint32_t levelCount = 80;
+
+   struct bitmap_queue        bq;
+   struct bitmap_queue_level  levels[levelCount];
+   uint32_t                   bitmap[BMQ_BITMAP_WORD_COUNT(levelCount)];
+
+   struct list_element        elements[8];
+
+   void setup()
+   {
+      bmq_initialize(&bq, levels, bitmap, levelCount);
+   }
+
+   void tearDown()
+   {
+   }
+};
+
+TEST(BitmapQueue, NewQueueIsEmpty)
+{
+   CHECK(bmq_isEmpty(&bq));
+   UNSIGNED_LONGS_EQUAL(levelCount, bmq_getHighestLevel(&bq));
+   POINTERS_EQUAL(NULL, bmq_pop(&bq, NULL));
+}
+
+TEST(BitmapQueue, AfterAddingOneThenRemovingOneQueueIsEmpty)
+{
+   bmq_push(&bq, &elements[0], 7);
+
+   CHECK(! bmq_isEmpty(&bq));
+   UNSIGNED_LONGS_EQUAL(7, bmq_getHighestLevel(&bq));
+
+   uint32_t level = 0;
+   POINTERS_EQUAL(&elements[0], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(7, level);
+
+   CHECK(bmq_isEmpty(&bq));
+}
+
+TEST(BitmapQueue, SameLevelIsFIFO)
+{
+   bmq_push(&bq, &elements[0], 3);
+   bmq_push(&bq, &elements[1], 3);
+   bmq_push(&bq, &elements[2], 3);
+
+   POINTERS_EQUAL(&elements[0], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[1], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[2], bmq_pop(&bq, NULL));
+   CHECK(bmq_isEmpty(&bq));
+}
+
+TEST(BitmapQueue, LowerLevelFirstAcrossWords)
+{
+   bmq_push(&bq, &elements[0], 79);
+   bmq_push(&bq, &elements[1], 33);
+   bmq_push(&bq, &elements[2], 64);
+   bmq_push(&bq, &elements[3], 0);
+   bmq_push(&bq, &elements[4], 31);
+
+   uint32_t level = 0;
+   POINTERS_EQUAL(&elements[3], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(0, level);
+   POINTERS_EQUAL(&elements[4], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(31, level);
+   POINTERS_EQUAL(&elements[1], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(33, level);
+   POINTERS_EQUAL(&elements[2], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(64, level);
+   POINTERS_EQUAL(&elements[0], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(79, level);
+
+   CHECK(bmq_isEmpty(&bq));
+}
+
+TEST(BitmapQueue, RemoveFromMiddleHeadAndTail)
+{
+   bmq_push(&bq, &elements[0], 5);
+   bmq_push(&bq, &elements[1], 5);
+   bmq_push(&bq, &elements[2], 5);
+   bmq_push(&bq, &elements[3], 5);
+
+   CHECK(bmq_remove(&bq, &elements[1], 5));
+   CHECK(bmq_remove(&bq, &elements[0], 5));
+   CHECK(bmq_remove(&bq, &elements[3], 5));
+   CHECK(! bmq_remove(&bq, &elements[3], 5));
+
+   UNSIGNED_LONGS_EQUAL(1, bq.size);
+
+   bmq_push(&bq, &elements[4], 5);
+
+   POINTERS_EQUAL(&elements[2], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[4], bmq_pop(&bq, NULL));
+   CHECK(bmq_isEmpty(&bq));
+}
+
+TEST(BitmapQueue, RemoveLastElementClearsLevel)
+{
+   bmq_push(&bq, &elements[0], 40);
+   bmq_push(&bq, &elements[1], 70);
+
+   CHECK(bmq_remove(&bq, &elements[0], 40));
+   CHECK(bmq_isLevelEmpty(&bq, 40));
+   UNSIGNED_LONGS_EQUAL(70, bmq_getHighestLevel(&bq));
+}
+
+TEST(BitmapQueue, AppendLevelPreservesOrder)
+{
+   bmq_push(&bq, &elements[0], 10);
+   bmq_push(&bq, &elements[1], 11);
+   bmq_push(&bq, &elements[2], 11);
+   bmq_push(&bq, &elements[3], 10);
+
+   bmq_appendLevel(&bq, 11, 10);
+
+   CHECK(bmq_isLevelEmpty(&bq, 11));
+   UNSIGNED_LONGS_EQUAL(4, bq.size);
+
+   POINTERS_EQUAL(&elements[0], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[3], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[1], bmq_pop(&bq, NULL));
+   POINTERS_EQUAL(&elements[2], bmq_pop(&bq, NULL));
+   CHECK(bmq_isEmpty(&bq));
+}
+
+TEST(BitmapQueue, AppendLevelIntoEmptyLevel)
+{
+   bmq_push(&bq, &elements[0], 50);
+   bmq_push(&bq, &elements[1], 50);
+
+   bmq_appendLevel(&bq, 50, 2);
+
+   uint32_t level = 0;
+   POINTERS_EQUAL(&elements[0], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(2, level);
+   POINTERS_EQUAL(&elements[1], bmq_pop(&bq, &level));
+   UNSIGNED_LONGS_EQUAL(2, level);
+   CHECK(bmq_isEmpty(&bq));
+}
@@ -0,0 +1,202 @@
+/**
+ * @file test_pairing_heap.cpp
+ * @brief Tests for the intrusive pairing heap
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <pairing_heap.h>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(PairingHeap)
+{
+   static const uint32_t nodeCount = 64;
+
+   struct pairing_heap        ph;
+   struct pairing_heap_node   nodes[nodeCount];
+
+   void setup()
+   {
+      phq_initialize(&ph);
+   }
+
+   void tearDown()
+   {
+   }
+
+   uint32_t indexOf(const struct pairing_heap_node* node)
+   {
+      return (uint32_t) (node - nodes);
+   }
+};
+
+TEST(PairingHeap, NewHeapIsEmpty)
+{
+   CHECK(phq_isEmpty(&ph));
+   POINTERS_EQUAL(NULL, phq_peek(&ph));
+   POINTERS_EQUAL(NULL, phq_pop(&ph));
+}
+
+TEST(PairingHeap, AfterAddingOneThenRemovingOneHeapIsEmpty)
+{
+   phq_insert(&ph, &nodes[0], 5);
+
+   CHECK(! phq_isEmpty(&ph));
+   POINTERS_EQUAL(&nodes[0], phq_peek(&ph));
+   POINTERS_EQUAL(&nodes[0], phq_pop(&ph));
+   CHECK(phq_isEmpty(&ph));
+}
+
+TEST(PairingHeap, PopsInKeyOrder)
+{
+   for (uint32_t ii = 0; ii < nodeCount; ++ ii)
+   {
+      // a permutation of the keys
+      phq_insert(&ph, &nodes[ii], (ii * 37) % nodeCount);
+   }
+
+   for (uint32_t key = 0; key < nodeCount; ++ key)
+   {
+      struct pairing_heap_node* node = phq_pop(&ph);
+
+      CHECK(node);
+      UNSIGNED_LONGS_EQUAL(key, node->key);
+   }
+
+   CHECK(phq_isEmpty(&ph));
+}
+
+TEST(PairingHeap, EqualKeysPopInInsertionOrder)
+{
+   for (uint32_t ii = 0; ii < 8; ++ ii)
+   {
+      phq_insert(&ph, &nodes[ii], 3 - (ii % 2));
+   }
+
+   const uint32_t expectedOrder[] = { 1, 3, 5, 7, 0, 2, 4, 6 };
+
+   for (uint32_t ii = 0; ii < 8; ++ ii)
+   {
+      UNSIGNED_LONGS_EQUAL(expectedOrder[ii], indexOf(phq_pop(&ph)));
+   }
+}
+
+TEST(PairingHeap, RemovesArbitraryNodes)
+{
+   for (uint32_t ii = 0; ii < 16; ++ ii)
+   {
+      phq_insert(&ph, &nodes[ii], ii);
+   }
+
+   // force some structure, so removed nodes are inner nodes
+   POINTERS_EQUAL(&nodes[0], phq_pop(&ph));
+
+   phq_remove(&ph, &nodes[7]);
+   phq_remove(&ph, &nodes[1]);
+   phq_remove(&ph, &nodes[15]);
+   phq_remove(&ph, &nodes[4]);
+
+   const uint32_t expectedOrder[] = { 2, 3, 5, 6, 8, 9, 10, 11, 12, 13, 14 };
+
+   for (uint32_t ii = 0; ii < sizeof(expectedOrder) / sizeof(expectedOrder[0]); ++ ii)
+   {
+      UNSIGNED_LONGS_EQUAL(expectedOrder[ii], indexOf(phq_pop(&ph)));
+   }
+
+   CHECK(phq_isEmpty(&ph));
+}
+
+TEST(PairingHeap, UpdateMovesNode)
+{
+   for (uint32_t ii = 0; ii < 8; ++ ii)
+   {
+      phq_insert(&ph, &nodes[ii], 10 + ii);
+   }
+
+   POINTERS_EQUAL(&nodes[0], phq_pop(&ph));
+
+   phq_update(&ph, &nodes[6], 1);
+   phq_update(&ph, &nodes[1], 30);
+   phq_update(&ph, &nodes[3], 14);
+
+   const uint32_t expectedOrder[] = { 6, 2, 4, 3, 5, 7, 1 };
+
+   for (uint32_t ii = 0; ii < sizeof(expectedOrder) / sizeof(expectedOrder[0]); ++ ii)
+   {
+      UNSIGNED_LONGS_EQUAL(expectedOrder[ii], indexOf(phq_pop(&ph)));
+   }
+
+   CHECK(phq_isEmpty(&ph));
+}
+
+TEST(PairingHeap, InterleavedOperationsKeepOrder)
+{
+   bool     queued[nodeCount] = {};
+   uint32_t state = 12345;
+
+   for (uint32_t round = 0; round < 2000; ++ round)
+   {
+      state = state * 1103515245 + 12345;
+      const uint32_t ii = (state >> 8) % nodeCount;
+
+      if (queued[ii])
+      {
+         if (state & 0x10000)
+         {
+            phq_remove(&ph, &nodes[ii]);
+            queued[ii] = false;
+         }
+         else
+         {
+            phq_update(&ph, &nodes[ii], (state >> 20) % 16);
+         }
+      }
+      else
+      {
+         phq_insert(&ph, &nodes[ii], (state >> 20) % 16);
+         queued[ii] = true;
+      }
+
+      // the top of the heap is a minimum of the queued nodes
+      const struct pairing_heap_node* top = phq_peek(&ph);
+      for (uint32_t jj = 0; jj < nodeCount; ++ jj)
+      {
+         if (queued[jj])
+         {
+            CHECK(top);
+            CHECK(top->key <= nodes[jj].key);
+         }
+      }
+   }
+
+   uint32_t lastKey = 0;
+   while (! phq_isEmpty(&ph))
+   {
+      struct pairing_heap_node* node = phq_pop(&ph);
+      CHECK(lastKey <= node->key);
+      lastKey = node->key;
+      queued[indexOf(node)] = false;
+   }
+
+   for (uint32_t jj = 0; jj < nodeCount; ++ jj)
+   {
+      CHECK(! queued[jj]);
+   }
+}
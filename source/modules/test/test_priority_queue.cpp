@@ -131,3 +131,375 @@ TEST(PriorityQueue, PermutationsOfXValues)
    delete[] sortedValues;
    delete[] values;
 }
+
+TEST(PriorityQueue, RaisedPriorityMovesElementForward)
+{
+   uint32_t values[] = { 10, 20, 30, 40, 50 };
+
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      prq_push(&pq, &values[ii]);
+   }
+
+   values[3] = 5;
+   CHECK(prq_update(&pq, &values[3]));
+
+   POINTERS_EQUAL(&values[3], prq_pop(&pq));
+   POINTERS_EQUAL(&values[0], prq_pop(&pq));
+   POINTERS_EQUAL(&values[1], prq_pop(&pq));
+   POINTERS_EQUAL(&values[2], prq_pop(&pq));
+   POINTERS_EQUAL(&values[4], prq_pop(&pq));
+   CHECK(prq_isEmpty(&pq));
+}
+
+TEST(PriorityQueue, LoweredPriorityMovesElementBack)
+{
+   uint32_t values[] = { 10, 20, 30, 40, 50 };
+
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      prq_push(&pq, &values[ii]);
+   }
+
+   values[0] = 45;
+   CHECK(prq_update(&pq, &values[0]));
+
+   POINTERS_EQUAL(&values[1], prq_pop(&pq));
+   POINTERS_EQUAL(&values[2], prq_pop(&pq));
+   POINTERS_EQUAL(&values[3], prq_pop(&pq));
+   POINTERS_EQUAL(&values[0], prq_pop(&pq));
+   POINTERS_EQUAL(&values[4], prq_pop(&pq));
+   CHECK(prq_isEmpty(&pq));
+}
+
+TEST(PriorityQueue, UpdateOfMissingElementFails)
+{
+   uint32_t queued  = 10;
+   uint32_t missing = 20;
+
+   prq_push(&pq, &queued);
+
+   CHECK(! prq_update(&pq, &missing));
+   POINTERS_EQUAL(&queued, prq_pop(&pq));
+}
+
+TEST_GROUP(IndexedPriorityQueue)
+{
+   static const uint32_t queueSize = 32;
+
+   struct indexed_priority_queue pq;
+   struct priority_queue_entry* memPool[queueSize + 1];
+
+   struct priority_queue_entry entries[queueSize];
+
+   void setup()
+   {
+      ipq_initialize(&pq, memPool, queueSize);
+
+      for (uint32_t ii = 0; ii < queueSize; ii ++)
+      {
+         entries[ii].priority = 0;
+         entries[ii].slot     = 0;
+      }
+   }
+
+   void tearDown()
+   {
+   }
+
+   void checkHeap()
+   {
+      for (uint32_t slot = 1; slot <= pq.size; slot ++)
+      {
+         UNSIGNED_LONGS_EQUAL(slot, memPool[slot]->slot);
+
+         if (slot > 1)
+         {
+            CHECK(memPool[slot / 2]->priority <= memPool[slot]->priority);
+         }
+      }
+   }
+};
+
+TEST(IndexedPriorityQueue, NewQueueIsEmpty)
+{
+   CHECK(ipq_isEmpty(&pq));
+   POINTERS_EQUAL(NULL, ipq_peek(&pq));
+   POINTERS_EQUAL(NULL, ipq_pop(&pq));
+}
+
+TEST(IndexedPriorityQueue, PopsInPriorityOrder)
+{
+   const uint32_t priorities[] = { 30, 10, 50, 20, 40, 10 };
+
+   for (uint32_t ii = 0; ii < 6; ii ++)
+   {
+      entries[ii].priority = priorities[ii];
+      CHECK(ipq_push(&pq, &entries[ii]));
+      CHECK(ipq_isQueued(&entries[ii]));
+   }
+
+   checkHeap();
+
+   struct priority_queue_entry* first = ipq_peek(&pq);
+   UNSIGNED_LONGS_EQUAL(10, first->priority);
+   POINTERS_EQUAL(first, ipq_pop(&pq));
+
+   uint32_t lastPriority = 10;
+   while (! ipq_isEmpty(&pq))
+   {
+      struct priority_queue_entry* entry = ipq_pop(&pq);
+
+      CHECK(lastPriority <= entry->priority);
+      CHECK(! ipq_isQueued(entry));
+      lastPriority = entry->priority;
+
+      checkHeap();
+   }
+}
+
+TEST(IndexedPriorityQueue, PushToFullQueueFails)
+{
+   for (uint32_t ii = 0; ii < queueSize; ii ++)
+   {
+      entries[ii].priority = ii;
+      CHECK(ipq_push(&pq, &entries[ii]));
+   }
+
+   CHECK(ipq_isFull(&pq));
+
+   struct priority_queue_entry extra = { 0, 0 };
+   CHECK(! ipq_push(&pq, &extra));
+   CHECK(! ipq_isQueued(&extra));
+}
+
+TEST(IndexedPriorityQueue, RemoveFromTheMiddle)
+{
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      entries[ii].priority = (ii + 1) * 10;
+      ipq_push(&pq, &entries[ii]);
+   }
+
+   CHECK(ipq_remove(&pq, &entries[2]));
+   CHECK(! ipq_isQueued(&entries[2]));
+   checkHeap();
+
+   POINTERS_EQUAL(&entries[0], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[1], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[3], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[4], ipq_pop(&pq));
+   CHECK(ipq_isEmpty(&pq));
+}
+
+TEST(IndexedPriorityQueue, RemoveOfMissingElementFails)
+{
+   entries[0].priority = 10;
+   ipq_push(&pq, &entries[0]);
+
+   CHECK(! ipq_remove(&pq, &entries[1]));
+   CHECK(! ipq_update(&pq, &entries[1]));
+
+   CHECK(ipq_remove(&pq, &entries[0]));
+   CHECK(! ipq_remove(&pq, &entries[0]));
+   CHECK(ipq_isEmpty(&pq));
+}
+
+TEST(IndexedPriorityQueue, RemoveEntryQueuedElsewhereFails)
+{
+   struct indexed_priority_queue other;
+   struct priority_queue_entry* otherMemPool[4];
+   ipq_initialize(&other, otherMemPool, 3);
+
+   entries[0].priority = 10;
+   entries[1].priority = 20;
+   ipq_push(&pq, &entries[0]);
+   ipq_push(&other, &entries[1]);
+
+   CHECK(! ipq_remove(&pq, &entries[1]));
+   CHECK(ipq_remove(&other, &entries[1]));
+}
+
+TEST(IndexedPriorityQueue, RaisedPriorityMovesElementForward)
+{
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      entries[ii].priority = (ii + 1) * 10;
+      ipq_push(&pq, &entries[ii]);
+   }
+
+   entries[3].priority = 5;
+   CHECK(ipq_update(&pq, &entries[3]));
+   checkHeap();
+
+   POINTERS_EQUAL(&entries[3], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[0], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[1], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[2], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[4], ipq_pop(&pq));
+}
+
+TEST(IndexedPriorityQueue, LoweredPriorityMovesElementBack)
+{
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      entries[ii].priority = (ii + 1) * 10;
+      ipq_push(&pq, &entries[ii]);
+   }
+
+   entries[0].priority = 45;
+   CHECK(ipq_update(&pq, &entries[0]));
+   checkHeap();
+
+   POINTERS_EQUAL(&entries[1], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[2], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[3], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[0], ipq_pop(&pq));
+   POINTERS_EQUAL(&entries[4], ipq_pop(&pq));
+}
+
+TEST(IndexedPriorityQueue, RandomOperationsKeepHeapOrder)
+{
+   uint32_t seed = 12345;
+
+   for (uint32_t round = 0; round < 2000; round ++)
+   {
+      seed = seed * 1103515245 + 12345;
+      struct priority_queue_entry* entry = &entries[(seed >> 16) % queueSize];
+      const uint32_t priority = (seed >> 8) % 64;
+
+      if (! ipq_isQueued(entry))
+      {
+         entry->priority = priority;
+         CHECK(ipq_push(&pq, entry));
+      }
+      else if (priority & 1)
+      {
+         CHECK(ipq_remove(&pq, entry));
+      }
+      else
+      {
+         entry->priority = priority;
+         CHECK(ipq_update(&pq, entry));
+      }
+
+      checkHeap();
+   }
+
+   uint32_t lastPriority = 0;
+   while (! ipq_isEmpty(&pq))
+   {
+      struct priority_queue_entry* entry = ipq_pop(&pq);
+      CHECK(lastPriority <= entry->priority);
+      lastPriority = entry->priority;
+   }
+}
+
+TEST_GROUP(KeyedPriorityQueue)
+{
+   static const uint32_t queueSize = 64;
+
+   struct keyed_priority_queue binary;
+   struct keyed_priority_queue_slot binarySlots[queueSize];
+
+   struct keyed_priority_queue quaternary;
+   struct keyed_priority_queue_slot quaternarySlots[queueSize];
+
+   uint32_t objects[queueSize];
+
+   void setup()
+   {
+      kpq_initialize(&binary, binarySlots, queueSize, KPQ_BINARY);
+      kpq_initialize(&quaternary, quaternarySlots, queueSize, KPQ_QUATERNARY);
+   }
+
+   void tearDown()
+   {
+   }
+
+   void checkHeap(const struct keyed_priority_queue* pq)
+   {
+      for (uint32_t ii = 1; ii < pq->size; ii ++)
+      {
+         CHECK(pq->slots[(ii - 1) >> pq->arityShift].key <= pq->slots[ii].key);
+      }
+   }
+};
+
+TEST(KeyedPriorityQueue, NewQueueIsEmpty)
+{
+   CHECK(kpq_isEmpty(&binary));
+   POINTERS_EQUAL(NULL, kpq_peek(&binary, NULL));
+   POINTERS_EQUAL(NULL, kpq_pop(&quaternary, NULL));
+}
+
+TEST(KeyedPriorityQueue, PopReturnsObjectAndKey)
+{
+   CHECK(kpq_push(&binary, &objects[0], 20));
+   CHECK(kpq_push(&binary, &objects[1], 10));
+
+   uint32_t key = 0;
+   POINTERS_EQUAL(&objects[1], kpq_peek(&binary, &key));
+   UNSIGNED_LONGS_EQUAL(10, key);
+
+   POINTERS_EQUAL(&objects[1], kpq_pop(&binary, &key));
+   UNSIGNED_LONGS_EQUAL(10, key);
+   POINTERS_EQUAL(&objects[0], kpq_pop(&binary, &key));
+   UNSIGNED_LONGS_EQUAL(20, key);
+   CHECK(kpq_isEmpty(&binary));
+}
+
+TEST(KeyedPriorityQueue, PushToFullQueueFails)
+{
+   for (uint32_t ii = 0; ii < queueSize; ii ++)
+   {
+      CHECK(kpq_push(&quaternary, &objects[ii], queueSize - ii));
+   }
+
+   CHECK(kpq_isFull(&quaternary));
+   CHECK(! kpq_push(&quaternary, &objects[0], 0));
+
+   POINTERS_EQUAL(&objects[queueSize - 1], kpq_pop(&quaternary, NULL));
+}
+
+TEST(KeyedPriorityQueue, BothAritiesPopInOrder)
+{
+   uint32_t seed = 4321;
+
+   for (uint32_t round = 0; round < 1000; round ++)
+   {
+      seed = seed * 1103515245 + 12345;
+      const uint32_t key = (seed >> 8) % 100;
+
+      if ((seed >> 20) & 1)
+      {
+         const bool binaryPushed     = kpq_push(&binary, &objects[key % queueSize], key);
+         const bool quaternaryPushed = kpq_push(&quaternary, &objects[key % queueSize], key);
+         CHECK_EQUAL(binaryPushed, quaternaryPushed);
+      }
+      else
+      {
+         uint32_t binaryKey     = 0;
+         uint32_t quaternaryKey = 0;
+         void* binaryObject     = kpq_pop(&binary, &binaryKey);
+         void* quaternaryObject = kpq_pop(&quaternary, &quaternaryKey);
+
+         CHECK_EQUAL(NULL == binaryObject, NULL == quaternaryObject);
+         if (binaryObject)
+         {
+            UNSIGNED_LONGS_EQUAL(binaryKey, quaternaryKey);
+         }
+      }
+
+      checkHeap(&binary);
+      checkHeap(&quaternary);
+   }
+
+   uint32_t lastKey = 0;
+   uint32_t key     = 0;
+   while (kpq_pop(&quaternary, &key))
+   {
+      CHECK(lastKey <= key);
+      lastKey = key;
+   }
+}
@@ -0,0 +1,191 @@
+/**
+ * @file test_timer_wheel.cpp
+ * @brief Tests for the hierarchical timing wheel
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <timer_wheel.h>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(TimerWheel)
+{
+   static const uint64_t start = 0x123456789ULL;
+
+   struct timer_wheel         tw;
+   struct timer_wheel_entry   entries[8];
+
+   void setup()
+   {
+      twh_initialize(&tw, start);
+
+      for (uint32_t ii = 0; ii < sizeof(entries) / sizeof(entries[0]); ii ++)
+      {
+         twh_initializeEntry(&entries[ii]);
+      }
+   }
+
+   void tearDown()
+   {
+   }
+
+   uint32_t countExpired(struct timer_wheel_entry* expired)
+   {
+      uint32_t count = 0;
+
+      for (; expired; expired = expired->next)
+      {
+         if (! twh_isQueued(expired))
+         {
+            count ++;
+         }
+      }
+
+      return count;
+   }
+};
+
+TEST(TimerWheel, NewWheelIsEmpty)
+{
+   uint64_t deadline = 0;
+
+   CHECK(twh_isEmpty(&tw));
+   CHECK(! twh_getNextDeadline(&tw, &deadline));
+   POINTERS_EQUAL(NULL, twh_advance(&tw, start + 1000));
+}
+
+TEST(TimerWheel, DeadlineNotInTheFutureIsRejected)
+{
+   CHECK(! twh_insert(&tw, &entries[0], start));
+   CHECK(! twh_insert(&tw, &entries[1], start - 1));
+
+   CHECK(! twh_isQueued(&entries[0]));
+   CHECK(twh_isEmpty(&tw));
+}
+
+TEST(TimerWheel, ExpiresAtDeadline)
+{
+   CHECK(twh_insert(&tw, &entries[0], start + 3));
+
+   uint64_t deadline = 0;
+   CHECK(twh_getNextDeadline(&tw, &deadline));
+   CHECK(start + 3 == deadline);
+
+   POINTERS_EQUAL(NULL, twh_advance(&tw, start + 2));
+   CHECK(twh_isQueued(&entries[0]));
+
+   POINTERS_EQUAL(&entries[0], twh_advance(&tw, start + 3));
+   POINTERS_EQUAL(NULL, entries[0].next);
+   CHECK(! twh_isQueued(&entries[0]));
+   CHECK(twh_isEmpty(&tw));
+}
+
+TEST(TimerWheel, EntriesDueAtTheSameTickExpireTogether)
+{
+   CHECK(twh_insert(&tw, &entries[0], start + 5000));
+   CHECK(twh_insert(&tw, &entries[1], start + 5000));
+   CHECK(twh_insert(&tw, &entries[2], start + 5000));
+   CHECK(twh_insert(&tw, &entries[3], start + 5001));
+
+   UNSIGNED_LONGS_EQUAL(3, countExpired(twh_advance(&tw, start + 5000)));
+   CHECK(twh_isQueued(&entries[3]));
+
+   UNSIGNED_LONGS_EQUAL(1, countExpired(twh_advance(&tw, start + 5001)));
+   CHECK(twh_isEmpty(&tw));
+}
+
+TEST(TimerWheel, NextDeadlineIsExactOnEveryLevel)
+{
+   const uint64_t offsets[] = { 70000, 7, 1234, 40, 900000, 33 };
+
+   for (uint32_t ii = 0; ii < sizeof(offsets) / sizeof(offsets[0]); ii ++)
+   {
+      CHECK(twh_insert(&tw, &entries[ii], start + offsets[ii]));
+   }
+
+   const uint32_t expectedOrder[] = { 1, 5, 3, 2, 0, 4 };
+
+   for (uint32_t ii = 0; ii < sizeof(expectedOrder) / sizeof(expectedOrder[0]); ii ++)
+   {
+      uint64_t deadline = 0;
+      CHECK(twh_getNextDeadline(&tw, &deadline));
+      CHECK(start + offsets[expectedOrder[ii]] == deadline);
+
+      POINTERS_EQUAL(NULL, twh_advance(&tw, deadline - 1));
+      POINTERS_EQUAL(&entries[expectedOrder[ii]], twh_advance(&tw, deadline));
+   }
+
+   CHECK(twh_isEmpty(&tw));
+}
+
+TEST(TimerWheel, CancelRemovesEntry)
+{
+   CHECK(twh_insert(&tw, &entries[0], start + 10));
+   CHECK(twh_insert(&tw, &entries[1], start + 10));
+   CHECK(twh_insert(&tw, &entries[2], start + 20));
+
+   CHECK(twh_cancel(&tw, &entries[1]));
+   CHECK(! twh_cancel(&tw, &entries[1]));
+
+   CHECK(twh_cancel(&tw, &entries[0]));
+
+   uint64_t deadline = 0;
+   CHECK(twh_getNextDeadline(&tw, &deadline));
+   CHECK(start + 20 == deadline);
+
+   POINTERS_EQUAL(&entries[2], twh_advance(&tw, start + 30));
+   CHECK(twh_isEmpty(&tw));
+
+   // cancelled entries can be re-armed
+   CHECK(twh_insert(&tw, &entries[1], start + 40));
+   POINTERS_EQUAL(&entries[1], twh_advance(&tw, start + 40));
+}
+
+TEST(TimerWheel, BeyondTheHorizonUsesOverflow)
+{
+   const uint64_t farAway = start + (((uint64_t) 1) << (TWH_LEVEL_COUNT * TWH_SLOT_BITS)) * 3 + 17;
+
+   CHECK(twh_insert(&tw, &entries[0], farAway));
+   CHECK(twh_insert(&tw, &entries[1], start + 100));
+
+   POINTERS_EQUAL(&entries[1], twh_advance(&tw, start + 100));
+
+   uint64_t deadline = 0;
+   CHECK(twh_getNextDeadline(&tw, &deadline));
+   CHECK(farAway == deadline);
+
+   POINTERS_EQUAL(NULL, twh_advance(&tw, farAway - 1));
+   POINTERS_EQUAL(&entries[0], twh_advance(&tw, farAway));
+   CHECK(twh_isEmpty(&tw));
+}
+
+TEST(TimerWheel, LargeStepExpiresEverythingDue)
+{
+   CHECK(twh_insert(&tw, &entries[0], start + 1));
+   CHECK(twh_insert(&tw, &entries[1], start + 999));
+   CHECK(twh_insert(&tw, &entries[2], start + 65536));
+   CHECK(twh_insert(&tw, &entries[3], start + 65537));
+
+   UNSIGNED_LONGS_EQUAL(3, countExpired(twh_advance(&tw, start + 65536)));
+
+   uint64_t deadline = 0;
+   CHECK(twh_getNextDeadline(&tw, &deadline));
+   CHECK(start + 65537 == deadline);
+}
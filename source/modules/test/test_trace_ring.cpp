@@ -0,0 +1,117 @@
+/**
+ * @file test_trace_ring.cpp
+ * @brief Tests for the binary trace ring
+ * @author Florin Iucha <florin@signbit.net>
+ * @copyright Apache License, Version 2.0
+ */
+
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * This file is part of FX3 RTOS for ARM Cortex-M4
+ */
+
+#include <trace_ring.h>
+
+#include <CppUTest/TestHarness.h>
+
+TEST_GROUP(TraceRing)
+{
+   static const uint32_t capacity = 8;
+
+   TRC_DECLARE_RING(trace, capacity);
+
+   struct trace_record  fetched[2 * capacity];
+   uint32_t             cursor;
+   uint32_t             lost;
+
+   void setup()
+   {
+      trc_initialize(&trace.ring, trace.records, capacity);
+      cursor = 0;
+      lost   = 0;
+   }
+
+   void tearDown()
+   {
+   }
+};
+
+TEST(TraceRing, EmptyRingHasNothingToFetch)
+{
+   UNSIGNED_LONGS_EQUAL(TRC_MAGIC, trace.ring.magic);
+   UNSIGNED_LONGS_EQUAL(0, trc_fetch(&trace.ring, &cursor, fetched, capacity, &lost));
+   UNSIGNED_LONGS_EQUAL(0, cursor);
+   UNSIGNED_LONGS_EQUAL(0, lost);
+}
+
+TEST(TraceRing, PacksTypeAndPayload)
+{
+   UNSIGNED_LONGS_EQUAL(0x05123456, TRC_EVENT(5, 0x123456));
+   UNSIGNED_LONGS_EQUAL(0x05345678, TRC_EVENT(5, 0x12345678));
+}
+
+TEST(TraceRing, HeaderIsFollowedByRecords)
+{
+   POINTERS_EQUAL(&trace.records[0], trace.ring.records);
+   UNSIGNED_LONGS_EQUAL(sizeof(struct trace_ring), (const uint8_t*) trace.records - (const uint8_t*) &trace.ring);
+}
+
+TEST(TraceRing, FetchesRecordsInOrder)
+{
+   for (uint32_t ii = 0; ii < 5; ii ++)
+   {
+      trc_record(&trace.ring, 100 + ii, TRC_EVENT(1, ii));
+   }
+
+   UNSIGNED_LONGS_EQUAL(3, trc_fetch(&trace.ring, &cursor, fetched, 3, &lost));
+   UNSIGNED_LONGS_EQUAL(100, fetched[0].timestamp);
+   UNSIGNED_LONGS_EQUAL(TRC_EVENT(1, 2), fetched[2].event);
+
+   UNSIGNED_LONGS_EQUAL(2, trc_fetch(&trace.ring, &cursor, fetched, capacity, &lost));
+   UNSIGNED_LONGS_EQUAL(103, fetched[0].timestamp);
+   UNSIGNED_LONGS_EQUAL(104, fetched[1].timestamp);
+
+   UNSIGNED_LONGS_EQUAL(5, cursor);
+   UNSIGNED_LONGS_EQUAL(0, lost);
+}
+
+TEST(TraceRing, OverwritesOldestRecordsAndCountsThemLost)
+{
+   for (uint32_t ii = 0; ii < capacity + 3; ii ++)
+   {
+      trc_record(&trace.ring, ii, TRC_EVENT(2, ii));
+   }
+
+   UNSIGNED_LONGS_EQUAL(capacity, trc_fetch(&trace.ring, &cursor, fetched, 2 * capacity, &lost));
+   UNSIGNED_LONGS_EQUAL(3, lost);
+   UNSIGNED_LONGS_EQUAL(3, fetched[0].timestamp);
+   UNSIGNED_LONGS_EQUAL(capacity + 2, fetched[capacity - 1].timestamp);
+}
+
+TEST(TraceRing, FetchSurvivesHeadWraparound)
+{
+   trace.ring.head = UINT32_MAX - 1;
+   cursor          = UINT32_MAX - 1;
+
+   for (uint32_t ii = 0; ii < 4; ii ++)
+   {
+      trc_record(&trace.ring, ii, TRC_EVENT(3, ii));
+   }
+
+   UNSIGNED_LONGS_EQUAL(4, trc_fetch(&trace.ring, &cursor, fetched, capacity, &lost));
+   UNSIGNED_LONGS_EQUAL(0, fetched[0].timestamp);
+   UNSIGNED_LONGS_EQUAL(3, fetched[3].timestamp);
+   UNSIGNED_LONGS_EQUAL(2, cursor);
+   UNSIGNED_LONGS_EQUAL(0, lost);
+}
@@ -0,0 +1,234 @@
+#!/usr/bin/python3
+
+# @file fx3_trace.py
+# @brief Converts FX3 kernel trace records to Chrome / Perfetto trace JSON
+# @author Florin Iucha <florin@signbit.net>
+# @copyright Apache License, Version 2.0
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# This file is part of FX3 RTOS for ARM Cortex-M4
+
+"""
+Input is either a memory dump containing the fx3Trace ring (found by its
+"FX3T" magic), for example from
+
+   (gdb) dump binary memory trace.bin &fx3Trace ((char*) &fx3Trace) + sizeof(fx3Trace)
+
+or, with --stream, the records as fetched by fx3_fetchTrace and written
+as-is to a serial port: 8 bytes each, a little-endian 32-bit timestamp in
+core clock cycles followed by the event word (type in the top 8 bits, payload in
+the low 24).
+
+Load the output in chrome://tracing or https://ui.perfetto.dev
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+TRC_MAGIC = 0x54335846
+
+# size of struct trace_ring on the target: magic, capacity, head, records
+RING_HEADER_SIZE = 16
+
+RECORD = struct.Struct('<II')
+
+# enum fx3_trace_event, in source/kernel/inc/task.h
+CONTEXT_SWITCH       = 1
+COMMAND_POSTED       = 2
+COMMAND_PROCESSED    = 3
+SEMAPHORE_WAIT       = 4
+SEMAPHORE_SIGNAL     = 5
+MESSAGE_SENT         = 6
+MESSAGE_RECEIVED     = 7
+INTERRUPT_ENTERED    = 8
+INTERRUPT_EXITED     = 9
+
+# enum command_type, in source/kernel/src/fx3.c
+COMMAND_NAMES = [
+   'invalid',
+   'block task',
+   'ready task',
+   'signal semaphore',
+   'suspend',
+   'check inbox',
+   'check notification',
+   'check select',
+   'check semaphore',
+   'lock mutex',
+   'unlock mutex',
+   'wait condition',
+   'signal condition',
+   'broadcast condition',
+   'wait events',
+   'set events',
+   'start timer',
+   'stop timer',
+   'wake up',
+   'deferred work',
+]
+
+# exception numbers with a name; the others are IRQ (number - 16)
+EXCEPTION_NAMES = {
+   11: 'SVCall',
+   14: 'PendSV',
+   15: 'SysTick',
+}
+
+TASKS_TID      = 1
+INTERRUPTS_TID = 2
+
+
+def readDump(data):
+   """Returns the records of the ring in a memory dump, oldest first"""
+   offset = 0
+   while True:
+      offset = data.find(struct.pack('<I', TRC_MAGIC), offset)
+      if offset < 0:
+         raise ValueError('no trace ring found in the dump')
+
+      capacity, head = struct.unpack_from('<II', data, offset + 4)
+      if capacity and (0 == (capacity & (capacity - 1))) \
+            and (offset + RING_HEADER_SIZE + capacity * RECORD.size <= len(data)):
+         break
+
+      offset += 4
+
+   recordsAt = offset + RING_HEADER_SIZE
+   count = min(head, capacity)
+
+   records = []
+   for index in range(head - count, head):
+      slot = index & (capacity - 1)
+      records.append(RECORD.unpack_from(data, recordsAt + slot * RECORD.size))
+
+   return records
+
+
+def readStream(data):
+   """Returns the records of a stream; a partial last record is dropped"""
+   return [RECORD.unpack_from(data, offset) for offset in range(0, len(data) - RECORD.size + 1, RECORD.size)]
+
+
+def unwrapTimestamps(records):
+   """Extends the 32-bit cycle counts to monotonic values
+
+   Records are written in (nearly) time order; a small negative step is a
+   record that was claimed just before an interrupt, not a wrap-around.
+   """
+   upperBits = 0
+   previous  = None
+   for timestamp, event in records:
+      if previous is not None:
+         step = (timestamp - previous) & 0xFFFFFFFF
+         if (step < 0x80000000) and (timestamp < previous):
+            upperBits += 1 << 32
+      yield upperBits + timestamp, event
+      previous = timestamp
+
+
+def exceptionName(number):
+   if number >= 16:
+      return 'IRQ %d' % (number - 16)
+   return EXCEPTION_NAMES.get(number, 'exception %d' % number)
+
+
+def convert(records, cyclesPerMicrosecond, taskNames):
+   def taskName(taskId):
+      return taskNames.get(taskId, 'task %d' % taskId)
+
+   events = [
+      {'ph': 'M', 'pid': 0, 'name': 'process_name', 'args': {'name': 'FX3'}},
+      {'ph': 'M', 'pid': 0, 'tid': TASKS_TID, 'name': 'thread_name', 'args': {'name': 'Tasks'}},
+      {'ph': 'M', 'pid': 0, 'tid': INTERRUPTS_TID, 'name': 'thread_name', 'args': {'name': 'Interrupts'}},
+   ]
+
+   origin       = None
+   runningTask  = None
+   openHandlers = 0
+
+   for timestamp, event in unwrapTimestamps(records):
+      if origin is None:
+         origin = timestamp
+
+      eventType = event >> 24
+      payload   = event & 0x00FFFFFF
+      ts        = (timestamp - origin) / cyclesPerMicrosecond
+
+      if CONTEXT_SWITCH == eventType:
+         if runningTask is not None:
+            events.append({'ph': 'E', 'pid': 0, 'tid': TASKS_TID, 'ts': ts})
+         runningTask = payload
+         events.append({'ph': 'B', 'pid': 0, 'tid': TASKS_TID, 'ts': ts, 'name': taskName(payload)})
+
+      elif INTERRUPT_ENTERED == eventType:
+         openHandlers += 1
+         events.append({'ph': 'B', 'pid': 0, 'tid': INTERRUPTS_TID, 'ts': ts, 'name': exceptionName(payload)})
+
+      elif INTERRUPT_EXITED == eventType:
+         # the trace may start in the middle of a handler
+         if openHandlers:
+            openHandlers -= 1
+            events.append({'ph': 'E', 'pid': 0, 'tid': INTERRUPTS_TID, 'ts': ts})
+
+      else:
+         if eventType in (COMMAND_POSTED, COMMAND_PROCESSED):
+            command = COMMAND_NAMES[payload] if payload < len(COMMAND_NAMES) else str(payload)
+            name = '%s %s' % ('post' if COMMAND_POSTED == eventType else 'process', command)
+         elif eventType in (SEMAPHORE_WAIT, SEMAPHORE_SIGNAL):
+            name = '%s semaphore 0x%06x' % ('wait' if SEMAPHORE_WAIT == eventType else 'signal', payload)
+         elif eventType in (MESSAGE_SENT, MESSAGE_RECEIVED):
+            name = '%s %s' % ('message to' if MESSAGE_SENT == eventType else 'message for', taskName(payload))
+         else:
+            name = 'event %d (0x%06x)' % (eventType, payload)
+
+         events.append({'ph': 'i', 's': 't', 'pid': 0, 'tid': TASKS_TID, 'ts': ts, 'name': name})
+
+   return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+
+def parseTaskNames(text):
+   names = {}
+   if text:
+      for item in text.split(','):
+         taskId, name = item.split('=', 1)
+         names[int(taskId, 0)] = name
+   return names
+
+
+def main():
+   parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+   parser.add_argument('input', help='memory dump, or record stream with --stream')
+   parser.add_argument('-o', '--output', help='JSON file to write (default: standard output)')
+   parser.add_argument('--stream', action='store_true', help='input is a stream of records, not a memory dump')
+   parser.add_argument('--clock-mhz', type=float, default=168.0, help='core clock, to convert cycles to time (default: 168)')
+   parser.add_argument('--tasks', help='task names, by id: 1=Idle,2=Blinky,...')
+   args = parser.parse_args()
+
+   with open(args.input, 'rb') as fp:
+      data = fp.read()
+
+   records = readStream(data) if args.stream else readDump(data)
+   trace   = convert(records, args.clock_mhz, parseTaskNames(args.tasks))
+
+   if args.output:
+      with open(args.output, 'wt') as fp:
+         json.dump(trace, fp)
+   else:
+      json.dump(trace, sys.stdout)
+
+
+if __name__ == '__main__':
+   main()